@@ -0,0 +1,86 @@
+// ---------------------------------------------------------------------------
+// Insert-only dedup workload: compares the throughput of
+// `gtl::concurrent_flat_hash_set` (lock-free insert) with a
+// `gtl::parallel_flat_hash_set` using a std::mutex per submap, for 1 to 64
+// threads.
+//
+// Each thread inserts its share of `num_values` random values drawn from a
+// range of `num_values / 2`, so about half of the inserts are duplicates, and
+// also checks membership of one value per insert.
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtl/concurrent_set.hpp>
+#include <gtl/phmap.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+static constexpr size_t num_values = 20000000;
+static constexpr size_t N          = 6; // 64 submaps
+
+using concurrent_set = gtl::concurrent_flat_hash_set<uint64_t,
+                                                     gtl::priv::hash_default_hash<uint64_t>,
+                                                     gtl::priv::hash_default_eq<uint64_t>,
+                                                     std::allocator<uint64_t>,
+                                                     N>;
+
+using mutex_set = gtl::parallel_flat_hash_set<uint64_t,
+                                              gtl::priv::hash_default_hash<uint64_t>,
+                                              gtl::priv::hash_default_eq<uint64_t>,
+                                              std::allocator<uint64_t>,
+                                              N,
+                                              std::mutex>;
+
+// ---------------------------------------------------------------------------
+template<class Set>
+float run(const std::vector<uint64_t>& values, size_t num_threads, size_t& size)
+{
+    Set                      s;
+    std::vector<std::thread> threads;
+    stopwatch                sw;
+    size_t                   slice = values.size() / num_threads;
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            size_t found = 0;
+            for (size_t i = t * slice; i < (t + 1) * slice; ++i) {
+                s.insert(values[i]);
+                found += s.contains(values[i ^ 1]);
+            }
+            if (found == values.size())
+                printf("unlikely\n");
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    float ms = sw.since_start();
+    size     = s.size();
+    return ms;
+}
+
+// ---------------------------------------------------------------------------
+int main()
+{
+    std::mt19937_64                         gen(42);
+    std::uniform_int_distribution<uint64_t> dist(0, num_values / 2);
+    std::vector<uint64_t>                   values(num_values);
+    for (auto& v : values)
+        v = dist(gen);
+
+    printf("%8s %22s %22s %8s\n", "threads", "concurrent (Mops/s)", "mutex (Mops/s)", "speedup");
+    for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2) {
+        size_t sz1 = 0, sz2 = 0;
+        float  ms1 = run<concurrent_set>(values, num_threads, sz1);
+        float  ms2 = run<mutex_set>(values, num_threads, sz2);
+        if (sz1 != sz2)
+            printf("error: size mismatch %zu != %zu\n", sz1, sz2);
+
+        double mops = 2.0 * (double)(values.size() / num_threads * num_threads) / 1000000.0;
+        printf("%8zu %22.1f %22.1f %7.2fx\n", num_threads, mops * 1000 / ms1, mops * 1000 / ms2, ms2 / ms1);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// ---------------------------------------------------------------------------
+// Compares the throughput of the archives of gtl/phmap_dump.hpp, dumping and
+// loading a parallel_flat_hash_map<uint64_t, uint64_t>:
+// - BinaryOutputArchive / BinaryInputArchive:   std::ofstream / std::ifstream,
+// - BufferedOutputArchive / MmapInputArchive:   pwritev / mmap,
+// - phmap_dump_parallel / phmap_load_parallel:  the same, one submap per
+//                                               thread at a time.
+// The loads check the CRC-32C of the tables, except the `trust` ones.
+// The file is written to the current directory, and usually stays in the page
+// cache, so this measures the overhead of the archives more than the disk.
+// With one thread, all the archives dump and load the tables at the same
+// speed (the large arrays are copied once to or from the page cache by all of
+// them), the new archives are faster for values saved one by one.
+//
+// usage: bench_dump [num_millions_of_entries] [num_threads]   (default 10, 0: one per core)
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+
+#include <gtl/phmap_dump.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+using map_type  = gtl::parallel_flat_hash_map<uint64_t, uint64_t>;
+
+static const char* path = "bench_dump.data";
+
+// ---------------------------------------------------------------------------
+template<class OutputArchive, class InputArchive>
+void run(const char* name, const map_type& m, size_t bytes, gtl::dump_load_mode mode = gtl::dump_load_mode::verify)
+{
+    stopwatch sw;
+    bool      ok = false;
+    {
+        OutputArchive ar(path);
+        ok = m.phmap_dump(ar);
+    } // the file is closed (and the buffered bytes written) here
+    float dump_ms = sw.since_start();
+
+    map_type m2;
+    sw.start();
+    {
+        InputArchive ar(path);
+        ok = m2.phmap_load(ar, mode) && ok;
+    }
+    float load_ms = sw.since_start();
+
+    printf("    %-38s dump %8.1f MB/s, load %8.1f MB/s%s\n",
+           name,
+           bytes / 1000. / dump_ms,
+           bytes / 1000. / load_ms,
+           ok && m2.size() == m.size() ? "" : "  (FAILED)");
+}
+
+void run_parallel(const char* name, const map_type& m, size_t bytes, size_t num_threads, gtl::dump_load_mode mode)
+{
+    stopwatch sw;
+    bool      ok      = m.phmap_dump_parallel(path, num_threads);
+    float     dump_ms = sw.since_start();
+
+    map_type m2;
+    sw.start();
+    ok            = m2.phmap_load_parallel(path, num_threads, mode) && ok;
+    float load_ms = sw.since_start();
+
+    printf("    %-38s dump %8.1f MB/s, load %8.1f MB/s%s\n",
+           name,
+           bytes / 1000. / dump_ms,
+           bytes / 1000. / load_ms,
+           ok && m2.size() == m.size() ? "" : "  (FAILED)");
+}
+
+// saves and loads `n` values of 8 bytes one by one, as the containers saved
+// entry by entry do (see `gtl::binary_serializer`)
+template<class OutputArchive, class InputArchive>
+void run_small(const char* name, size_t n)
+{
+    stopwatch sw;
+    bool      ok = true;
+    {
+        OutputArchive ar(path);
+        for (uint64_t i = 0; i < n && ok; ++i)
+            ok = ar.saveBinary(i);
+    }
+    float dump_ms = sw.since_start();
+
+    uint64_t sum = 0;
+    sw.start();
+    {
+        InputArchive ar(path);
+        for (uint64_t i = 0, v = 0; i < n && ok; ++i, sum += v)
+            ok = ar.loadBinary(&v);
+    }
+    float load_ms = sw.since_start();
+
+    printf("    %-38s save %8.1f M/s,  load %8.1f M/s%s\n",
+           name,
+           n / 1000. / dump_ms,
+           n / 1000. / load_ms,
+           ok && sum == n * (n - 1) / 2 ? "" : "  (FAILED)");
+}
+
+// ---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t num_entries = (argc > 1 ? (size_t)atoi(argv[1]) : 10) * 1000000;
+    size_t num_threads = argc > 2 ? (size_t)atoi(argv[2]) : 0;
+
+    map_type m;
+    m.reserve(num_entries);
+    for (uint64_t i = 0; i < num_entries; ++i)
+        m.emplace(i * 0x9E3779B97F4A7C15ULL, i);
+
+    size_t bytes = 0;
+    for (size_t s = 0; s < m.subcnt(); ++s)
+        m.with_submap(s, [&](const auto& set) { bytes += set.capacity() * (sizeof(map_type::value_type) + 1); });
+    printf("%zu entries, %.1f MB\n", num_entries, bytes / 1e6);
+
+    for (int i = 0; i < 3; ++i) {
+        run<gtl::BinaryOutputArchive, gtl::BinaryInputArchive>("BinaryOutput/InputArchive", m, bytes);
+        run<gtl::BinaryOutputArchive, gtl::BinaryInputArchive>(
+            "BinaryOutput/InputArchive trust", m, bytes, gtl::dump_load_mode::trust);
+        run<gtl::BufferedOutputArchive, gtl::MmapInputArchive>("BufferedOutputArchive/MmapInput", m, bytes);
+        run<gtl::BufferedOutputArchive, gtl::MmapInputArchive>(
+            "BufferedOutputArchive/MmapInput trust", m, bytes, gtl::dump_load_mode::trust);
+        run_parallel("phmap_dump/load_parallel", m, bytes, num_threads, gtl::dump_load_mode::verify);
+        run_parallel("phmap_dump/load_parallel trust", m, bytes, num_threads, gtl::dump_load_mode::trust);
+    }
+
+    printf("%zu values of 8 bytes\n", num_entries);
+    for (int i = 0; i < 2; ++i) {
+        run_small<gtl::BinaryOutputArchive, gtl::BinaryInputArchive>("BinaryOutput/InputArchive", num_entries);
+        run_small<gtl::BufferedOutputArchive, gtl::MmapInputArchive>("BufferedOutputArchive/MmapInput", num_entries);
+    }
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,76 @@
+// ---------------------------------------------------------------------------
+// Random lookups over a `gtl::flat_hash_map` much larger than the last level
+// cache, with the default allocator (4 KiB pages) and with
+// `gtl::huge_page_allocator` (2 MiB pages when available), to show the cost of
+// TLB misses.
+//
+// usage: bench_huge_page [num_keys_in_millions]   (default 16)
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtl/huge_page_allocator.hpp>
+#include <gtl/phmap.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+static constexpr size_t num_lookups = 20000000;
+
+using value_type = std::pair<const uint64_t, uint64_t>;
+
+using std_map  =
+    gtl::flat_hash_map<uint64_t, uint64_t, gtl::Hash<uint64_t>, gtl::EqualTo<uint64_t>, std::allocator<value_type>>;
+using huge_map = gtl::flat_hash_map<uint64_t,
+                                    uint64_t,
+                                    gtl::Hash<uint64_t>,
+                                    gtl::EqualTo<uint64_t>,
+                                    gtl::huge_page_allocator<value_type>>;
+
+// ---------------------------------------------------------------------------
+template<class Map>
+float run(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& lookups, uint64_t& sum)
+{
+    Map m;
+    m.reserve(keys.size());
+    for (auto k : keys)
+        m[k] = k;
+
+    stopwatch sw;
+    for (auto k : lookups) {
+        auto it = m.find(k);
+        if (it != m.end())
+            sum += it->second;
+    }
+    return sw.since_start();
+}
+
+// ---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t num_keys = (argc > 1 ? (size_t)atoi(argv[1]) : 16) * 1000000;
+
+    std::mt19937_64       gen(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& k : keys)
+        k = gen();
+
+    std::uniform_int_distribution<size_t> idx(0, num_keys - 1);
+    std::vector<uint64_t>                 lookups(num_lookups);
+    for (auto& l : lookups)
+        l = keys[idx(gen)];
+
+    uint64_t sum1 = 0, sum2 = 0;
+    float    ms1 = run<std_map>(keys, lookups, sum1);
+    float    ms2 = run<huge_map>(keys, lookups, sum2);
+    if (sum1 != sum2)
+        printf("error: checksum mismatch\n");
+
+    double mops = (double)num_lookups / 1000000.0;
+    printf("%zuM keys, %zuM random lookups\n", num_keys / 1000000, num_lookups / 1000000);
+    printf("    std::allocator:           %8.1f Mlookup/s\n", mops * 1000 / ms1);
+    printf("    gtl::huge_page_allocator: %8.1f Mlookup/s (%.2fx)\n", mops * 1000 / ms2, ms1 / ms2);
+    return 0;
+}
@@ -0,0 +1,165 @@
+// ---------------------------------------------------------------------------
+// Compares the lru caches of gtl/lru_cache.hpp:
+// - memory used per cached entry,
+// - insert throughput (with evictions),
+// - get throughput (keys drawn from a range 25% larger than the cache),
+// - mixed get/insert throughput from several threads (mt caches only),
+// - get throughput from several threads with a ~97% hit rate, inserting on
+//   misses (mt caches only).
+//
+// usage: bench_lru_cache [cache_size_in_thousands]   (default 1000)
+// ---------------------------------------------------------------------------
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtl/lru_cache.hpp>
+#include <gtl/stopwatch.hpp>
+
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+// bytes currently allocated with malloc (0 if unknown)
+static size_t heap_used()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static constexpr size_t num_ops = 10000000;
+
+// ---------------------------------------------------------------------------
+template<class Cache>
+void run(const char* name, size_t cache_size, const std::vector<uint64_t>& keys)
+{
+    size_t mem0  = heap_used();
+    auto     cache = std::make_unique<Cache>(cache_size);
+
+    stopwatch sw;
+    for (size_t i = 0; i < num_ops; ++i)
+        cache->insert(keys[i] % (2 * cache_size), i);
+    float insert_ms = sw.since_start();
+
+    size_t mem1 = heap_used();
+
+    sw.start();
+    size_t hits = 0;
+    for (size_t i = 0; i < num_ops; ++i)
+        hits += cache->get(keys[i] % (cache_size + cache_size / 4)).has_value();
+    float get_ms = sw.since_start();
+
+    printf("%-28s %10.1f %14.1f %14.1f %8.1f%%\n",
+           name,
+           (double)(mem1 - mem0) / (double)cache->size(),
+           num_ops / (1000. * insert_ms),
+           num_ops / (1000. * get_ms),
+           100. * hits / num_ops);
+}
+
+// ---------------------------------------------------------------------------
+template<class Cache>
+void run_mt(const char* name, size_t cache_size, const std::vector<uint64_t>& keys, size_t num_threads)
+{
+    Cache cache(cache_size);
+    for (size_t i = 0; i < cache_size; ++i)
+        cache.insert(keys[i] % (cache_size + cache_size / 4), i);
+
+    std::vector<std::thread> threads;
+    size_t                   slice = num_ops / num_threads;
+    stopwatch                sw;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t * slice; i < (t + 1) * slice; ++i) {
+                uint64_t k = keys[i] % (cache_size + cache_size / 4);
+                if (i % 10 == 0 || !cache.get(k))
+                    cache.insert(k, i);
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    float ms = sw.since_start();
+    printf("%-28s %8zu threads %10.1f Mops/s\n", name, num_threads, num_ops / (1000. * ms));
+}
+
+// ---------------------------------------------------------------------------
+template<class Cache>
+void run_mt_hits(const char* name, size_t cache_size, const std::vector<uint64_t>& keys, size_t num_threads)
+{
+    const size_t key_range = cache_size * 100 / 97;
+    Cache        cache(cache_size);
+    for (size_t i = 0; i < key_range; ++i)
+        cache.insert(i, i);
+
+    std::vector<std::thread> threads;
+    std::atomic<size_t>      hits{ 0 };
+    size_t                   slice = num_ops / num_threads;
+    stopwatch                sw;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            size_t h = 0;
+            for (size_t i = t * slice; i < (t + 1) * slice; ++i) {
+                uint64_t k = keys[i] % key_range;
+                if (cache.get(k))
+                    ++h;
+                else
+                    cache.insert(k, i);
+            }
+            hits += h;
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    float ms = sw.since_start();
+    printf("%-28s %8zu threads %10.1f Mops/s %8.1f%%\n",
+           name,
+           num_threads,
+           num_ops / (1000. * ms),
+           100. * hits / (slice * num_threads));
+}
+
+// ---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t cache_size = (argc > 1 ? (size_t)atoi(argv[1]) : 1000) * 1000;
+
+    std::mt19937_64       gen(42);
+    std::vector<uint64_t> keys(num_ops);
+    for (auto& k : keys)
+        k = gen();
+
+    printf("%-28s %10s %14s %14s %9s\n", "cache", "bytes/entry", "insert Mops/s", "get Mops/s", "hits");
+    run<gtl::lru_cache<uint64_t, uint64_t>>("lru_cache", cache_size, keys);
+    run<gtl::intrusive_lru_cache<uint64_t, uint64_t>>("intrusive_lru_cache", cache_size, keys);
+    run<gtl::mt_lru_cache<uint64_t, uint64_t>>("mt_lru_cache", cache_size, keys);
+    run<gtl::mt_intrusive_lru_cache<uint64_t, uint64_t>>("mt_intrusive_lru_cache", cache_size, keys);
+    run<gtl::sieve_cache<uint64_t, uint64_t>>("sieve_cache", cache_size, keys);
+    run<gtl::mt_sieve_cache<uint64_t, uint64_t>>("mt_sieve_cache", cache_size, keys);
+
+    printf("\n");
+    for (size_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+        run_mt<gtl::mt_lru_cache<uint64_t, uint64_t>>("mt_lru_cache", cache_size, keys, num_threads);
+        run_mt<gtl::mt_intrusive_lru_cache<uint64_t, uint64_t>>(
+            "mt_intrusive_lru_cache", cache_size, keys, num_threads);
+        run_mt<gtl::mt_sieve_cache<uint64_t, uint64_t>>("mt_sieve_cache", cache_size, keys, num_threads);
+    }
+
+    printf("\n");
+    for (size_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+        run_mt_hits<gtl::mt_lru_cache<uint64_t, uint64_t>>("mt_lru_cache", cache_size, keys, num_threads);
+        run_mt_hits<gtl::mt_intrusive_lru_cache<uint64_t, uint64_t>>(
+            "mt_intrusive_lru_cache", cache_size, keys, num_threads);
+        run_mt_hits<gtl::mt_sieve_cache<uint64_t, uint64_t>>("mt_sieve_cache", cache_size, keys, num_threads);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// ---------------------------------------------------------------------------
+// Compares the hit ratio and throughput of the eviction policies of
+// gtl/lru_cache.hpp on synthetic traces:
+// - zipf:      keys drawn from a Zipf(0.99) distribution over 10M keys,
+// - zipf+scan: the same, interleaved with one-off scans over new keys
+//              (1/3 of the accesses), as a bulk reindex job would do.
+// - zipf+skew: the same as zipf, but the keys of half the ranks all go to 2
+//              of the 16 submaps, so that the submaps are unevenly loaded.
+// On a miss, the key is inserted.
+//
+// usage: bench_lru_policy [cache_size_in_thousands]   (default 100)
+// ---------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtl/lru_cache.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+static constexpr size_t num_keys = 10000000;
+static constexpr size_t num_ops  = 10000000;
+
+// ---------------------------------------------------------------------------
+static std::vector<uint64_t> zipf_trace(double s, std::mt19937_64& gen)
+{
+    std::vector<double> cdf(num_keys);
+    double              sum = 0;
+    for (size_t i = 0; i < num_keys; ++i)
+        cdf[i] = (sum += 1.0 / std::pow(double(i + 1), s));
+
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<uint64_t>                  trace(num_ops);
+    for (auto& k : trace) {
+        size_t rank = size_t(std::lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin());
+        k           = rank * 0x9E3779B97F4A7C15ULL; // so that popular keys are not contiguous
+    }
+    return trace;
+}
+
+// every third access is part of a scan over keys never seen before
+static std::vector<uint64_t> with_scans(std::vector<uint64_t> trace)
+{
+    uint64_t scan_key = 0;
+    for (size_t i = 0; i < trace.size(); i += 3)
+        trace[i] = (num_keys + scan_key++) * 0x9E3779B97F4A7C15ULL;
+    return trace;
+}
+
+// the submap of `k` in a cache with 16 submaps, as in `parallel_hash_set::subidx`
+static size_t submap_of(uint64_t k)
+{
+    size_t h = gtl::phmap_mix<sizeof(size_t)>()(gtl::Hash<uint64_t>()(k));
+    return ((h >> 8) ^ (h >> 16) ^ (h >> 24)) & 15;
+}
+
+// replaces the keys of the even ranks by the next key going to submap 0 or 1
+static std::vector<uint64_t> with_skew(std::vector<uint64_t> trace)
+{
+    for (auto& k : trace) {
+        if (k % 2 == 0) { // rank * 0x9E3779B97F4A7C15 is even iff rank is
+            while (submap_of(k) >= 2)
+                ++k;
+        }
+    }
+    return trace;
+}
+
+// ---------------------------------------------------------------------------
+template<class Cache>
+void run(const char* name, size_t cache_size, const std::vector<uint64_t>& trace)
+{
+    Cache     cache(cache_size);
+    size_t    hits = 0;
+    stopwatch sw;
+    for (uint64_t k : trace) {
+        if (cache.get(k))
+            ++hits;
+        else
+            cache.insert(k, k);
+    }
+    float ms = sw.since_start();
+    printf("    %-22s %8.2f%% hits %10.1f Mops/s\n", name, 100. * hits / trace.size(), trace.size() / (1000. * ms));
+}
+
+template<class K, class V>
+using lru_cache_n4 = gtl::lru_cache_impl<K, V, 4, gtl::Hash<K>, std::equal_to<K>, gtl::NullMutex>;
+
+template<class K, class V>
+using global_lru_cache_n4 =
+    gtl::lru_cache_impl<K, V, 4, gtl::Hash<K>, std::equal_to<K>, gtl::NullMutex, gtl::unit_weigher, true>;
+
+template<class K, class V, class Policy>
+using intrusive_n4 =
+    gtl::lru_cache_intrusive_impl<K, V, 4, gtl::Hash<K>, std::equal_to<K>, gtl::NullMutex, Policy>;
+
+// ---------------------------------------------------------------------------
+void run_all(const char* trace_name, size_t cache_size, const std::vector<uint64_t>& trace)
+{
+    printf("%s, cache size %zu\n", trace_name, cache_size);
+    run<lru_cache_n4<uint64_t, uint64_t>>("lru_cache", cache_size, trace);
+    run<global_lru_cache_n4<uint64_t, uint64_t>>("lru_cache (global)", cache_size, trace);
+    run<intrusive_n4<uint64_t, uint64_t, gtl::lru_policy>>("lru_policy", cache_size, trace);
+    run<intrusive_n4<uint64_t, uint64_t, gtl::sieve_policy>>("sieve_policy", cache_size, trace);
+    run<intrusive_n4<uint64_t, uint64_t, gtl::slru_policy>>("slru_policy", cache_size, trace);
+    run<intrusive_n4<uint64_t, uint64_t, gtl::tinylfu_policy>>("tinylfu_policy", cache_size, trace);
+    run<intrusive_n4<uint64_t, uint64_t, gtl::gdsf_policy<>>>("gdsf_policy", cache_size, trace);
+}
+
+// ---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t cache_size = (argc > 1 ? (size_t)atoi(argv[1]) : 100) * 1000;
+
+    std::mt19937_64 gen(42);
+    auto            zipf = zipf_trace(0.99, gen);
+    auto            scan = with_scans(zipf);
+    auto            skew = with_skew(zipf);
+
+    for (size_t sz : { cache_size / 10, cache_size, cache_size * 10 }) {
+        run_all("zipf", sz, zipf);
+        run_all("zipf+scan", sz, scan);
+        run_all("zipf+skew", sz, skew);
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+// ---------------------------------------------------------------------------
+// Compares the cost of memoized calls with string arguments, when all the
+// results are cached (so every call is a hit):
+// - owning key: the lookup builds a `std::tuple<std::string, std::string>`
+//               from the arguments (copying them) as mt_memoize used to,
+// - mt_memoize: the lookup hashes and compares references to the arguments.
+// Strings of 8 bytes fit in the small string buffer, the longer ones are
+// allocated when copied.
+//
+// Then compares the eviction policies of mt_memoize_lru on a function whose
+// cost depends on its argument: 1 key in 16 takes 50us to compute, the
+// other ones 1us. The keys follow a Zipf(0.99) distribution over 100k keys,
+// with 10k results cached. The time spent recomputing the results is what
+// `gtl::gdsf_policy<>` saves.
+//
+// usage: bench_memoize [num_threads]   (default 4)
+// ---------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <gtl/lru_cache.hpp>
+#include <gtl/memoize.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+static constexpr size_t num_keys = 10000;
+static constexpr size_t num_ops  = 4000000; // per thread
+
+static size_t combine(const std::string& a, const std::string& b) { return a.size() * 31 + b.size(); }
+
+// ---------------------------------------------------------------------------
+// the lookup of mt_memoize before it used heterogeneous lookups
+class owning_key_memoize
+{
+public:
+    using key_type = std::tuple<std::string, std::string>;
+    using map_type = gtl::parallel_flat_hash_map<key_type,
+                                                 size_t,
+                                                 gtl::Hash<key_type>,
+                                                 std::equal_to<key_type>,
+                                                 std::allocator<std::pair<const key_type, size_t>>,
+                                                 6,
+                                                 std::mutex>;
+
+    size_t operator()(const std::string& a, const std::string& b)
+    {
+        key_type key(a, b);
+        size_t   res;
+        _cache.lazy_emplace_l(
+            key,
+            [&](map_type::value_type& v) { res = v.second; },
+            [&](const map_type::constructor& ctor) {
+                res = combine(a, b);
+                ctor(key, res);
+            });
+        return res;
+    }
+
+private:
+    map_type _cache;
+};
+
+// ---------------------------------------------------------------------------
+template<class Memo>
+void run(const char* name, Memo& memo, const std::vector<std::string>& args, size_t num_threads)
+{
+    for (size_t i = 0; i < num_keys; ++i) // warm up: all hits from now on
+        (void)memo(args[i], args[(i + 1) % num_keys]);
+
+    stopwatch                sw;
+    std::vector<std::thread> threads;
+    std::vector<size_t>      sums(num_threads);
+    for (size_t t = 0; t < num_threads; ++t)
+        threads.emplace_back([&, t]() {
+            size_t sum = 0;
+            for (size_t i = 0, k = t * 7919 % num_keys; i < num_ops; ++i, k = (k + 7919) % num_keys)
+                sum += memo(args[k], args[(k + 1) % num_keys]);
+            sums[t] = sum;
+        });
+    for (auto& th : threads)
+        th.join();
+    double ms = sw.since_start();
+    printf("    %-14s %8.1f M calls/s  (checksum %zu)\n",
+           name,
+           double(num_ops * num_threads) / ms / 1000,
+           sums[0]);
+}
+
+void run_all(size_t len, size_t num_threads)
+{
+    std::vector<std::string> args(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        args[i] = std::to_string(i);
+        args[i].resize(len, 'x');
+    }
+    printf("string arguments of %zu bytes, %zu threads\n", len, num_threads);
+
+    owning_key_memoize owning;
+    run("owning key", owning, args, num_threads);
+
+    auto                                                      f = &combine;
+    gtl::mt_memoize<decltype(&combine), false, 6, std::mutex> memo(f);
+    run("mt_memoize", memo, args, num_threads);
+}
+
+// ---------------------------------------------------------------------------
+static constexpr size_t mixed_num_keys   = 100000;
+static constexpr size_t mixed_num_ops    = 400000;
+static constexpr size_t mixed_cache_size = 10000;
+
+static void spin_for(std::chrono::nanoseconds d)
+{
+    auto end = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < end)
+        ;
+}
+
+static std::vector<uint64_t> mixed_trace()
+{
+    std::vector<double> cdf(mixed_num_keys);
+    double              sum = 0;
+    for (size_t i = 0; i < mixed_num_keys; ++i)
+        cdf[i] = (sum += 1.0 / std::pow(double(i + 1), 0.99));
+
+    std::mt19937_64                        gen(42);
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<uint64_t>                  trace(mixed_num_ops);
+    for (auto& k : trace)
+        k = uint64_t(std::lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin()) * 0x9E3779B97F4A7C15ULL;
+    return trace;
+}
+
+template<class Policy>
+void run_mixed(const char* name, const std::vector<uint64_t>& trace)
+{
+    size_t calls = 0, slow_calls = 0;
+    auto   f     = [&](uint64_t k) {
+        ++calls;
+        if ((k >> 32) % 16 == 0) {
+            ++slow_calls;
+            spin_for(std::chrono::microseconds(50));
+        } else {
+            spin_for(std::chrono::microseconds(1));
+        }
+        return k / 3;
+    };
+    gtl::memoize_lru<decltype(f), 4, Policy> memo(f, mixed_cache_size);
+
+    size_t    sum = 0;
+    stopwatch sw;
+    for (uint64_t k : trace)
+        sum += memo(k);
+    double ms = sw.since_start();
+    printf("    %-16s %6.2f%% hits, %6zu slow calls, %8.1f ms  (checksum %zu)\n",
+           name,
+           100. * double(trace.size() - calls) / double(trace.size()),
+           slow_calls,
+           ms,
+           sum);
+}
+
+// ---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t num_threads = argc > 1 ? (size_t)atoi(argv[1]) : 4;
+    for (size_t len : { 8, 64, 256 })
+        run_all(len, num_threads);
+
+    auto trace = mixed_trace();
+    printf("mixed cost, %zu calls\n", trace.size());
+    run_mixed<gtl::lru_policy>("lru_policy", trace);
+    run_mixed<gtl::slru_policy>("slru_policy", trace);
+    run_mixed<gtl::tinylfu_policy>("tinylfu_policy", trace);
+    run_mixed<gtl::gdsf_policy<>>("gdsf_policy", trace);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// ---------------------------------------------------------------------------
+// Lookup throughput of `gtl::flat_hash_map` (keys and values stored together)
+// vs `gtl::soa_flat_hash_map` (keys and values in separate arrays), for value
+// sizes of 8, 64 and 256 bytes.
+//
+// Half of the lookups hit and half miss. Tables are sized well past the
+// typical LLC, so that the cost is dominated by the cache lines touched while
+// probing. `find` reads the value on a hit (which costs the soa layout a second
+// cache miss), `contains` only touches the keys.
+// ---------------------------------------------------------------------------
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtl/phmap.hpp>
+#include <gtl/soa_hash_map.hpp>
+#include <gtl/stopwatch.hpp>
+
+using stopwatch = gtl::stopwatch<std::milli>;
+
+static constexpr size_t num_keys    = 1 << 20;
+static constexpr size_t num_lookups = 20000000;
+
+template<size_t S>
+struct Blob
+{
+    std::array<uint64_t, S / sizeof(uint64_t)> data;
+};
+
+// ---------------------------------------------------------------------------
+template<class Map>
+void run(const std::vector<uint64_t>& keys,
+         const std::vector<uint64_t>& lookups,
+         uint64_t&                    sum,
+         float&                       ms_find,
+         float&                       ms_contains)
+{
+    Map m;
+    m.reserve(keys.size());
+    for (auto k : keys)
+        m[k].data[0] = k;
+
+    stopwatch sw;
+    for (auto k : lookups) {
+        auto it = m.find(k);
+        if (it != m.end())
+            sum += it->second.data[0];
+    }
+    ms_find = sw.since_start();
+
+    sw.start();
+    for (auto k : lookups)
+        sum += m.contains(k);
+    ms_contains = sw.since_start();
+}
+
+// ---------------------------------------------------------------------------
+template<size_t S>
+void bench(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& lookups)
+{
+    uint64_t sum1 = 0, sum2 = 0;
+    float    find1, find2, contains1, contains2;
+    run<gtl::flat_hash_map<uint64_t, Blob<S>>>(keys, lookups, sum1, find1, contains1);
+    run<gtl::soa_flat_hash_map<uint64_t, Blob<S>>>(keys, lookups, sum2, find2, contains2);
+    if (sum1 != sum2)
+        printf("error: checksum mismatch\n");
+    double mops = (double)lookups.size() / 1000000.0;
+    printf("%10zu %-9s %18.1f %18.1f %7.2fx\n", S, "find", mops * 1000 / find1, mops * 1000 / find2, find1 / find2);
+    printf("%10s %-9s %18.1f %18.1f %7.2fx\n", "", "contains", mops * 1000 / contains1, mops * 1000 / contains2,
+           contains1 / contains2);
+}
+
+// ---------------------------------------------------------------------------
+int main()
+{
+    std::mt19937_64       gen(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& k : keys)
+        k = gen() | 1; // present keys are odd
+
+    std::uniform_int_distribution<size_t> idx(0, num_keys - 1);
+    std::vector<uint64_t>                 lookups(num_lookups);
+    for (size_t i = 0; i < num_lookups; ++i)
+        lookups[i] = (i & 1) ? keys[idx(gen)] : (gen() & ~uint64_t(1)); // hits are odd, misses even
+
+    printf("%10s %-9s %18s %18s %8s\n", "value size", "op", "flat (Mlookup/s)", "soa (Mlookup/s)", "speedup");
+    bench<8>(keys, lookups);
+    bench<64>(keys, lookups);
+    bench<256>(keys, lookups);
+    return 0;
+}
@@ -10,6 +10,17 @@
     #define MAPNAME gtl::flat_hash_map
     #define NMSP gtl
     #define EXTRAARGS
+#elif defined(GTL_INT_FLAT)
+    // integer keys only: the string benchmarks are not available
+    // define GTL_INT_INDEX as gtl::int_identity_index to compare index functions
+    #include "gtl/int_hash_map.hpp"
+    #define MAPNAME gtl::int_flat_hash_map
+    #define NMSP gtl
+    #ifndef GTL_INT_INDEX
+        #define GTL_INT_INDEX gtl::int_mix_index
+    #endif
+    #define EXTRAARGS , GTL_INT_INDEX
+    #define NO_STRING_KEYS
 #else
     #if 1
         #include <mutex>
@@ -88,8 +99,10 @@ public:
 template<class K, class V>
 using HashT = MAPNAME<K, V EXTRAARGS>;
 
-using hash_t     = HashT<int64_t, int64_t>;
+using hash_t = HashT<int64_t, int64_t>;
+#ifndef NO_STRING_KEYS
 using str_hash_t = HashT<std::string, int64_t>;
+#endif
 
 const char* program_slug = phmap_xstr(MAPNAME); // "_4";
 
@@ -396,8 +409,10 @@ int main(int argc, char** argv)
         bench_name = argv[2];
     }
 
-    hash_t     hash;
+    hash_t hash;
+#ifndef NO_STRING_KEYS
     str_hash_t str_hash;
+#endif
 
     srand(1); // for a fair/deterministic comparison
     Timer timer(true);
@@ -414,6 +429,24 @@ int main(int argc, char** argv)
         if (!strcmp(bench_name, "sequential")) {
             for (i = 0; i < num_keys; i++)
                 hash.insert(hash_t::value_type(i, value));
+            out("sequential", num_keys, timer);
+        } else if (!strcmp(bench_name, "strided")) {
+            // keys sharing their low bits, bad for hash functions which ignore the high bits
+            for (i = 0; i < num_keys; i++)
+                hash.insert(hash_t::value_type(i << 12, value));
+            out("strided", num_keys, timer);
+        } else if (!strcmp(bench_name, "lookup_sequential") || !strcmp(bench_name, "lookup_strided")) {
+            int     shift = strcmp(bench_name, "lookup_sequential") ? 12 : 0;
+            int64_t found = 0;
+            for (i = 0; i < num_keys; i++)
+                hash.insert(hash_t::value_type(i << shift, value));
+            timer.reset();
+            for (int loop = 0; loop < 4; ++loop)
+                for (i = 0; i < num_keys; i++)
+                    found += (hash.find((int64_t)(((uint64_t)i * 2654435761u) % (2 * num_keys)) << shift) !=
+                              hash.end());
+            fprintf(stderr, "found %" PRId64 "\n", found);
+            out(bench_name, num_keys, timer);
         }
 #if 0
         else if(!strcmp(bench_name, "random"))
@@ -435,7 +468,9 @@ int main(int argc, char** argv)
         } else if (!strcmp(bench_name, "delete")) {
             vector<int64_t> v(static_cast<size_t>(num_keys));
             timer = _delete(v, hash);
-        } else if (!strcmp(bench_name, "sequentialstring")) {
+        }
+#ifndef NO_STRING_KEYS
+        else if (!strcmp(bench_name, "sequentialstring")) {
             for (i = 0; i < num_keys; i++)
                 str_hash.insert({ std::to_string(i), value });
         } else if (!strcmp(bench_name, "randomstring")) {
@@ -448,6 +483,7 @@ int main(int argc, char** argv)
             for (i = 0; i < num_keys; i++)
                 str_hash.erase(std::to_string(i));
         }
+#endif
 
         // printf("%f\n", (float)((double)timer.elapsed().count() / 1000));
         fflush(stdout);
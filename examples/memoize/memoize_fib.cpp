@@ -39,5 +39,21 @@ int main()
            val,
            x,
            sw.since_start() / 1000);
+
+    // the fibonacci sequence as a lazy list (modulo 2^64 past fib(93))
+    auto fibs = gtl::lazy_list(uint64_t(0), [](auto p, size_t n) -> uint64_t {
+        return n == 1 ? 1 : (*p)[n - 1] + (*p)[n - 2];
+    });
+
+    constexpr size_t idx = 1000000;
+
+    sw.start();
+    uint64_t y = fibs[idx];
+    printf("fibs[%zu]:   => %" PRIu64 " in %10.3f seconds (fibs[%" PRIu64 "] = %" PRIu64 ")\n",
+           idx,
+           y,
+           sw.since_start() / 1000,
+           val,
+           fibs[val]);
     return 0;
 }
@@ -126,21 +126,28 @@ int main()
            cached_nth_prime(first + 1),
            sw.since_start() / 1000);
 
-#if 0
-    // lazy list - not working
-    auto primes = gtl::lazy_list(uint64_t(2), [](auto p, size_t idx) -> uint64_t { 
-            uint64_t cur = (*p)[idx - 1]; 
-            while (true) {
-                cur += idx > 1 ? 2 : 1;
-                if (num_factors(cur) == 1) 
-                    return cur;
+    // the same list of primes, as a lazy list
+    auto primes = gtl::lazy_list(uint64_t(2), [](auto p, size_t i) -> uint64_t {
+        uint64_t cur = (*p)[i - 1];
+        while (true) {
+            cur += i > 1 ? 2 : 1;
+            bool prime = true;
+            for (size_t j = 0; prime; ++j) {
+                uint64_t factor = (*p)[j];
+                if (factor * factor > cur)
+                    break;
+                prime = cur % factor != 0;
             }
-            assert(0); return 0;
-        });
-
+            if (prime)
+                return cur;
+        }
+    });
+
+    sw.start();
+    auto p = primes[idx];
+    printf("lazy_list primes[%" PRIu64 "]:   => %" PRIu64 " in %10.3f seconds\n", idx, p, sw.since_start() / 1000);
     assert(primes[100] == 547);
     assert(primes[10000] == 104743);
-#endif
 
     return 0;
 }
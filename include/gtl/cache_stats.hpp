@@ -0,0 +1,238 @@
+#ifndef gtl_cache_stats_hpp_guard_
+#define gtl_cache_stats_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace gtl {
+
+// ------------------------------------------------------------------------------
+// A histogram of durations, with power of 2 buckets: bucket 0 counts the
+// durations under 1ns, and bucket `b > 0` the durations in [2^(b-1), 2^b) ns.
+// The last bucket also counts all the longer durations (over 1.5 days).
+// ------------------------------------------------------------------------------
+struct duration_histogram
+{
+    static constexpr size_t num_buckets = 48;
+
+    std::array<uint64_t, num_buckets> counts{};
+    uint64_t                          total_ns = 0;
+
+    static size_t bucket(uint64_t ns) { return (std::min)(size_t(std::bit_width(ns)), num_buckets - 1); }
+
+    uint64_t count() const
+    {
+        uint64_t res = 0;
+        for (auto c : counts)
+            res += c;
+        return res;
+    }
+
+    std::chrono::nanoseconds mean() const
+    {
+        uint64_t n = count();
+        return std::chrono::nanoseconds(n ? total_ns / n : 0);
+    }
+
+    // an upper bound of the `q` quantile (0 <= q <= 1): the end of its bucket
+    std::chrono::nanoseconds quantile(double q) const
+    {
+        uint64_t n = count();
+        if (n == 0)
+            return std::chrono::nanoseconds(0);
+        uint64_t rank = (std::min)(uint64_t(q * double(n)), n - 1);
+        size_t   b    = 0;
+        for (uint64_t seen = counts[0]; seen <= rank; seen += counts[++b])
+            ;
+        return std::chrono::nanoseconds(uint64_t(1) << b);
+    }
+
+    duration_histogram& operator+=(const duration_histogram& o)
+    {
+        for (size_t b = 0; b < num_buckets; ++b)
+            counts[b] += o.counts[b];
+        total_ns += o.total_ns;
+        return *this;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// A snapshot of the statistics of a cache, returned by its `stats()` member.
+// ------------------------------------------------------------------------------
+struct cache_stats
+{
+    uint64_t hits       = 0;
+    uint64_t misses     = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions  = 0; // including the expired entries
+
+    duration_histogram eviction_age; // from the insertion of the evicted entries
+    duration_histogram miss_latency; // computing the missing values (`get_or_insert()`, memoize)
+
+    uint64_t requests() const { return hits + misses; }
+
+    double hit_ratio() const { return requests() ? double(hits) / double(requests()) : 0.0; }
+
+    cache_stats& operator+=(const cache_stats& o)
+    {
+        hits += o.hits;
+        misses += o.misses;
+        insertions += o.insertions;
+        evictions += o.evictions;
+        eviction_age += o.eviction_age;
+        miss_latency += o.miss_latency;
+        return *this;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// The `Stats` template parameter of the caches and memoizers selects whether
+// they keep statistics: `no_cache_stats` (the default) compiles to nothing,
+// and `cache_counters` keeps a set of counters per submap.
+//
+// Each member is called by the cache for the submap owning the key:
+// - `on_hit()` / `on_miss()` on a lookup,
+// - `on_insert(e)` when a new entry is created, `e` being a member of the entry,
+// - `on_evict(e)` when the entry is evicted (not when it is erased or cleared),
+// - `on_computed(t)` after computing a missing value, `t` from `start_timer()`.
+// ------------------------------------------------------------------------------
+struct no_cache_stats
+{
+    static constexpr bool enabled = false;
+
+    struct entry_data
+    {
+    };
+
+    struct timer
+    {
+    };
+
+    void  on_hit() {}
+    void  on_miss() {}
+    void  on_insert() {}
+    void  on_insert(entry_data&) {}
+    void  on_evict(const entry_data&) {}
+    timer start_timer() const { return {}; }
+    void  on_computed(timer) {}
+    void  add_to(cache_stats&) const {}
+    void  reset() {}
+};
+
+// ------------------------------------------------------------------------------
+// Relaxed atomic counters, on their own cache lines. The counters may be
+// updated while holding a shared lock (or no lock), so each update is an
+// atomic increment: it costs a few ns more than a plain store. `on_insert(e)`
+// and `on_evict(e)` also read the clock, and each entry grows by 8 bytes.
+// ------------------------------------------------------------------------------
+class alignas(64) cache_counters
+{
+public:
+    static constexpr bool enabled = true;
+
+    using clock = std::chrono::steady_clock;
+    using timer = clock::time_point;
+
+    struct entry_data
+    {
+        clock::time_point inserted;
+    };
+
+    void on_hit() { add(_hits); }
+    void on_miss() { add(_misses); }
+    void on_insert() { add(_insertions); }
+
+    void on_insert(entry_data& e)
+    {
+        add(_insertions);
+        e.inserted = clock::now();
+    }
+
+    void on_evict(const entry_data& e)
+    {
+        add(_evictions);
+        _eviction_age.record(clock::now() - e.inserted);
+    }
+
+    timer start_timer() const { return clock::now(); }
+
+    void on_computed(timer start) { _miss_latency.record(clock::now() - start); }
+
+    // adds the counters to `s`, without synchronizing with the updates
+    void add_to(cache_stats& s) const
+    {
+        s.hits += _hits.load(std::memory_order_relaxed);
+        s.misses += _misses.load(std::memory_order_relaxed);
+        s.insertions += _insertions.load(std::memory_order_relaxed);
+        s.evictions += _evictions.load(std::memory_order_relaxed);
+        _eviction_age.add_to(s.eviction_age);
+        _miss_latency.add_to(s.miss_latency);
+    }
+
+    void reset()
+    {
+        for (auto* c : { &_hits, &_misses, &_insertions, &_evictions })
+            c->store(0, std::memory_order_relaxed);
+        _eviction_age.reset();
+        _miss_latency.reset();
+    }
+
+private:
+    using counter = std::atomic<uint64_t>;
+
+    static void add(counter& c, uint64_t n = 1) { c.fetch_add(n, std::memory_order_relaxed); }
+
+    struct histogram
+    {
+        std::array<counter, duration_histogram::num_buckets> counts{};
+        counter                                              total_ns{ 0 };
+
+        void record(clock::duration d)
+        {
+            uint64_t ns = uint64_t((std::max)(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(),
+                                              std::chrono::nanoseconds::rep(0)));
+            add(counts[duration_histogram::bucket(ns)]);
+            add(total_ns, ns);
+        }
+
+        void add_to(duration_histogram& h) const
+        {
+            for (size_t b = 0; b < counts.size(); ++b)
+                h.counts[b] += counts[b].load(std::memory_order_relaxed);
+            h.total_ns += total_ns.load(std::memory_order_relaxed);
+        }
+
+        void reset()
+        {
+            for (auto& c : counts)
+                c.store(0, std::memory_order_relaxed);
+            total_ns.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    counter   _hits{ 0 };
+    counter   _misses{ 0 };
+    counter   _insertions{ 0 };
+    counter   _evictions{ 0 };
+    histogram _eviction_age;
+    histogram _miss_latency;
+};
+
+} // namespace gtl
+
+#endif // gtl_cache_stats_hpp_guard_
@@ -0,0 +1,460 @@
+#ifndef gtl_concurrent_set_hpp_guard_
+#define gtl_concurrent_set_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "gtl/phmap.hpp"
+
+namespace gtl {
+
+// ------------------------------------------------------------------------------
+// concurrent_flat_hash_set: an insert-only, thread-safe, open addressing set.
+//
+// Meant for deduplication pipelines which only ever insert values and check
+// membership, and remove values only with a bulk `clear()`. As in
+// `parallel_flat_hash_set`, values are spread over 2^N submaps, and each submap
+// uses the control byte / H2 scheme of `raw_hash_set`. However `insert()` and
+// `contains()` never take a lock:
+//
+// - a slot is claimed by a CAS of its control byte from kEmpty to kDeleted
+//   (which we use as a "busy" marker, since nothing is ever erased), then the
+//   value is constructed and the control byte is published as H2 (or reset to
+//   kEmpty if the construction throws).
+// - the claimed slot is always the lowest empty slot of the first group with an
+//   empty slot on the probe sequence, and inserters wait for busy slots of the
+//   groups they probe, so concurrent inserts of the same value race for the
+//   same slot and the value is stored only once.
+//
+// Each submap grows on its own, under a mutex which is taken only when the
+// submap's table is full. Because concurrent readers may still be probing the
+// previous table, it is retired rather than freed, and released only by
+// `clear()` or the destructor (this at most doubles the memory used). Call
+// `reserve()` upfront when the final size is known to avoid growing at all.
+//
+// `clear()`, `reserve()` and `for_each()` must not run concurrently with
+// `insert()`.
+// ------------------------------------------------------------------------------
+template<class T,
+         class Hash  = gtl::priv::hash_default_hash<T>,
+         class Eq    = gtl::priv::hash_default_eq<T>,
+         class Alloc = gtl::priv::Allocator<T>, // alias for std::allocator
+         size_t N    = 4>                       // 2**N submaps
+class concurrent_flat_hash_set
+{
+    using ctrl_t = priv::ctrl_t;
+    using h2_t   = priv::h2_t;
+    using Group  = priv::Group;
+
+    static_assert(N <= 12, "N = 12 means 4096 hash tables!");
+    static_assert(sizeof(std::atomic<ctrl_t>) == sizeof(ctrl_t) && std::atomic<ctrl_t>::is_always_lock_free,
+                  "control bytes are read by Group as plain bytes");
+
+    constexpr static size_t num_tables = 1 << N;
+    constexpr static size_t mask       = num_tables - 1;
+
+    // Added to `reserved` when a table is replaced, so that no new slot can be
+    // claimed in it.
+    constexpr static size_t kClosed = (std::numeric_limits<size_t>::max)() / 2;
+
+public:
+    using key_type        = T;
+    using value_type      = T;
+    using size_type       = size_t;
+    using hasher          = Hash;
+    using key_equal       = Eq;
+    using allocator_type  = Alloc;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+
+    explicit concurrent_flat_hash_set(size_t bucket_count   = 0,
+                                      const hasher&         hash  = hasher(),
+                                      const key_equal&      eq    = key_equal(),
+                                      const allocator_type& alloc = allocator_type())
+        : hash_(hash)
+        , eq_(eq)
+        , alloc_(alloc)
+    {
+        if (bucket_count)
+            reserve(bucket_count);
+    }
+
+    concurrent_flat_hash_set(const concurrent_flat_hash_set&)            = delete;
+    concurrent_flat_hash_set& operator=(const concurrent_flat_hash_set&) = delete;
+
+    ~concurrent_flat_hash_set() { clear(); }
+
+    // Inserts `v` unless an equal value is already present. Returns true if
+    // the value was inserted. Safe to call concurrently with `insert()` and
+    // `contains()`.
+    // ------------------------------------------------------------------------
+    bool insert(const value_type& v) { return emplace_impl(v); }
+    bool insert(value_type&& v) { return emplace_impl(std::move(v)); }
+
+    template<class... Args>
+    bool emplace(Args&&... args)
+    {
+        return emplace_impl(value_type(std::forward<Args>(args)...));
+    }
+
+    // Safe to call concurrently with `insert()`. A value whose insertion is
+    // still in progress may not be reported yet.
+    // ------------------------------------------------------------------------
+    bool contains(const key_type& key) const
+    {
+        size_t         hashval = hash(key);
+        const table_t* t       = sets_[subidx(hashval)].table_.load(std::memory_order_acquire);
+        return t && find_in(t, key, hashval) != kNotFound;
+    }
+
+    size_t count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+    size_t size() const
+    {
+        size_t sz = 0;
+        for (const auto& sub : sets_) {
+            const table_t* t = sub.table_.load(std::memory_order_acquire);
+            if (t)
+                sz += t->done_.load(std::memory_order_relaxed);
+        }
+        return sz;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const
+    {
+        size_t c = 0;
+        for (const auto& sub : sets_) {
+            const table_t* t = sub.table_.load(std::memory_order_acquire);
+            if (t)
+                c += t->capacity_;
+        }
+        return c;
+    }
+
+    // Makes sure that `n` values can be inserted without any submap growing,
+    // assuming a reasonably uniform distribution over the submaps.
+    // ------------------------------------------------------------------------
+    void reserve(size_t n)
+    {
+        size_t per_submap = (n + num_tables - 1) / num_tables;
+        size_t cap        = (std::max)(priv::NormalizeCapacity(priv::GrowthToLowerboundCapacity(per_submap)),
+                                       kMinCapacity);
+        for (auto& sub : sets_) {
+            std::lock_guard<std::mutex> lock(sub.mutex_);
+            table_t* t = sub.table_.load(std::memory_order_acquire);
+            if (!t || t->capacity_ < cap)
+                replace_table(sub, t, cap);
+        }
+    }
+
+    // Destroys all values and releases all memory, including retired tables.
+    // Must not be called concurrently with any other member function.
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        for (auto& sub : sets_) {
+            table_t* t = sub.table_.exchange(nullptr, std::memory_order_acq_rel);
+            if (t)
+                destroy_table(t);
+            while (sub.retired_) {
+                table_t* next = sub.retired_->retired_next_;
+                destroy_table(sub.retired_);
+                sub.retired_ = next;
+            }
+        }
+    }
+
+    // Calls `f(const value_type&)` for every value. Must not be called
+    // concurrently with `insert()`.
+    // ------------------------------------------------------------------------
+    template<class F>
+    void for_each(F&& f) const
+    {
+        for (const auto& sub : sets_) {
+            const table_t* t = sub.table_.load(std::memory_order_acquire);
+            if (!t)
+                continue;
+            for (size_t i = 0; i <= t->capacity_; ++i)
+                if (priv::IsFull(t->ctrl_[i].load(std::memory_order_acquire)))
+                    f(t->slots_[i]);
+        }
+    }
+
+    hasher         hash_function() const { return hash_; }
+    key_equal      key_eq() const { return eq_; }
+    allocator_type get_allocator() const { return alloc_; }
+
+    static size_t subidx(size_t hashval) { return ((hashval >> 8) ^ (hashval >> 16) ^ (hashval >> 24)) & mask; }
+
+    static constexpr size_t subcnt() { return num_tables; }
+
+private:
+    constexpr static size_t kNotFound    = (std::numeric_limits<size_t>::max)();
+    constexpr static size_t kMinCapacity = Group::kWidth - 1; // so a group never sees a slot twice
+
+    // One open addressing table. The `capacity_ + 1` control bytes are followed
+    // by the `capacity_ + 1` slots in a single allocation. Unlike in
+    // `raw_hash_set`, there is no sentinel (so the last position is a regular
+    // slot) and the first control bytes are not cloned at the end, so that each
+    // slot has a single control byte which can be claimed with one CAS. Groups
+    // which would wrap around are loaded byte by byte instead (see
+    // `load_group()`).
+    // ------------------------------------------------------------------------
+    struct table_t
+    {
+        size_t               capacity_;
+        size_t               growth_; // max number of values before we grow
+        std::atomic<size_t>  reserved_{ 0 }; // slot claims (including those in progress)
+        std::atomic<size_t>  done_{ 0 };     // published values
+        std::atomic<ctrl_t>* ctrl_;
+        value_type*          slots_;
+        table_t*             retired_next_ = nullptr;
+    };
+
+    struct alignas(64) Inner
+    {
+        std::atomic<table_t*> table_{ nullptr };
+        std::mutex            mutex_;    // only taken to grow or replace `table_`
+        table_t*              retired_ = nullptr;
+    };
+
+    using TableAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<table_t>;
+    using TableTraits = typename std::allocator_traits<Alloc>::template rebind_traits<table_t>;
+    using SlotTraits  = std::allocator_traits<Alloc>;
+
+    size_t hash(const key_type& key) const { return phmap_mix<sizeof(size_t)>()(static_cast<size_t>(hash_(key))); }
+
+    static size_t ctrl_bytes(size_t cap)
+    {
+        return (cap + 1 + alignof(value_type) - 1) & ~(alignof(value_type) - 1);
+    }
+
+    static size_t alloc_size(size_t cap) { return ctrl_bytes(cap) + (cap + 1) * sizeof(value_type); }
+
+    table_t* new_table(size_t cap)
+    {
+        assert(priv::IsValidCapacity(cap));
+        TableAlloc ta(alloc_);
+        table_t*   t = TableTraits::allocate(ta, 1);
+        TableTraits::construct(ta, t);
+        t->capacity_ = cap;
+        t->growth_   = priv::CapacityToGrowth(cap);
+
+        constexpr size_t kAlign = alignof(value_type) > alignof(size_t) ? alignof(value_type) : alignof(size_t);
+        char*            mem    = static_cast<char*>(gtl::Allocate<kAlign>(&alloc_, alloc_size(cap)));
+        t->ctrl_                = reinterpret_cast<std::atomic<ctrl_t>*>(mem);
+        t->slots_               = reinterpret_cast<value_type*>(mem + ctrl_bytes(cap));
+        std::memset(mem, priv::kEmpty, cap + 1);
+        return t;
+    }
+
+    void destroy_table(table_t* t)
+    {
+        for (size_t i = 0; i <= t->capacity_; ++i)
+            if (priv::IsFull(t->ctrl_[i].load(std::memory_order_relaxed)))
+                SlotTraits::destroy(alloc_, t->slots_ + i);
+
+        constexpr size_t kAlign = alignof(value_type) > alignof(size_t) ? alignof(value_type) : alignof(size_t);
+        gtl::Deallocate<kAlign>(&alloc_, t->ctrl_, alloc_size(t->capacity_));
+        TableAlloc ta(alloc_);
+        TableTraits::destroy(ta, t);
+        TableTraits::deallocate(ta, t, 1);
+    }
+
+    static Group load_group(const table_t* t, size_t offset)
+    {
+        if (offset + Group::kWidth <= t->capacity_ + 1)
+            return Group{ reinterpret_cast<const ctrl_t*>(t->ctrl_ + offset) };
+        alignas(16) ctrl_t buf[Group::kWidth];
+        for (size_t i = 0; i < Group::kWidth; ++i)
+            buf[i] = t->ctrl_[(offset + i) & t->capacity_].load(std::memory_order_relaxed);
+        return Group{ buf };
+    }
+
+    // Returns the index of the slot containing `key`, or kNotFound.
+    // ------------------------------------------------------------------------
+    size_t find_in(const table_t* t, const key_type& key, size_t hashval) const
+    {
+        const ctrl_t h2  = static_cast<ctrl_t>(priv::H2(hashval));
+        auto         seq = probe_seq(t, hashval);
+        while (true) {
+            Group g = load_group(t, seq.offset());
+            for (uint32_t i : g.Match(priv::H2(hashval))) {
+                size_t idx = seq.offset(i);
+                if (t->ctrl_[idx].load(std::memory_order_acquire) == h2 && eq_(t->slots_[idx], key))
+                    return idx;
+            }
+            if (g.MatchEmpty())
+                return kNotFound;
+            seq.next();
+            assert(seq.getindex() <= t->capacity_ && "full table!");
+        }
+    }
+
+    static priv::probe_seq<Group::kWidth> probe_seq(const table_t* t, size_t hashval)
+    {
+        return priv::probe_seq<Group::kWidth>(priv::H1(hashval, reinterpret_cast<const ctrl_t*>(t->ctrl_)),
+                                              t->capacity_);
+    }
+
+    template<class V>
+    bool emplace_impl(V&& v)
+    {
+        size_t hashval = hash(v);
+        Inner& sub     = sets_[subidx(hashval)];
+
+        while (true) {
+            table_t* t = sub.table_.load(std::memory_order_acquire);
+            if (!t) {
+                grow(sub, nullptr);
+                continue;
+            }
+            auto res = try_insert(t, std::forward<V>(v), hashval);
+            if (res != insert_result::full)
+                return res == insert_result::inserted;
+            grow(sub, t);
+        }
+    }
+
+    enum class insert_result
+    {
+        inserted,
+        found,
+        full
+    };
+
+    template<class V>
+    insert_result try_insert(table_t* t, V&& v, size_t hashval)
+    {
+        const ctrl_t h2  = static_cast<ctrl_t>(priv::H2(hashval));
+        auto         seq = probe_seq(t, hashval);
+        while (true) {
+            Group g = load_group(t, seq.offset());
+            if (g.Match(static_cast<h2_t>(priv::kDeleted))) {
+                // an insert is in progress in this group, wait until it is published
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint32_t i : g.Match(priv::H2(hashval))) {
+                size_t idx = seq.offset(i);
+                if (t->ctrl_[idx].load(std::memory_order_acquire) == h2 && eq_(t->slots_[idx], v))
+                    return insert_result::found;
+            }
+            auto empties = g.MatchEmpty();
+            if (!empties) {
+                seq.next();
+                assert(seq.getindex() <= t->capacity_ && "full table!");
+                continue;
+            }
+
+            if (t->reserved_.fetch_add(1, std::memory_order_acq_rel) >= t->growth_) {
+                t->reserved_.fetch_sub(1, std::memory_order_acq_rel);
+                return insert_result::full;
+            }
+
+            size_t idx      = seq.offset(empties.LowestBitSet());
+            ctrl_t expected = priv::kEmpty;
+            if (!t->ctrl_[idx].compare_exchange_strong(expected, priv::kDeleted, std::memory_order_acq_rel)) {
+                // lost the race for this slot, rescan the same group
+                t->reserved_.fetch_sub(1, std::memory_order_acq_rel);
+                continue;
+            }
+            try {
+                SlotTraits::construct(alloc_, t->slots_ + idx, std::forward<V>(v));
+            } catch (...) {
+                // release the slot, which unblocks the inserters waiting on this
+                // group and `replace_table()` waiting for the claims in progress
+                t->ctrl_[idx].store(priv::kEmpty, std::memory_order_release);
+                t->reserved_.fetch_sub(1, std::memory_order_acq_rel);
+                throw;
+            }
+            t->ctrl_[idx].store(h2, std::memory_order_release);
+            t->done_.fetch_add(1, std::memory_order_release);
+            return insert_result::inserted;
+        }
+    }
+
+    // Replaces the (full) table `t` of `sub` with one twice as large.
+    // ------------------------------------------------------------------------
+    void grow(Inner& sub, table_t* t)
+    {
+        std::lock_guard<std::mutex> lock(sub.mutex_);
+        if (sub.table_.load(std::memory_order_acquire) != t)
+            return; // someone else already did it
+        size_t cap = t ? t->capacity_ * 2 + 1 : kMinCapacity;
+        replace_table(sub, t, cap);
+    }
+
+    // Must be called with `sub.mutex_` locked.
+    // ------------------------------------------------------------------------
+    void replace_table(Inner& sub, table_t* t, size_t cap)
+    {
+        table_t* nt = new_table(cap);
+        if (t) {
+            // prevent new claims, and wait for the ones in progress to be published
+            t->reserved_.fetch_add(kClosed, std::memory_order_acq_rel);
+            while (true) {
+                size_t done = t->done_.load(std::memory_order_acquire);
+                if (t->reserved_.load(std::memory_order_acquire) == kClosed + done)
+                    break;
+                std::this_thread::yield();
+            }
+
+            // rehash. Values are copied, not moved, as readers may still access them.
+            size_t cnt = 0;
+            for (size_t i = 0; i <= t->capacity_; ++i) {
+                ctrl_t c = t->ctrl_[i].load(std::memory_order_acquire);
+                if (!priv::IsFull(c))
+                    continue;
+                const value_type& v       = t->slots_[i];
+                size_t            hashval = hash(v);
+                auto              seq     = probe_seq(nt, hashval);
+                while (true) {
+                    Group g = load_group(nt, seq.offset());
+                    if (auto empties = g.MatchEmpty()) {
+                        size_t idx = seq.offset(empties.LowestBitSet());
+                        SlotTraits::construct(alloc_, nt->slots_ + idx, v);
+                        nt->ctrl_[idx].store(c, std::memory_order_relaxed);
+                        break;
+                    }
+                    seq.next();
+                }
+                ++cnt;
+            }
+            nt->reserved_.store(cnt, std::memory_order_relaxed);
+            nt->done_.store(cnt, std::memory_order_relaxed);
+
+            t->retired_next_ = sub.retired_;
+            sub.retired_     = t;
+        }
+        sub.table_.store(nt, std::memory_order_release);
+    }
+
+    std::array<Inner, num_tables> sets_;
+    hasher                        hash_;
+    key_equal                     eq_;
+    allocator_type                alloc_;
+};
+
+} // namespace gtl
+
+#endif // gtl_concurrent_set_hpp_guard_
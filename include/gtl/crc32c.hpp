@@ -0,0 +1,150 @@
+#ifndef gtl_crc32c_hpp_guard_
+#define gtl_crc32c_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+    #include <nmmintrin.h>
+    #define GTL_CRC32C_X86 1
+    #define GTL_CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+    #include <intrin.h>
+    #include <nmmintrin.h>
+    #define GTL_CRC32C_X86 1
+    #define GTL_CRC32C_TARGET
+#elif defined(__ARM_FEATURE_CRC32)
+    #include <arm_acle.h>
+    #define GTL_CRC32C_ARM 1
+#endif
+
+namespace gtl {
+
+namespace priv {
+
+// ------------------------------------------------------------------------------
+// Software CRC-32C, 8 bytes at a time (slicing-by-8), with tables computed at
+// compile time from the reflected Castagnoli polynomial.
+// ------------------------------------------------------------------------------
+struct crc32c_tables
+{
+    uint32_t t[8][256];
+
+    constexpr crc32c_tables()
+        : t{}
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c >> 1) ^ ((c & 1) ? 0x82F63B78u : 0u);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int s = 1; s < 8; ++s)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+    }
+};
+
+inline constexpr crc32c_tables crc32c_table{};
+
+// `crc` and the result are not inverted
+inline uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t n)
+{
+    const auto& t = crc32c_table.t;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; n; --n, ++p)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    return crc;
+}
+
+#if defined(GTL_CRC32C_X86)
+
+GTL_CRC32C_TARGET inline uint32_t crc32c_hw(uint32_t crc, const unsigned char* p, size_t n)
+{
+    uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    for (; n; --n, ++p)
+        c = _mm_crc32_u8(uint32_t(c), *p);
+    return uint32_t(c);
+}
+
+// SSE4.2 is checked at run time, so that the library doesn't need -msse4.2
+inline bool crc32c_have_hw()
+{
+    #if defined(_MSC_VER) && !defined(__clang__)
+    static const bool have = []() {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+    }();
+    return have;
+    #else
+    static const bool have = __builtin_cpu_supports("sse4.2");
+    return have;
+    #endif
+}
+
+#elif defined(GTL_CRC32C_ARM)
+
+inline uint32_t crc32c_hw(uint32_t crc, const unsigned char* p, size_t n)
+{
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for (; n; --n, ++p)
+        crc = __crc32cb(crc, *p);
+    return crc;
+}
+
+inline bool crc32c_have_hw() { return true; }
+
+#endif
+
+} // namespace priv
+
+// ------------------------------------------------------------------------------
+// Returns the CRC-32C (Castagnoli, as in iSCSI and ext4) of the `n` bytes at
+// `data`, continuing from `crc`, the CRC-32C of the previous bytes (0 for
+// none), so that `crc32c(crc32c(0, a, n), b, m)` is the CRC-32C of the bytes
+// of `a` followed by those of `b`.
+//
+// Uses the crc32 instruction of SSE4.2 (x86-64) or of ARMv8 when available,
+// otherwise a table lookup per byte (slicing-by-8), several times slower.
+// ------------------------------------------------------------------------------
+inline uint32_t crc32c(uint32_t crc, const void* data, size_t n)
+{
+    auto p = static_cast<const unsigned char*>(data);
+#if defined(GTL_CRC32C_X86) || defined(GTL_CRC32C_ARM)
+    if (priv::crc32c_have_hw())
+        return ~priv::crc32c_hw(~crc, p, n);
+#endif
+    return ~priv::crc32c_sw(~crc, p, n);
+}
+
+} // namespace gtl
+
+#endif // gtl_crc32c_hpp_guard_
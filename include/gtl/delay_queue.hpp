@@ -0,0 +1,166 @@
+#ifndef gtl_delay_queue_hpp_guard_
+#define gtl_delay_queue_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gtl {
+
+// ------------------------------------------------------------------------------
+// delay_queue: a bounded, lock-free, multi producer / multi consumer FIFO of
+// values which must be kept alive until a given time, for example values
+// removed from a cache while other threads may still be reading them.
+//
+// The values are moved into slots of an array allocated upfront (`Capacity`
+// rounded up to a power of 2), so pushing and draining never allocate. Each
+// slot has a sequence number telling whether it is free or holds a value for
+// a given position of the queue (D. Vyukov's bounded MPMC queue), so producers
+// and consumers only contend on the head or tail index.
+//
+// - `try_push(time, value)` moves `value` into the queue, to be released at
+//   `time`. It returns false, and leaves `value` untouched, if the queue is full.
+// - `drain(now, f)` pops the values whose time is not after `now`, in FIFO
+//   order, calling `f(T&&)` on each one before destroying it. It stops at the
+//   first value whose time is after `now`, so values pushed with decreasing
+//   times are released late rather than early.
+//
+// Times are opaque `uint32_t`s compared with `<=` (for example a number of
+// seconds or milliseconds since some epoch).
+// ------------------------------------------------------------------------------
+template<class T, size_t Capacity>
+class delay_queue
+{
+    static_assert(Capacity > 0, "delay_queue needs at least one slot");
+    static_assert(std::is_nothrow_destructible_v<T>);
+
+    struct slot
+    {
+        std::atomic<size_t>   seq;
+        std::atomic<uint32_t> time;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+public:
+    using value_type = T;
+
+    static constexpr size_t capacity = std::bit_ceil(Capacity);
+
+    delay_queue()
+        : _slots(new slot[capacity])
+    {
+        for (size_t i = 0; i < capacity; ++i)
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    delay_queue(const delay_queue&)            = delete;
+    delay_queue& operator=(const delay_queue&) = delete;
+
+    ~delay_queue() { clear(); }
+
+    template<class U>
+    bool try_push(uint32_t time, U&& value)
+    {
+        // a slot is claimed before the value is constructed in it, so this must not throw
+        static_assert(std::is_nothrow_constructible_v<T, U&&>, "push values by move");
+
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            slot&     s   = _slots[pos & mask];
+            size_t    seq = s.seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = ptrdiff_t(seq - pos);
+            if (dif == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(s.storage)) T(std::forward<U>(value));
+                    s.time.store(time, std::memory_order_relaxed);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false; // full
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // returns the number of values released
+    template<class F>
+    size_t drain(uint32_t now, F&& f)
+    {
+        size_t n   = 0;
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            slot&     s   = _slots[pos & mask];
+            size_t    seq = s.seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = ptrdiff_t(seq - (pos + 1));
+            if (dif == 0) {
+                uint32_t time = s.time.load(std::memory_order_relaxed);
+                if (s.seq.load(std::memory_order_acquire) != seq) {
+                    // popped and pushed again since we read `seq`, so `time` may not be its time
+                    pos = _head.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (time > now)
+                    return n;
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T* v = s.value();
+                    f(std::move(*v));
+                    v->~T();
+                    s.seq.store(pos + capacity, std::memory_order_release);
+                    ++n;
+                    ++pos;
+                }
+            } else if (dif < 0) {
+                return n; // empty
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t drain(uint32_t now)
+    {
+        return drain(now, [](T&&) {});
+    }
+
+    // releases all the values, whatever their time
+    void clear() { drain(uint32_t(-1)); }
+
+    // exact only when no other thread pushes or drains
+    size_t size() const
+    {
+        size_t head = _head.load(std::memory_order_relaxed); // first, so that head <= tail
+        return _tail.load(std::memory_order_relaxed) - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr size_t mask = capacity - 1;
+
+    std::unique_ptr<slot[]>          _slots;
+    alignas(64) std::atomic<size_t> _tail{ 0 }; // next position to push
+    alignas(64) std::atomic<size_t> _head{ 0 }; // next position to pop
+};
+
+} // namespace gtl
+
+#endif // gtl_delay_queue_hpp_guard_
@@ -0,0 +1,148 @@
+#ifndef gtl_epoch_hpp_guard_
+#define gtl_epoch_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <utility>
+
+namespace gtl {
+
+// ------------------------------------------------------------------------------
+// epoch_domain: the reader side of epoch based reclamation.
+//
+// A reader calls `pin()` before reading shared objects, and may use them until
+// the returned guard is destroyed. Pinning records the current epoch in one of
+// `max_pinned` slots (each on its own cache line, so readers don't contend as
+// long as they use different slots).
+//
+// A writer which unlinks an object, so that readers pinning from now on can't
+// reach it, tags it with `epoch()` and keeps it aside. The object can be
+// destroyed once `min_pinned()` is greater than its tag, as the readers which
+// could still reach it have all unpinned. Calling `advance()` after tagging
+// objects lets later readers pin with a greater epoch, so that the tagged
+// objects can be released even when the domain is never free of readers.
+//
+// At most `max_pinned` guards can be alive at once; `pin()` waits for a free
+// slot beyond that.
+// ------------------------------------------------------------------------------
+class epoch_domain
+{
+    struct alignas(64) slot
+    {
+        std::atomic<uint64_t> epoch{ 0 }; // 0 when not pinned
+    };
+
+public:
+    static constexpr size_t max_pinned = 128;
+
+    class guard
+    {
+    public:
+        guard() = default;
+
+        guard(guard&& o) noexcept
+            : _domain(std::exchange(o._domain, nullptr))
+            , _slot(std::exchange(o._slot, nullptr))
+        {
+        }
+
+        guard& operator=(guard&& o) noexcept
+        {
+            if (this != &o) {
+                release();
+                _domain = std::exchange(o._domain, nullptr);
+                _slot   = std::exchange(o._slot, nullptr);
+            }
+            return *this;
+        }
+
+        ~guard() { release(); }
+
+        // the domain pinned by this guard, or nullptr
+        const epoch_domain* domain() const { return _domain; }
+
+        void release()
+        {
+            if (_slot) {
+                _slot->epoch.store(0, std::memory_order_release);
+                _slot = nullptr;
+            }
+        }
+
+    private:
+        friend class epoch_domain;
+
+        guard(const epoch_domain* d, slot* s)
+            : _domain(d)
+            , _slot(s)
+        {
+        }
+
+        const epoch_domain* _domain = nullptr;
+        slot*               _slot   = nullptr;
+    };
+
+    epoch_domain()                               = default;
+    epoch_domain(const epoch_domain&)            = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    // the returned guard must not outlive the domain
+    guard pin()
+    {
+        // start from the slot this thread used last, likely still in its cache
+        static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (size_t i = 0;; ++i) {
+            slot&    s        = _slots[(hint + i) % max_pinned];
+            uint64_t expected = 0;
+            // the compare_exchange is a full barrier: the slot is published before
+            // the reader reads any shared object
+            if (s.epoch.load(std::memory_order_relaxed) == 0 &&
+                s.epoch.compare_exchange_strong(expected, epoch(), std::memory_order_seq_cst)) {
+                hint = (hint + i) % max_pinned;
+                return guard(this, &s);
+            }
+            if (i % max_pinned == max_pinned - 1)
+                std::this_thread::yield();
+        }
+    }
+
+    uint64_t epoch() const { return _epoch.load(std::memory_order_seq_cst); }
+
+    void advance() { _epoch.fetch_add(1, std::memory_order_seq_cst); }
+
+    // the smallest epoch pinned by a live guard, or the max uint64_t value if none
+    uint64_t min_pinned() const
+    {
+        uint64_t res = (std::numeric_limits<uint64_t>::max)();
+        for (const auto& s : _slots) {
+            uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e != 0 && e < res)
+                res = e;
+        }
+        return res;
+    }
+
+private:
+    std::atomic<uint64_t>          _epoch{ 1 };
+    std::array<slot, max_pinned> _slots;
+};
+
+} // namespace gtl
+
+#endif // gtl_epoch_hpp_guard_
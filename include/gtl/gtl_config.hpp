@@ -165,6 +165,18 @@
     #define GTL_HAVE_EXCEPTIONS 1
 #endif
 
+// ---------------------------------------------------------------------------
+// Checks whether mmap(), madvise() and writev() are available (used by
+// huge_page_allocator.hpp, numa.hpp and the archives of phmap_dump.hpp).
+// ---------------------------------------------------------------------------
+#ifndef GTL_HAVE_MMAP
+    #if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+        #define GTL_HAVE_MMAP 1
+    #else
+        #define GTL_HAVE_MMAP 0
+    #endif
+#endif
+
 // ---------------------------------------------------------------------------
 // Checks whether wchar_t is treated as a native type
 // (MSVC: /Zc:wchar_t- treats wchar_t as unsigned short)
@@ -0,0 +1,171 @@
+#ifndef gtl_huge_page_allocator_hpp_guard
+#define gtl_huge_page_allocator_hpp_guard
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "gtl_config.hpp"
+
+#if GTL_HAVE_MMAP
+    #include <sys/mman.h>
+#endif
+
+namespace gtl {
+
+namespace priv {
+
+// ---------------------------------------------------------------------------
+// Maps and unmaps anonymous memory backed by huge pages when possible.
+// ---------------------------------------------------------------------------
+struct huge_page_mmap
+{
+    static constexpr size_t huge_page_size = size_t(2) << 20; // 2 MiB
+
+    static size_t round_up(size_t n) { return (n + huge_page_size - 1) & ~(huge_page_size - 1); }
+
+    // Returns nullptr on failure. We try, in order:
+    // 1. explicit huge pages (MAP_HUGETLB), which only succeeds if huge pages
+    //    were reserved by the administrator (vm.nr_hugepages),
+    // 2. a regular mapping aligned on a huge page boundary and advised with
+    //    MADV_HUGEPAGE, so that transparent huge pages can back all of it.
+    // -----------------------------------------------------------------------
+    static void* map(size_t bytes)
+    {
+#if GTL_HAVE_MMAP
+        size_t len = round_up(bytes);
+    #ifdef MAP_HUGETLB
+        void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            return p;
+    #endif
+        // over-allocate by one huge page, and trim both ends to get an aligned range
+        void* raw = ::mmap(nullptr, len + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            return nullptr;
+        uintptr_t start   = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = round_up(start);
+        if (aligned > start)
+            ::munmap(raw, aligned - start);
+        size_t tail = (start + len + huge_page_size) - (aligned + len);
+        if (tail)
+            ::munmap(reinterpret_cast<void*>(aligned + len), tail);
+    #ifdef MADV_HUGEPAGE
+        ::madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE); // only a hint, failure is fine
+    #endif
+        return reinterpret_cast<void*>(aligned);
+#else
+        (void)bytes;
+        return nullptr;
+#endif
+    }
+
+    static void unmap(void* p, size_t bytes)
+    {
+#if GTL_HAVE_MMAP
+        ::munmap(p, round_up(bytes));
+#else
+        (void)p;
+        (void)bytes;
+#endif
+    }
+};
+
+} // namespace priv
+
+// ---------------------------------------------------------------------------
+// huge_page_allocator: a standard allocator which serves allocations of at
+// least `Threshold` bytes with `mmap`, backed by huge pages (2 MiB) when the
+// system allows it, which greatly reduces TLB misses for very large hash
+// tables or vectors. Smaller allocations use `std::allocator`.
+//
+// Huge pages are obtained with MAP_HUGETLB if some were reserved, otherwise
+// the mapping is aligned to 2 MiB and advised with MADV_HUGEPAGE (transparent
+// huge pages must then be set to `madvise` or `always`). If neither is
+// available, large allocations still use `mmap` with regular pages. On
+// platforms without `mmap`, all allocations use `std::allocator`.
+//
+// Usable as the `Alloc` parameter of the gtl hash containers, for example:
+//     gtl::parallel_flat_hash_map<K, V, gtl::Hash<K>, gtl::EqualTo<K>,
+//                                 gtl::huge_page_allocator<std::pair<const K, V>>>
+// or with `gtl::vector<T, gtl::huge_page_allocator<T>>`.
+// ---------------------------------------------------------------------------
+template<class T, size_t Threshold = priv::huge_page_mmap::huge_page_size>
+class huge_page_allocator
+{
+public:
+    using value_type                             = T;
+    using size_type                              = size_t;
+    using difference_type                        = ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal                        = std::true_type;
+
+    template<class U>
+    struct rebind
+    {
+        using other = huge_page_allocator<U, Threshold>;
+    };
+
+    static constexpr size_t threshold = Threshold;
+
+    huge_page_allocator() noexcept = default;
+
+    template<class U>
+    huge_page_allocator(const huge_page_allocator<U, Threshold>&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > (std::numeric_limits<size_t>::max)() / sizeof(T))
+            throw std::bad_array_new_length();
+        size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes))
+            return std::allocator<T>().allocate(n);
+        void* p = priv::huge_page_mmap::map(bytes);
+        if (!p)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes))
+            std::allocator<T>().deallocate(p, n);
+        else
+            priv::huge_page_mmap::unmap(p, bytes);
+    }
+
+    // true if an allocation of `bytes` bytes goes through `mmap`
+    static bool use_mmap(size_t bytes) noexcept { return GTL_HAVE_MMAP && bytes >= Threshold; }
+
+    template<class U>
+    friend bool operator==(const huge_page_allocator&, const huge_page_allocator<U, Threshold>&) noexcept
+    {
+        return true;
+    }
+
+    template<class U>
+    friend bool operator!=(const huge_page_allocator&, const huge_page_allocator<U, Threshold>&) noexcept
+    {
+        return false;
+    }
+};
+
+} // namespace gtl
+
+#endif // gtl_huge_page_allocator_hpp_guard
@@ -0,0 +1,906 @@
+#ifndef gtl_int_hash_map_hpp_guard_
+#define gtl_int_hash_map_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+//
+// Open addressing hash containers for integer keys, without control bytes:
+//
+// - `gtl::int_flat_hash_map<K, V, Index>`
+// - `gtl::int_flat_hash_set<K, Index>`
+//
+// The slot array is probed linearly from `Index(key, mask)`, and the state of
+// a slot is encoded in its key: two reserved key values mark empty and deleted
+// slots. Keys equal to these reserved values can still be inserted, they are
+// stored in two extra slots at the end of the array.
+//
+// The `Index` parameter selects how keys are mapped to a slot:
+// - `int_mix_index` (default): one multiplication and a shift, good for any key
+//   pattern.
+// - `int_identity_index`: the key itself. Fastest for dense keys (sequential
+//   keys land in consecutive slots), but keys sharing their low bits (for
+//   example multiples of a large power of two) all collide.
+// - `int_direct_index<Bound>`: the key itself, with the table pre-sized so that
+//   every key below `Bound` has its own slot (direct indexing: a lookup reads
+//   exactly one slot). Larger keys are still supported.
+//
+// The API follows `gtl::flat_hash_map` / `gtl::flat_hash_set`, except for
+// node handles (`extract`, `merge`) and the hasher / key_equal accessors.
+// ---------------------------------------------------------------------------
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "gtl/phmap.hpp"
+
+namespace gtl {
+
+// ---------------------------------------------------------------------------
+// Index functions. `key` is the key converted to an unsigned value, `mask` is
+// the table capacity minus one.
+// ---------------------------------------------------------------------------
+// Fibonacci hashing: the top bits of `key * 2^64 / phi` (the low bits of the
+// product only depend on the low bits of the key).
+struct int_mix_index
+{
+    size_t operator()(uint64_t key, size_t mask) const
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - std::bit_width(mask)));
+    }
+};
+
+struct int_identity_index
+{
+    size_t operator()(uint64_t key, size_t mask) const { return static_cast<size_t>(key) & mask; }
+};
+
+template<size_t Bound>
+struct int_direct_index : int_identity_index
+{
+    static constexpr size_t min_size = Bound;
+};
+
+namespace priv {
+
+template<class Index, class = void>
+struct int_index_min_size
+{
+    static constexpr size_t value = 0;
+};
+
+template<class Index>
+struct int_index_min_size<Index, std::void_t<decltype(Index::min_size)>>
+{
+    static constexpr size_t value = Index::min_size;
+};
+
+// ---------------------------------------------------------------------------
+// Slot policies. Besides the element, each slot gives access to its key, which
+// is what empty and deleted slots are made of.
+// ---------------------------------------------------------------------------
+template<class K>
+struct int_set_policy
+{
+    using key_type   = K;
+    using value_type = K;
+    using slot_type  = K;
+
+    static constexpr bool constant_iterators = true;
+
+    static K&       raw_key(slot_type* slot) { return *slot; }
+    static const K& raw_key(const slot_type* slot) { return *slot; }
+
+    static value_type&       element(slot_type* slot) { return *slot; }
+    static const value_type& element(const slot_type* slot) { return *slot; }
+
+    static void set_key(slot_type* slot, K k) { ::new (static_cast<void*>(slot)) K(k); }
+
+    template<class Allocator, class... Args>
+    static void construct(Allocator* alloc, slot_type* slot, Args&&... args)
+    {
+        std::allocator_traits<Allocator>::construct(*alloc, slot, std::forward<Args>(args)...);
+    }
+
+    template<class Allocator>
+    static void destroy(Allocator* alloc, slot_type* slot)
+    {
+        std::allocator_traits<Allocator>::destroy(*alloc, slot);
+    }
+
+    template<class Allocator>
+    static void transfer(Allocator* alloc, slot_type* new_slot, slot_type* old_slot)
+    {
+        construct(alloc, new_slot, std::move(*old_slot));
+        destroy(alloc, old_slot);
+    }
+};
+
+// The key of a free slot is written through the `key` member of
+// `map_slot_type`, and read back the same way for every slot (as in
+// `map_slot_policy::key()`, `K` being an integer the key is the initial
+// member of the pair).
+// ---------------------------------------------------------------------------
+template<class K, class V>
+struct int_map_policy : map_slot_policy<K, V>
+{
+    using key_type   = K;
+    using value_type = std::pair<const K, V>;
+    using slot_type  = map_slot_type<K, V>;
+
+    static constexpr bool constant_iterators = false;
+
+    static const K& raw_key(const slot_type* slot) { return slot->key; }
+
+    static void set_key(slot_type* slot, K k) { ::new (static_cast<void*>(&slot->key)) K(k); }
+};
+
+// ---------------------------------------------------------------------------
+// int_raw_hash_set: the table shared by `int_flat_hash_map` and
+// `int_flat_hash_set`.
+//
+// Layout: `capacity` regular slots (capacity is a power of two), then one slot
+// for the key `kEmptyKey` and one slot for the key `kDeletedKey`. A regular
+// slot is free when its key is one of these two values. A special slot is
+// present when its key is the key it is reserved for (the other reserved key
+// is written in it when it is absent), so that iterators need nothing but a
+// pointer to the slot and to the special slots.
+//
+// Deleted slots (tombstones) are reused on insert and dropped on rehash, with
+// the same `growth_left` accounting as `raw_hash_set`. The maximum load factor
+// is 3/4, since linear probing degrades faster than group probing.
+// ---------------------------------------------------------------------------
+template<class Policy, class Index, class Alloc>
+class int_raw_hash_set
+{
+    using K         = typename Policy::key_type;
+    using slot_type = typename Policy::slot_type;
+    using UK        = std::make_unsigned_t<K>;
+
+    static_assert(std::is_integral_v<K> && !std::is_same_v<K, bool>, "int_raw_hash_set requires an integer key");
+
+public:
+    static constexpr K kEmptyKey   = (std::numeric_limits<K>::max)();
+    static constexpr K kDeletedKey = kEmptyKey - 1;
+
+    using key_type        = K;
+    using value_type      = typename Policy::value_type;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using index_type      = Index;
+    using allocator_type  = Alloc;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+    using pointer         = typename std::allocator_traits<allocator_type>::pointer;
+    using const_pointer   = typename std::allocator_traits<allocator_type>::const_pointer;
+
+    // ------------------------------------------------------------------------
+    template<bool is_const>
+    class iterator_impl
+    {
+        friend class int_raw_hash_set;
+        template<bool>
+        friend class iterator_impl;
+
+        using slot_ptr = std::conditional_t<is_const, const slot_type*, slot_type*>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename int_raw_hash_set::value_type;
+        using reference =
+            std::conditional_t<is_const || Policy::constant_iterators, const value_type&, value_type&>;
+        using pointer         = std::remove_reference_t<reference>*;
+        using difference_type = typename int_raw_hash_set::difference_type;
+
+        iterator_impl() = default;
+
+        // conversion from iterator to const_iterator
+        template<bool c = is_const, std::enable_if_t<c, int> = 0>
+        iterator_impl(const iterator_impl<false>& o)
+            : slot_(o.slot_)
+            , special_(o.special_)
+        {
+        }
+
+        reference operator*() const { return Policy::element(slot_); }
+        pointer   operator->() const { return &Policy::element(slot_); }
+
+        iterator_impl& operator++()
+        {
+            ++slot_;
+            skip_free();
+            return *this;
+        }
+
+        iterator_impl operator++(int)
+        {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) { return a.slot_ == b.slot_; }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) { return !(a == b); }
+
+    private:
+        iterator_impl(slot_ptr slot, slot_ptr special)
+            : slot_(slot)
+            , special_(special)
+        {
+        }
+
+        void skip_free()
+        {
+            while (slot_ < special_ && is_free_key(Policy::raw_key(slot_)))
+                ++slot_;
+            if (slot_ == special_ && Policy::raw_key(slot_) != kEmptyKey)
+                ++slot_;
+            if (slot_ == special_ + 1 && Policy::raw_key(slot_) != kDeletedKey)
+                ++slot_;
+        }
+
+        slot_ptr slot_    = nullptr;
+        slot_ptr special_ = nullptr; // first of the two special slots
+    };
+
+    using iterator       = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    // ------------------------------------------------------------------------
+    int_raw_hash_set() noexcept(std::is_nothrow_default_constructible_v<index_type> &&
+                                std::is_nothrow_default_constructible_v<allocator_type>)
+    {
+    }
+
+    explicit int_raw_hash_set(size_t                bucket_count,
+                              const index_type&     index = index_type(),
+                              const allocator_type& alloc = allocator_type())
+        : index_(index)
+        , alloc_(alloc)
+    {
+        if (bucket_count)
+            reserve(bucket_count);
+    }
+
+    int_raw_hash_set(const int_raw_hash_set& o)
+        : index_(o.index_)
+        , alloc_(std::allocator_traits<allocator_type>::select_on_container_copy_construction(o.alloc_))
+    {
+        copy_from(o);
+    }
+
+    int_raw_hash_set(int_raw_hash_set&& o) noexcept
+        : index_(std::move(o.index_))
+        , alloc_(std::move(o.alloc_))
+    {
+        steal(o);
+    }
+
+    int_raw_hash_set& operator=(const int_raw_hash_set& o)
+    {
+        if (this != &o) {
+            int_raw_hash_set tmp(o);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    int_raw_hash_set& operator=(int_raw_hash_set&& o) noexcept
+    {
+        if (this != &o) {
+            destroy_slots();
+            index_ = std::move(o.index_);
+            alloc_ = std::move(o.alloc_);
+            steal(o);
+        }
+        return *this;
+    }
+
+    ~int_raw_hash_set() { destroy_slots(); }
+
+    // ------------------------------------------------------------------------
+    iterator begin()
+    {
+        if (!capacity_)
+            return end();
+        iterator it(slots_, slots_ + capacity_);
+        it.skip_free();
+        return it;
+    }
+
+    iterator end() { return capacity_ ? iterator(slots_ + capacity_ + 2, slots_ + capacity_) : iterator(); }
+
+    const_iterator begin() const { return const_cast<int_raw_hash_set*>(this)->begin(); }
+    const_iterator end() const { return const_cast<int_raw_hash_set*>(this)->end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool   empty() const { return !size(); }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    size_t bucket_count() const { return capacity_; }
+    size_t max_size() const { return (std::numeric_limits<size_t>::max)(); }
+    float  load_factor() const { return capacity_ ? static_cast<float>(size_) / capacity_ : 0.0f; }
+    float  max_load_factor() const { return 0.75f; }
+    void   max_load_factor(float) {} // does nothing, as in `raw_hash_set`
+
+    index_type     index_function() const { return index_; }
+    allocator_type get_allocator() const { return alloc_; }
+
+    void clear()
+    {
+        if (!capacity_)
+            return;
+        for (size_t i = 0; i != capacity_; ++i) {
+            if (!is_free_key(Policy::raw_key(slots_ + i)))
+                Policy::destroy(&alloc_, slots_ + i);
+            Policy::set_key(slots_ + i, kEmptyKey);
+        }
+        for (size_t s = 0; s < 2; ++s) {
+            if (special_present(s)) {
+                Policy::destroy(&alloc_, special_slot(s));
+                set_special_absent(s);
+            }
+        }
+        size_        = 0;
+        growth_left_ = capacity_to_growth(capacity_);
+    }
+
+    void reserve(size_t n)
+    {
+        size_t m = growth_to_capacity(n);
+        if (m > capacity_)
+            resize(m);
+    }
+
+    void rehash(size_t n)
+    {
+        if (n == 0 && capacity_ == 0)
+            return;
+        if (n == 0 && size_ == 0) {
+            destroy_slots();
+            return;
+        }
+        size_t m = growth_to_capacity(size_);
+        while (m < n)
+            m *= 2;
+        if (n == 0 || m > capacity_)
+            resize(m);
+    }
+
+    // ------------------------------------------------------------------------
+    iterator find(key_type k)
+    {
+        size_t i = find_index(k);
+        return i == npos ? end() : iterator_at(i);
+    }
+
+    const_iterator find(key_type k) const { return const_cast<int_raw_hash_set*>(this)->find(k); }
+
+    bool   contains(key_type k) const { return find_index(k) != npos; }
+    size_t count(key_type k) const { return contains(k) ? 1 : 0; }
+
+    std::pair<iterator, iterator> equal_range(key_type k)
+    {
+        auto it = find(k);
+        if (it != end())
+            return { it, std::next(it) };
+        return { it, it };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(key_type k) const
+    {
+        return const_cast<int_raw_hash_set*>(this)->equal_range(k);
+    }
+
+    // ------------------------------------------------------------------------
+    size_t erase(key_type k)
+    {
+        size_t i = find_index(k);
+        if (i == npos)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    // Erasing never moves other elements, so the iterators to them (including
+    // the returned one) stay valid, as with `gtl::flat_hash_map`.
+    iterator erase(const_iterator cit)
+    {
+        iterator it = iterator_at(static_cast<size_t>(cit.slot_ - slots_));
+        erase_at(static_cast<size_t>(it.slot_ - slots_));
+        ++it;
+        return it;
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while (first != last)
+            first = erase(first);
+        return iterator_at(static_cast<size_t>(last.slot_ - slots_));
+    }
+
+    void swap(int_raw_hash_set& o) noexcept
+    {
+        using std::swap;
+        swap(slots_, o.slots_);
+        swap(size_, o.size_);
+        swap(capacity_, o.capacity_);
+        swap(growth_left_, o.growth_left_);
+        swap(index_, o.index_);
+        swap(alloc_, o.alloc_);
+    }
+
+    friend void swap(int_raw_hash_set& a, int_raw_hash_set& b) noexcept { a.swap(b); }
+
+protected:
+    static constexpr size_t npos = (std::numeric_limits<size_t>::max)();
+
+    static bool is_free_key(K k) { return k == kEmptyKey || k == kDeletedKey; }
+
+    iterator iterator_at(size_t i) { return { slots_ + i, slots_ + capacity_ }; }
+
+    size_t home(K k) const { return index_(static_cast<uint64_t>(static_cast<UK>(k)), capacity_ - 1); }
+
+    // the special slots: 0 holds the key `kEmptyKey`, 1 holds `kDeletedKey`
+    static size_t special_of(K k) { return k == kEmptyKey ? 0 : 1; }
+    static K      special_key(size_t s) { return s == 0 ? kEmptyKey : kDeletedKey; }
+
+    slot_type* special_slot(size_t s) const { return slots_ + capacity_ + s; }
+    bool       special_present(size_t s) const { return Policy::raw_key(special_slot(s)) == special_key(s); }
+    void       set_special_absent(size_t s) { Policy::set_key(special_slot(s), special_key(1 - s)); }
+
+    size_t find_index(K k) const
+    {
+        if (GTL_PREDICT_FALSE(!capacity_))
+            return npos;
+        if (GTL_PREDICT_FALSE(is_free_key(k))) {
+            size_t s = special_of(k);
+            return special_present(s) ? capacity_ + s : npos;
+        }
+        const size_t mask = capacity_ - 1;
+        for (size_t i = home(k);; i = (i + 1) & mask) {
+            K key = Policy::raw_key(slots_ + i);
+            if (key == k)
+                return i;
+            if (key == kEmptyKey)
+                return npos;
+        }
+    }
+
+    // first empty or deleted slot on the probe sequence of `k`
+    size_t find_first_non_full(K k) const
+    {
+        const size_t mask = capacity_ - 1;
+        for (size_t i = home(k);; i = (i + 1) & mask) {
+            if (is_free_key(Policy::raw_key(slots_ + i)))
+                return i;
+        }
+    }
+
+    // Finds `k`, or constructs a new element for it from `args` (which are
+    // passed to `Policy::construct`).
+    template<class... Args>
+    std::pair<iterator, bool> find_or_emplace(K k, Args&&... args)
+    {
+        if (GTL_PREDICT_FALSE(!capacity_))
+            resize(growth_to_capacity(1));
+
+        if (GTL_PREDICT_FALSE(is_free_key(k))) {
+            size_t s = special_of(k);
+            if (special_present(s))
+                return { iterator_at(capacity_ + s), false };
+            try {
+                Policy::construct(&alloc_, special_slot(s), std::forward<Args>(args)...);
+            } catch (...) {
+                set_special_absent(s); // the key may be written already
+                throw;
+            }
+            ++size_;
+            return { iterator_at(capacity_ + s), true };
+        }
+
+        const size_t mask    = capacity_ - 1;
+        size_t       deleted = npos;
+        size_t       i       = home(k);
+        for (;; i = (i + 1) & mask) {
+            K key = Policy::raw_key(slots_ + i);
+            if (key == k)
+                return { iterator_at(i), false };
+            if (key == kEmptyKey)
+                break;
+            if (key == kDeletedKey && deleted == npos)
+                deleted = i;
+        }
+        if (deleted != npos) {
+            i = deleted;
+        } else if (GTL_PREDICT_FALSE(growth_left_ == 0)) {
+            rehash_and_grow_if_necessary();
+            i = find_first_non_full(k);
+        }
+        K free_key = Policy::raw_key(slots_ + i);
+        try {
+            Policy::construct(&alloc_, slots_ + i, std::forward<Args>(args)...);
+        } catch (...) {
+            Policy::set_key(slots_ + i, free_key); // the key may be written already
+            throw;
+        }
+        bool was_empty = free_key == kEmptyKey;
+        assert(Policy::raw_key(slots_ + i) == k);
+        ++size_;
+        growth_left_ -= was_empty;
+        return { iterator_at(i), true };
+    }
+
+    void erase_at(size_t i)
+    {
+        if (GTL_PREDICT_FALSE(i >= capacity_)) {
+            size_t s = i - capacity_;
+            assert(special_present(s) && "erasing a dangling iterator");
+            Policy::destroy(&alloc_, special_slot(s));
+            set_special_absent(s);
+            --size_;
+            return;
+        }
+        assert(!is_free_key(Policy::raw_key(slots_ + i)) && "erasing a dangling iterator");
+        Policy::destroy(&alloc_, slots_ + i);
+        --size_;
+
+        // if the next slot is empty, no probe sequence goes through this one
+        if (Policy::raw_key(slots_ + ((i + 1) & (capacity_ - 1))) == kEmptyKey) {
+            Policy::set_key(slots_ + i, kEmptyKey);
+            ++growth_left_;
+        } else {
+            Policy::set_key(slots_ + i, kDeletedKey);
+        }
+    }
+
+    static size_t capacity_to_growth(size_t capacity) { return capacity - capacity / 4; }
+
+    // smallest power of two capacity able to hold `growth` elements (at least
+    // 8, and at least `Index::min_size` for `int_direct_index`)
+    static size_t growth_to_capacity(size_t growth)
+    {
+        growth       = (std::max)(growth, int_index_min_size<Index>::value);
+        size_t m     = 8;
+        while (capacity_to_growth(m) < growth)
+            m *= 2;
+        return m;
+    }
+
+    void rehash_and_grow_if_necessary()
+    {
+        if (size_ <= capacity_to_growth(capacity_) / 2)
+            resize(capacity_); // squash deleted slots without growing
+        else
+            resize(capacity_ * 2);
+    }
+
+    static size_t alloc_size(size_t capacity) { return (capacity + 2) * sizeof(slot_type); }
+
+    void resize(size_t new_capacity)
+    {
+        assert(new_capacity >= 8 && (new_capacity & (new_capacity - 1)) == 0);
+        slot_type*   old_slots    = slots_;
+        const size_t old_capacity = capacity_;
+
+        slots_ = static_cast<slot_type*>(Allocate<alignof(slot_type)>(&alloc_, alloc_size(new_capacity)));
+        capacity_ = new_capacity;
+        for (size_t i = 0; i != new_capacity; ++i)
+            Policy::set_key(slots_ + i, kEmptyKey);
+        set_special_absent(0);
+        set_special_absent(1);
+
+        size_t num_regular = 0;
+        if (old_capacity) {
+            const size_t mask = new_capacity - 1;
+            for (size_t i = 0; i != old_capacity; ++i) {
+                K k = Policy::raw_key(old_slots + i);
+                if (is_free_key(k))
+                    continue;
+                size_t j = home(k);
+                while (Policy::raw_key(slots_ + j) != kEmptyKey)
+                    j = (j + 1) & mask;
+                Policy::transfer(&alloc_, slots_ + j, old_slots + i);
+                ++num_regular;
+            }
+            for (size_t s = 0; s < 2; ++s) {
+                slot_type* old = old_slots + old_capacity + s;
+                if (Policy::raw_key(old) == special_key(s))
+                    Policy::transfer(&alloc_, special_slot(s), old);
+            }
+            Deallocate<alignof(slot_type)>(&alloc_, old_slots, alloc_size(old_capacity));
+        }
+        growth_left_ = capacity_to_growth(new_capacity) - num_regular;
+    }
+
+    void destroy_slots()
+    {
+        if (!capacity_)
+            return;
+        clear();
+        Deallocate<alignof(slot_type)>(&alloc_, slots_, alloc_size(capacity_));
+        slots_       = nullptr;
+        capacity_    = 0;
+        growth_left_ = 0;
+    }
+
+    void copy_from(const int_raw_hash_set& o)
+    {
+        reserve(o.size());
+        for (auto it = o.begin(); it != o.end(); ++it)
+            find_or_emplace(key_of(*it), *it);
+    }
+
+    static K key_of(const K& k) { return k; }
+
+    template<class P>
+    static K key_of(const P& p)
+    {
+        return p.first;
+    }
+
+    void steal(int_raw_hash_set& o)
+    {
+        slots_       = std::exchange(o.slots_, nullptr);
+        size_        = std::exchange(o.size_, 0);
+        capacity_    = std::exchange(o.capacity_, 0);
+        growth_left_ = std::exchange(o.growth_left_, 0);
+    }
+
+    slot_type*     slots_       = nullptr; // [(capacity + 2) * slot_type]
+    size_t         size_        = 0;       // number of elements, including the special slots
+    size_t         capacity_    = 0;       // number of regular slots (a power of two, or 0)
+    size_t         growth_left_ = 0;       // empty regular slots we can still fill before rehashing
+    index_type     index_;
+    allocator_type alloc_;
+};
+
+} // namespace priv
+
+// ---------------------------------------------------------------------------
+// int_flat_hash_map: see the top of this file.
+// ---------------------------------------------------------------------------
+template<class K,
+         class V,
+         class Index = gtl::int_mix_index,
+         class Alloc = gtl::priv::Allocator<gtl::priv::Pair<const K, V>>> // alias for std::allocator
+class int_flat_hash_map : public priv::int_raw_hash_set<priv::int_map_policy<K, V>, Index, Alloc>
+{
+    using Base = priv::int_raw_hash_set<priv::int_map_policy<K, V>, Index, Alloc>;
+
+public:
+    using typename Base::allocator_type;
+    using typename Base::const_iterator;
+    using typename Base::index_type;
+    using typename Base::iterator;
+    using typename Base::key_type;
+    using typename Base::value_type;
+    using mapped_type = V;
+
+    using Base::Base;
+
+    int_flat_hash_map() = default;
+
+    int_flat_hash_map(std::initializer_list<value_type> init,
+                      size_t                            bucket_count = 0,
+                      const index_type&                 index        = index_type(),
+                      const allocator_type&             alloc        = allocator_type())
+        : Base(bucket_count, index, alloc)
+    {
+        insert(init.begin(), init.end());
+    }
+
+    template<class InputIt>
+    int_flat_hash_map(InputIt               first,
+                      InputIt               last,
+                      size_t                bucket_count = 0,
+                      const index_type&     index        = index_type(),
+                      const allocator_type& alloc        = allocator_type())
+        : Base(bucket_count, index, alloc)
+    {
+        insert(first, last);
+    }
+
+    // ------------------------------------------------------------------------
+    template<class... Args>
+    std::pair<iterator, bool> try_emplace(key_type k, Args&&... args)
+    {
+        return this->find_or_emplace(
+            k, std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<class... Args>
+    iterator try_emplace(const_iterator, key_type k, Args&&... args)
+    {
+        return try_emplace(k, std::forward<Args>(args)...).first;
+    }
+
+    template<class KK, class... Args>
+    std::pair<iterator, bool> emplace(KK&& k, Args&&... args)
+    {
+        return try_emplace(key_type(std::forward<KK>(k)), std::forward<Args>(args)...);
+    }
+
+    template<class P, std::enable_if_t<std::is_constructible_v<value_type, P&&>, int> = 0>
+    std::pair<iterator, bool> emplace(P&& p)
+    {
+        return insert(std::forward<P>(p));
+    }
+
+    template<class... Args>
+    iterator emplace_hint(const_iterator, Args&&... args)
+    {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return this->find_or_emplace(v.first, v); }
+
+    template<class P, std::enable_if_t<std::is_constructible_v<value_type, P&&>, int> = 0>
+    std::pair<iterator, bool> insert(P&& p)
+    {
+        key_type k = static_cast<key_type>(p.first);
+        return this->find_or_emplace(k, std::forward<P>(p));
+    }
+
+    iterator insert(const_iterator, const value_type& v) { return insert(v).first; }
+
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+
+    template<class M>
+    std::pair<iterator, bool> insert_or_assign(key_type k, M&& obj)
+    {
+        auto res = try_emplace(k, std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    mapped_type& operator[](key_type k) { return try_emplace(k).first->second; }
+
+    mapped_type& at(key_type k)
+    {
+        auto it = this->find(k);
+        if (it == this->end())
+            throw std::out_of_range("gtl int_flat_hash_map::at failed bounds check");
+        return it->second;
+    }
+
+    const mapped_type& at(key_type k) const { return const_cast<int_flat_hash_map*>(this)->at(k); }
+
+    friend bool operator==(const int_flat_hash_map& a, const int_flat_hash_map& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (const auto& v : a) {
+            auto other = b.find(v.first);
+            if (other == b.end() || !(other->second == v.second))
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const int_flat_hash_map& a, const int_flat_hash_map& b) { return !(a == b); }
+};
+
+// ---------------------------------------------------------------------------
+// int_flat_hash_set: see the top of this file.
+// ---------------------------------------------------------------------------
+template<class K, class Index = gtl::int_mix_index, class Alloc = gtl::priv::Allocator<K>>
+class int_flat_hash_set : public priv::int_raw_hash_set<priv::int_set_policy<K>, Index, Alloc>
+{
+    using Base = priv::int_raw_hash_set<priv::int_set_policy<K>, Index, Alloc>;
+
+public:
+    using typename Base::allocator_type;
+    using typename Base::const_iterator;
+    using typename Base::index_type;
+    using typename Base::iterator;
+    using typename Base::key_type;
+    using typename Base::value_type;
+
+    using Base::Base;
+
+    int_flat_hash_set() = default;
+
+    int_flat_hash_set(std::initializer_list<value_type> init,
+                      size_t                            bucket_count = 0,
+                      const index_type&                 index        = index_type(),
+                      const allocator_type&             alloc        = allocator_type())
+        : Base(bucket_count, index, alloc)
+    {
+        insert(init.begin(), init.end());
+    }
+
+    template<class InputIt>
+    int_flat_hash_set(InputIt               first,
+                      InputIt               last,
+                      size_t                bucket_count = 0,
+                      const index_type&     index        = index_type(),
+                      const allocator_type& alloc        = allocator_type())
+        : Base(bucket_count, index, alloc)
+    {
+        insert(first, last);
+    }
+
+    // ------------------------------------------------------------------------
+    std::pair<iterator, bool> insert(key_type k) { return this->find_or_emplace(k, k); }
+
+    iterator insert(const_iterator, key_type k) { return insert(k).first; }
+
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first)
+            insert(static_cast<key_type>(*first));
+    }
+
+    void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        return insert(key_type(std::forward<Args>(args)...));
+    }
+
+    template<class... Args>
+    iterator emplace_hint(const_iterator, Args&&... args)
+    {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    friend bool operator==(const int_flat_hash_set& a, const int_flat_hash_set& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (auto k : a)
+            if (!b.contains(k))
+                return false;
+        return true;
+    }
+
+    friend bool operator!=(const int_flat_hash_set& a, const int_flat_hash_set& b) { return !(a == b); }
+};
+
+// ======== erase_if for the integer key containers ==========================
+template<class K, class V, class Index, class Alloc, class Pred>
+std::size_t erase_if(gtl::int_flat_hash_map<K, V, Index, Alloc>& c, Pred pred)
+{
+    return gtl::priv::erase_if(c, std::move(pred));
+}
+
+template<class K, class Index, class Alloc, class Pred>
+std::size_t erase_if(gtl::int_flat_hash_set<K, Index, Alloc>& c, Pred pred)
+{
+    return gtl::priv::erase_if(c, std::move(pred));
+}
+
+} // namespace gtl
+
+#endif // gtl_int_hash_map_hpp_guard_
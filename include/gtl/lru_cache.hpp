@@ -11,11 +11,28 @@
 //      https://www.apache.org/licenses/LICENSE-2.0
 // ---------------------------------------------------------------------------
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <list>
+#include <memory>
+#include <new>
 #include <optional>
-#include "atomic_queue/atomic_queue.h"
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "gtl/cache_stats.hpp"
+#include "gtl/delay_queue.hpp"
+#include "gtl/epoch.hpp"
 #include "gtl/phmap.hpp"
 
 
@@ -23,111 +40,2072 @@
 namespace gtl {
 
 // ------------------------------------------------------------------------------
+// The weight of each entry is 1, so the cache size is a number of entries.
+// ------------------------------------------------------------------------------
+struct unit_weigher
+{
+    template<class K, class V>
+    size_t operator()(const K&, const V&) const
+    {
+        return 1;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// `Weigher` returns the weight of an entry (for example the number of bytes it
+// uses) from its key and value, and must always return the same weight for the
+// same entry. The cache then evicts the least recently used entries of a
+// submap (as many as needed) when the total weight of the submap exceeds
+// `max_size / num_submaps`. With the default `unit_weigher`, `max_size` is
+// the maximum number of entries.
+//
+// With `GlobalCapacity`, `max_size` bounds the total weight of all the submaps
+// instead, so that a submap receiving more keys than the others (a skewed key
+// distribution) can use the space the other ones don't need. The total weight
+// is an atomic counter. Each entry records the value of an access counter when
+// it was last inserted or hit, and the counter values of the least recently
+// used entry of each submap are kept in a contiguous array (8 bytes per
+// submap). When an insert takes the total weight over `max_size`, the
+// inserting thread, after releasing its submap's lock, scans this array and
+// evicts the least recently used entry of the submap whose entry is the
+// oldest, until the total is within budget.
+//
+// Sampling a few submaps instead of scanning them all would drain the lightly
+// loaded submaps as fast as the busy ones, which defeats the purpose. Only
+// inserts increment the access counter, and without an atomic read-modify-write
+// (concurrent inserts may get the same value), so the entries hit or inserted
+// at about the same time look equally old to the eviction.
+//
+// With `Stats = cache_counters`, `stats()` returns the number of hits, misses,
+// insertions and evictions, and the age of the evicted entries.
+// ------------------------------------------------------------------------------
+template<class K,
+         class V,
+         size_t N            = 4,
+         class Hash          = gtl::Hash<K>,
+         class Eq            = std::equal_to<K>,
+         class Mutex         = std::mutex,
+         class Weigher       = unit_weigher,
+         bool GlobalCapacity = false,
+         class Stats         = no_cache_stats>
+class lru_cache_impl
+{
+public:
+    using key_type     = K;
+    using result_type  = V;
+    using value_type   = typename std::pair<const key_type, result_type>;
+    using weigher_type = Weigher;
+
+private:
+    // an entry with its last access time, for `GlobalCapacity`, and its
+    // insertion time, for `Stats`
+    struct stamped_value : public value_type
+    {
+        using value_type::value_type;
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS std::conditional_t<GlobalCapacity, uint64_t, priv::empty> stamp{};
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Stats::entry_data                             stats;
+    };
+
+public:
+    using list_type = std::list<std::conditional_t<GlobalCapacity || Stats::enabled, stamped_value, value_type>>;
+    using list_iter = typename list_type::iterator;
+
+private:
+    static constexpr uint64_t no_stamp = std::numeric_limits<uint64_t>::max();
+
+    // the AuxCont of each submap
+    struct lru_list : public list_type
+    {
+        size_t                weight = 0; // sum of the weights of the entries
+        std::vector<key_type> evicted;    // erased from the hash map after an insert
+        size_t                idx    = 0; // index of the submap, for `GlobalCapacity`
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS Stats stats; // not reset by `clear()`
+
+        void clear()
+        {
+            list_type::clear();
+            weight = 0;
+        }
+    };
+
+public:
+    using map_type = gtl::parallel_flat_hash_map<K,
+                                                 list_iter,
+                                                 Hash,
+                                                 Eq,
+                                                 std::allocator<std::pair<const key_type, list_iter>>,
+                                                 N,
+                                                 Mutex,
+                                                 lru_list>;
+
+    static constexpr size_t num_submaps = map_type::subcnt();
+
+    // because the cache is sharded (multiple submaps and sublists)
+    // the max_size is an approximation, unless `GlobalCapacity` is set.
+    // ------------------------------------------------------------
+    lru_cache_impl(size_t max_size = 65536, const Weigher& weigher = Weigher())
+        : _weigher(weigher)
+    {
+        if constexpr (std::is_same_v<Weigher, unit_weigher>)
+            reserve(max_size);
+        set_cache_size(max_size);
+        assert(_max_size > 2);
+        if constexpr (GlobalCapacity) {
+            for (size_t s = 0; s < num_submaps; ++s) {
+                _cache.get_inner(s).aux_.idx = s;
+                _oldest[s].store(no_stamp, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool exists(const K& k)
+    {
+        return _cache.if_contains(k, [&](const auto&, lru_list&) {});
+    }
+
+    // the hit reorders the submap's list, so it takes the submap's exclusive
+    // lock (see `mt_sieve_cache` for hits under a shared lock)
+    std::optional<result_type> get(const K& k)
+    {
+        if (result_type res; _cache.modify_if(k, [&](const auto& v, lru_list& l) {
+                res = v.second->second;
+                move_to_front(l, v.second, [&] { return _clock.load(std::memory_order_relaxed); });
+                l.stats.on_hit();
+            }))
+            return { res };
+        if constexpr (Stats::enabled)
+            stats_of(k).on_miss();
+        return std::nullopt;
+    }
+
+    template<class Val>
+    void insert(const K& key, Val&& value)
+    {
+        _cache.lazy_emplace_l(
+            key,
+            [&](typename map_type::value_type& v, lru_list& l) {
+                // called only when key was already present. If the new value is
+                // heavier, the oldest entries are evicted as for a new key (with
+                // `GlobalCapacity`, below, once the submap is unlocked).
+                size_t old_weight = weigh(*v.second);
+                v.second->second  = std::forward<Val>(value);
+                if (size_t new_weight = weigh(*v.second); new_weight != old_weight) {
+                    add_weight(l, new_weight);
+                    sub_weight(l, old_weight);
+                }
+                move_to_front(l, v.second, [&] { return next_stamp(); });
+                if constexpr (!GlobalCapacity && !std::is_same_v<Weigher, unit_weigher>)
+                    return evict_over_budget(l);
+            },
+            [&](const typename map_type::constructor& ctor, lru_list& l) {
+                // construct value_type in place when key not present
+                l.emplace_front(key, std::forward<Val>(value));
+                add_weight(l, weigh(l.front()));
+                ctor(key, l.begin());
+                if constexpr (Stats::enabled)
+                    l.stats.on_insert(l.front().stats);
+
+                if constexpr (GlobalCapacity) {
+                    // evicted below, once the submap is unlocked
+                    l.front().stamp = next_stamp();
+                    if (l.size() == 1)
+                        set_oldest(l);
+                    return std::optional<key_type>{};
+                } else if constexpr (std::is_same_v<Weigher, unit_weigher>) {
+                    if (l.weight > _max_size) {
+                        // remove oldest
+                        --l.weight;
+                        on_evict(l);
+                        auto to_delete = std::move(l.back().first);
+                        l.pop_back();
+                        return std::optional<key_type>{ to_delete };
+                    }
+                    return std::optional<key_type>{};
+                } else {
+                    // remove the oldest entries (possibly the new one, if it weighs
+                    // more than the budget) until the submap is within budget
+                    return evict_over_budget(l);
+                }
+            });
+        if constexpr (GlobalCapacity)
+            evict_global();
+    }
+
+    void clear()
+    {
+        if constexpr (GlobalCapacity) {
+            for (size_t s = 0; s < num_submaps; ++s) {
+                _cache.with_submap_m(s, [&](typename map_type::EmbeddedSet& set) {
+                    lru_list& l = _cache.get_inner(s).aux_;
+                    _weight.fetch_sub(l.weight, std::memory_order_relaxed);
+                    set.clear();
+                    l.clear();
+                    set_oldest(l);
+                });
+            }
+        } else {
+            _cache.clear();
+        }
+    }
+
+    void reserve(size_t n) { _cache.reserve(size_t(n * 1.1f)); }
+
+    // with `GlobalCapacity`, a smaller size takes effect at the next insert
+    void set_cache_size(size_t max_size) { _max_size = GlobalCapacity ? max_size : max_size / num_submaps; }
+
+    size_t size() const { return _cache.size(); }
+
+    // the total weight of the entries (their number with `unit_weigher`)
+    size_t weight() const
+    {
+        if constexpr (GlobalCapacity) {
+            return _weight.load(std::memory_order_relaxed);
+        } else {
+            auto&  cache = const_cast<map_type&>(_cache);
+            size_t res   = 0;
+            for (size_t s = 0; s < num_submaps; ++s)
+                cache.with_submap(s, [&](const auto&) { res += cache.get_inner(s).aux_.weight; });
+            return res;
+        }
+    }
+
+    // the sum of the counters of the submaps (all zero unless `Stats` is enabled)
+    cache_stats stats() const
+    {
+        cache_stats res;
+        for (size_t s = 0; s < num_submaps; ++s)
+            const_cast<map_type&>(_cache).get_inner(s).aux_.stats.add_to(res);
+        return res;
+    }
+
+    void reset_stats()
+    {
+        for (size_t s = 0; s < num_submaps; ++s)
+            _cache.get_inner(s).aux_.stats.reset();
+    }
+
+private:
+    size_t weigh(const value_type& v) const { return _weigher(v.first, v.second); }
+
+    // the counters of the submap of `k`, for the misses, which don't lock it
+    Stats& stats_of(const K& k) { return _cache.get_inner(map_type::subidx(_cache.hash(k))).aux_.stats; }
+
+    // the last entry of `l` is evicted
+    void on_evict(lru_list& l)
+    {
+        if constexpr (Stats::enabled)
+            l.stats.on_evict(l.back().stats);
+    }
+
+    // collects the keys of the oldest entries of `l` until its weight is within
+    // budget, and only then removes these entries, so that `l` is unchanged if
+    // copying a key throws. The keys are still to be erased from the hash map.
+    std::span<const key_type> evict_over_budget(lru_list& l)
+    {
+        l.evicted.clear();
+        size_t weight = l.weight;
+        for (auto it = l.end(); weight > _max_size;) {
+            --it;
+            weight -= weigh(*it);
+            l.evicted.push_back(it->first);
+        }
+        for (size_t i = 0; i < l.evicted.size(); ++i) {
+            on_evict(l);
+            l.pop_back();
+        }
+        l.weight = weight;
+        return std::span<const key_type>(l.evicted);
+    }
+
+    void add_weight(lru_list& l, size_t w)
+    {
+        l.weight += w;
+        if constexpr (GlobalCapacity)
+            _weight.fetch_add(w, std::memory_order_relaxed);
+    }
+
+    void sub_weight(lru_list& l, size_t w)
+    {
+        l.weight -= w;
+        if constexpr (GlobalCapacity)
+            _weight.fetch_sub(w, std::memory_order_relaxed);
+    }
+
+    // moves the entry `it` which was just hit to the front of `l`. With
+    // `GlobalCapacity`, stamps it with `stamp()`, and only reads the (likely
+    // not cached) last entry if `it` was the last one.
+    template<class F>
+    void move_to_front(lru_list& l, list_iter it, F&& stamp)
+    {
+        if constexpr (GlobalCapacity) {
+            bool was_last = std::next(it) == l.end();
+            it->stamp     = stamp();
+            l.splice(l.begin(), l, it);
+            if (was_last)
+                set_oldest(l);
+        } else {
+            l.splice(l.begin(), l, it);
+        }
+    }
+
+    uint64_t next_stamp()
+    {
+        uint64_t stamp = _clock.load(std::memory_order_relaxed);
+        _clock.store(stamp + 1, std::memory_order_relaxed);
+        return stamp;
+    }
+
+    // publishes the stamp of the last entry of `l`
+    void set_oldest(const lru_list& l)
+    {
+        _oldest[l.idx].store(l.empty() ? no_stamp : l.back().stamp, std::memory_order_relaxed);
+    }
+
+    // evicts the least recently used entry of the submap whose last entry is
+    // the oldest, until the total weight is within `_max_size`.
+    void evict_global()
+    {
+        while (_weight.load(std::memory_order_relaxed) > _max_size) {
+            size_t   victim = num_submaps;
+            uint64_t oldest = no_stamp;
+            for (size_t s = 0; s < num_submaps; ++s) {
+                uint64_t stamp = _oldest[s].load(std::memory_order_relaxed);
+                if (stamp < oldest) {
+                    oldest = stamp;
+                    victim = s;
+                }
+            }
+            if (victim == num_submaps)
+                return; // all the submaps are empty, or being filled by other threads
+
+            _cache.with_submap_m(victim, [&](typename map_type::EmbeddedSet& set) {
+                lru_list& l = _cache.get_inner(victim).aux_;
+                if (l.empty() || _weight.load(std::memory_order_relaxed) <= _max_size)
+                    return;
+                size_t w = weigh(l.back());
+                on_evict(l);
+                set.erase(l.back().first);
+                l.pop_back();
+                sub_weight(l, w);
+                set_oldest(l);
+            });
+        }
+    }
+
+    using stamps = std::array<std::atomic<uint64_t>, num_submaps>;
+
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS Weigher _weigher;
+    size_t                                  _max_size;
+    map_type                                _cache;
+
+    // for `GlobalCapacity`
+    std::atomic<size_t>   _weight{ 0 }; // sum of the weights of all the entries
+    std::atomic<uint64_t> _clock{ 0 };  // access counter
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS std::conditional_t<GlobalCapacity, stamps, priv::empty> _oldest;
+};
+
+// ------------------------------------------------------------------------------
+// test lru_cache_test.cpp will only pass if N==0 as it checks exact numbers
+// of items remaining in (or expunged from) cache.
+//
+// but it is fine to use a larger N for real-life applications, although it is
+// mostly useful in multi threaded contexts (when using std::mutex).
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using lru_cache = lru_cache_impl<K, V, 0, Hash, Eq, gtl::NullMutex>;
+
+// ------------------------------------------------------------------------------
+// uses std::mutex by default
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_lru_cache = lru_cache_impl<K, V, 6, Hash, Eq, std::mutex>;
+
+// ------------------------------------------------------------------------------
+// bounded by the total weight of the entries, as returned by `Weigher`
+// ------------------------------------------------------------------------------
+template<class K, class V, class Weigher, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using weighted_lru_cache = lru_cache_impl<K, V, 0, Hash, Eq, gtl::NullMutex, Weigher>;
+
+template<class K, class V, class Weigher, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_weighted_lru_cache = lru_cache_impl<K, V, 6, Hash, Eq, std::mutex, Weigher>;
+
+// ------------------------------------------------------------------------------
+// `max_size` bounds the total number of entries, instead of the number of
+// entries of each submap
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_global_lru_cache = lru_cache_impl<K, V, 6, Hash, Eq, std::mutex, unit_weigher, true>;
+
+namespace priv {
+// an entry of `lru_cache_intrusive_impl`, as stored in its hash set: the index
+// of the entry's node
+struct lru_handle
+{
+    uint32_t idx;
+};
+
+inline constexpr uint32_t lru_nil = (std::numeric_limits<uint32_t>::max)();
+
+// a doubly linked list of nodes of `lru_cache_intrusive_impl`
+struct lru_ends
+{
+    uint32_t head = lru_nil;
+    uint32_t tail = lru_nil;
+};
+
+// ------------------------------------------------------------------------------
+// Gives the eviction policies access to the prev/next links and to the
+// `Policy::node_data` of the nodes of a `lru_cache_intrusive_impl`.
+// ------------------------------------------------------------------------------
+template<class Node>
+struct lru_links
+{
+    Node* nodes;
+
+    uint32_t prev(uint32_t i) const { return nodes[i].prev; }
+    uint32_t next(uint32_t i) const { return nodes[i].next; }
+    auto&    data(uint32_t i) const { return nodes[i].data; }
+
+    void push_front(lru_ends& l, uint32_t i) const
+    {
+        Node& n = nodes[i];
+        n.prev  = lru_nil;
+        n.next  = l.head;
+        if (l.head != lru_nil)
+            nodes[l.head].prev = i;
+        else
+            l.tail = i;
+        l.head = i;
+    }
+
+    void unlink(lru_ends& l, uint32_t i) const
+    {
+        Node& n = nodes[i];
+        if (n.prev != lru_nil)
+            nodes[n.prev].next = n.next;
+        else
+            l.head = n.next;
+        if (n.next != lru_nil)
+            nodes[n.next].prev = n.prev;
+        else
+            l.tail = n.prev;
+    }
+
+    void move_to_front(lru_ends& l, uint32_t i) const
+    {
+        if (l.head != i) {
+            unlink(l, i);
+            push_front(l, i);
+        }
+    }
+};
+
+// the links passed by a policy wrapper to the policy it wraps: `data(i)` is the
+// wrapped policy's part of the node data.
+template<class Links>
+struct lru_base_links : Links
+{
+    auto& data(uint32_t i) const { return Links::data(i).base; }
+};
+
+// the evicted nodes of a submap (chained by their `next` link), as returned to
+// `lazy_emplace_l` so that their handles get erased from the hash set.
+template<class Node>
+struct lru_pending
+{
+    struct iterator
+    {
+        lru_handle operator*() const { return { i }; }
+        iterator&  operator++()
+        {
+            i = nodes[i].next;
+            return *this;
+        }
+        bool operator==(const iterator& o) const { return i == o.i; }
+
+        const Node* nodes;
+        uint32_t    i;
+    };
+
+    iterator begin() const { return { nodes, first }; }
+    iterator end() const { return { nodes, lru_nil }; }
+
+    const Node* nodes;
+    uint32_t    first;
+};
+
+// defaults for the optional members of the eviction policies
+struct lru_policy_base
+{
+    using weigher_type = unit_weigher;
+
+    template<class ListData>
+    static void set_capacity(ListData&, size_t)
+    {
+    }
+
+    template<class NodeData, class F>
+    static void for_each_node_index(NodeData&, F&&)
+    {
+    }
+};
+} // namespace priv
+
+// ------------------------------------------------------------------------------
+// Eviction policies of `lru_cache_intrusive_impl`. A policy provides:
+//   - `shared_hit`: true if `on_hit` may run concurrently for entries of the
+//     same submap, so that `get()` only takes the submap's shared lock.
+//   - `node_data` / `list_data`: per entry and per submap state.
+//   - `set_capacity(list_data&, max_size)`: the submap holds up to `max_size`
+//     entries (called on an empty submap, and when the cache is resized).
+//   - `on_insert(links, list_data&, i, key_hash)`: links the new entry `i`.
+//     `key_hash()` returns the hash of its key, if the policy needs it.
+//   - `on_hit(links, list_data&, i)`: entry `i` was found by `get()` or `insert()`.
+//   - `evict(links, list_data&)`: unlinks and returns the entry to evict.
+//   - `remove(links, list_data&, i)`: unlinks entry `i`, which is removed from
+//     the cache for another reason (e.g. it expired).
+//   - `for_each_list(list_data&, f)`: calls `f(lru_ends&)` for each list of
+//     entries, and `for_each_index(list_data&, f)` calls `f(uint32_t&)` for
+//     each node index stored in `list_data` (used to relocate the nodes).
+//   - `for_each_node_index(node_data&, f)`: same for the node indices stored
+//     in `node_data`.
+// `set_capacity` and `for_each_node_index` default to doing nothing, for
+// policies deriving from `priv::lru_policy_base`.
+//
+// A policy which also has `set_cost(links, list_data&, i, cost, weight)` is
+// told, just after `on_insert`, the cost of computing the value (in ns, as
+// measured by `get_or_insert()`, or 1 for values passed to `insert()`), and
+// the weight of the entry, given by the cache's instance of the policy's
+// `weigher_type` (`unit_weigher` by default).
+// ------------------------------------------------------------------------------
+
+// ------------------------------------------------------------------------------
+// Least recently used: a hit moves the entry to the front of its submap's list,
+// so `get()` needs the submap's exclusive lock.
+// ------------------------------------------------------------------------------
+struct lru_policy : priv::lru_policy_base
+{
+    static constexpr bool shared_hit = false;
+
+    struct node_data
+    {};
+
+    struct list_data
+    {
+        priv::lru_ends lru; // head is the most recently used
+    };
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&&)
+    {
+        ln.push_front(d.lru, i);
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data& d, uint32_t i)
+    {
+        ln.move_to_front(d.lru, i);
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t victim = d.lru.tail;
+        ln.unlink(d.lru, victim);
+        return victim;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        ln.unlink(d.lru, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        f(d.lru);
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        f(d.lru.head);
+        f(d.lru.tail);
+    }
+};
+
+// ------------------------------------------------------------------------------
+// SIEVE (Zhang et al., "SIEVE is Simpler than LRU", NSDI '24): entries stay in
+// insertion order and a hit only sets the entry's `visited` bit, so `get()`
+// runs under the submap's shared lock when `Mutex` has one (e.g.
+// `std::shared_mutex`). To evict, a hand moves from the oldest entry towards
+// the newest, clearing the visited bits it passes, and evicts the first entry
+// whose bit is clear. The hand stays where it stopped for the next eviction.
+// Hit ratios are on par with or better than LRU on most web and key-value
+// traces.
+// ------------------------------------------------------------------------------
+struct sieve_policy : priv::lru_policy_base
+{
+    static constexpr bool shared_hit = true;
+
+    struct node_data
+    {
+        node_data() = default;
+        node_data(const node_data& o)
+            : visited(o.visited.load(std::memory_order_relaxed))
+        {
+        }
+        node_data& operator=(const node_data& o)
+        {
+            visited.store(o.visited.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        std::atomic<uint8_t> visited{ 0 };
+    };
+
+    struct list_data
+    {
+        priv::lru_ends fifo;                 // head is the most recently inserted
+        uint32_t       hand = priv::lru_nil; // lru_nil: start from the tail
+    };
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&&)
+    {
+        ln.data(i).visited.store(0, std::memory_order_relaxed);
+        ln.push_front(d.fifo, i);
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data&, uint32_t i)
+    {
+        // read first, so that hot entries don't keep their cache line dirty
+        auto& visited = ln.data(i).visited;
+        if (!visited.load(std::memory_order_relaxed))
+            visited.store(1, std::memory_order_relaxed);
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t i = d.hand != priv::lru_nil ? d.hand : d.fifo.tail;
+        while (ln.data(i).visited.load(std::memory_order_relaxed)) {
+            ln.data(i).visited.store(0, std::memory_order_relaxed);
+            i = ln.prev(i);
+            if (i == priv::lru_nil)
+                i = d.fifo.tail;
+        }
+        d.hand = ln.prev(i);
+        ln.unlink(d.fifo, i);
+        return i;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        if (d.hand == i)
+            d.hand = ln.prev(i);
+        ln.unlink(d.fifo, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        f(d.fifo);
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        f(d.fifo.head);
+        f(d.fifo.tail);
+        f(d.hand);
+    }
+};
+
+// ------------------------------------------------------------------------------
+// Segmented LRU: new entries go to the front of a probation list, and a hit in
+// probation promotes the entry to a protected list (80% of the submap). When
+// the protected list is full, its least recently used entry is demoted back to
+// the front of probation. Entries are evicted from the tail of probation, so an
+// entry hit at least twice is only evicted after the entries hit once, and a
+// burst of new keys (e.g. a scan) can't flush the protected entries. Hits
+// reorder the lists, so they need the submap's exclusive lock.
+// ------------------------------------------------------------------------------
+struct slru_policy : priv::lru_policy_base
+{
+    static constexpr bool shared_hit = false;
+
+    enum segment : uint8_t
+    {
+        probation,
+        protect
+    };
+
+    struct node_data
+    {
+        segment seg;
+    };
+
+    struct list_data
+    {
+        priv::lru_ends lists[2]; // indexed by `segment`, heads are the most recently used
+        uint32_t       sizes[2]      = { 0, 0 };
+        uint32_t       protected_max = 0;
+    };
+
+    static void set_capacity(list_data& d, size_t max_size)
+    {
+        d.protected_max = static_cast<uint32_t>(max_size * 4 / 5);
+    }
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&&)
+    {
+        push_front(ln, d, probation, i);
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data& d, uint32_t i)
+    {
+        if (ln.data(i).seg == probation) {
+            unlink(ln, d, i);
+            push_front(ln, d, protect, i);
+            if (d.sizes[protect] > d.protected_max) {
+                uint32_t demoted = d.lists[protect].tail;
+                unlink(ln, d, demoted);
+                push_front(ln, d, probation, demoted);
+            }
+        } else {
+            ln.move_to_front(d.lists[protect], i);
+        }
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t victim = d.sizes[probation] ? d.lists[probation].tail : d.lists[protect].tail;
+        unlink(ln, d, victim);
+        return victim;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        unlink(ln, d, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        for (auto& l : d.lists)
+            f(l);
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        for (auto& l : d.lists) {
+            f(l.head);
+            f(l.tail);
+        }
+    }
+
+private:
+    template<class Links>
+    static void push_front(const Links& ln, list_data& d, segment seg, uint32_t i)
+    {
+        ln.data(i).seg = seg;
+        ln.push_front(d.lists[seg], i);
+        ++d.sizes[seg];
+    }
+
+    template<class Links>
+    static void unlink(const Links& ln, list_data& d, uint32_t i)
+    {
+        segment seg = ln.data(i).seg;
+        ln.unlink(d.lists[seg], i);
+        --d.sizes[seg];
+    }
+};
+
+namespace priv {
+// ------------------------------------------------------------------------------
+// Count-min sketch of 4 bit counters, estimating how often a hash was seen
+// recently. The 4 counters of a hash are in the same 64 bit word (one per
+// group of 4 nibbles), so that an update touches a single cache line. All the
+// counters are halved once the number of increments reaches 10 times the
+// capacity, so that old frequencies fade.
+// ------------------------------------------------------------------------------
+class frequency_sketch
+{
+public:
+    void set_capacity(size_t capacity)
+    {
+        size_t words = std::bit_ceil((std::max)(capacity, size_t(8)));
+        if (words != _table.size()) {
+            _table.assign(words, 0);
+            _shift   = 64 - std::countr_zero(words);
+            _samples = 0;
+        }
+        _sample_size = 10 * (std::max)(capacity, size_t(1));
+    }
+
+    void increment(uint32_t h)
+    {
+        uint64_t& w     = _table[word(h)];
+        bool      added = false;
+        for (uint32_t row = 0; row < 4; ++row) {
+            uint32_t shift = nibble(h, row);
+            if (((w >> shift) & 0xf) != 0xf) {
+                w += uint64_t(1) << shift;
+                added = true;
+            }
+        }
+        if (added && ++_samples >= _sample_size)
+            age();
+    }
+
+    uint32_t estimate(uint32_t h) const
+    {
+        uint64_t w   = _table[word(h)];
+        uint32_t res = 0xf;
+        for (uint32_t row = 0; row < 4; ++row)
+            res = (std::min)(res, uint32_t((w >> nibble(h, row)) & 0xf));
+        return res;
+    }
+
+private:
+    size_t word(uint32_t h) const { return size_t(((uint64_t(h) + 1) * 0x9E3779B97F4A7C15ULL) >> _shift); }
+
+    // bit offset of the counter of `row`, within the nibbles [4 * row, 4 * row + 4)
+    static uint32_t nibble(uint32_t h, uint32_t row) { return (row * 4 + ((h >> (row * 8)) & 3)) * 4; }
+
+    void age()
+    {
+        for (auto& w : _table)
+            w = (w >> 1) & 0x7777777777777777ULL;
+        _samples /= 2;
+    }
+
+    std::vector<uint64_t> _table;
+    int                   _shift       = 64;
+    size_t                _samples     = 0;
+    size_t                _sample_size = 0;
+};
+} // namespace priv
+
+// ------------------------------------------------------------------------------
+// W-TinyLFU (Einziger et al., "TinyLFU: A Highly Efficient Cache Admission
+// Policy", 2017), as used by Caffeine: new entries go to a small LRU window
+// (1% of the submap). The entry leaving the window is a candidate for the main
+// segmented LRU, made of a probation and a protected (80%) segment. When the
+// submap is full, the candidate only evicts the least recently used entry of
+// the probation segment if the frequency sketch estimates that the candidate
+// was seen more often; otherwise the candidate itself is evicted. A hit in
+// probation promotes the entry to protected.
+//
+// So entries touched once (as in a scan over all the keys) don't flush the
+// frequently used ones out of the cache. Hits reorder the segments, so they
+// need the submap's exclusive lock.
+// ------------------------------------------------------------------------------
+struct tinylfu_policy : priv::lru_policy_base
+{
+    static constexpr bool shared_hit = false;
+
+    enum segment : uint8_t
+    {
+        window,
+        probation,
+        protect
+    };
+
+    struct node_data
+    {
+        uint32_t hash;
+        segment  seg;
+    };
+
+    struct list_data
+    {
+        priv::lru_ends         lists[3]; // indexed by `segment`, heads are the most recently used
+        uint32_t               sizes[3]      = { 0, 0, 0 };
+        uint32_t               window_max    = 1;
+        uint32_t               protected_max = 0;
+        uint32_t               candidate     = priv::lru_nil; // left the window during the last insert
+        priv::frequency_sketch sketch;
+    };
+
+    static void set_capacity(list_data& d, size_t max_size)
+    {
+        d.window_max    = static_cast<uint32_t>((std::max)(max_size / 100, size_t(1)));
+        d.protected_max = static_cast<uint32_t>((max_size - (std::min)(max_size, size_t(d.window_max))) * 4 / 5);
+        d.sketch.set_capacity(max_size);
+    }
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&& key_hash)
+    {
+        size_t h         = key_hash();
+        ln.data(i).hash  = static_cast<uint32_t>(h ^ (h >> 32));
+        d.sketch.increment(ln.data(i).hash);
+        push_front(ln, d, window, i);
+
+        d.candidate = priv::lru_nil;
+        if (d.sizes[window] > d.window_max) {
+            d.candidate = d.lists[window].tail;
+            unlink(ln, d, d.candidate);
+            push_front(ln, d, probation, d.candidate);
+        }
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data& d, uint32_t i)
+    {
+        d.sketch.increment(ln.data(i).hash);
+        segment seg = ln.data(i).seg;
+        if (seg == probation) {
+            unlink(ln, d, i);
+            push_front(ln, d, protect, i);
+            if (d.sizes[protect] > d.protected_max) {
+                uint32_t demoted = d.lists[protect].tail;
+                unlink(ln, d, demoted);
+                push_front(ln, d, probation, demoted);
+            }
+        } else {
+            ln.move_to_front(d.lists[seg], i);
+        }
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t victim    = d.lists[probation].tail;
+        uint32_t candidate = d.candidate;
+        d.candidate        = priv::lru_nil;
+
+        if (victim == priv::lru_nil) {
+            // the main segment is all protected
+            victim = d.sizes[window] ? d.lists[window].tail : d.lists[protect].tail;
+        } else if (candidate != priv::lru_nil && candidate != victim &&
+                   d.sketch.estimate(ln.data(candidate).hash) <= d.sketch.estimate(ln.data(victim).hash)) {
+            victim = candidate;
+        }
+        unlink(ln, d, victim);
+        return victim;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        if (d.candidate == i)
+            d.candidate = priv::lru_nil;
+        unlink(ln, d, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        for (auto& l : d.lists)
+            f(l);
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        for (auto& l : d.lists) {
+            f(l.head);
+            f(l.tail);
+        }
+        f(d.candidate);
+    }
+
+private:
+    template<class Links>
+    static void push_front(const Links& ln, list_data& d, segment seg, uint32_t i)
+    {
+        ln.data(i).seg = seg;
+        ln.push_front(d.lists[seg], i);
+        ++d.sizes[seg];
+    }
+
+    template<class Links>
+    static void unlink(const Links& ln, list_data& d, uint32_t i)
+    {
+        segment seg = ln.data(i).seg;
+        ln.unlink(d.lists[seg], i);
+        --d.sizes[seg];
+    }
+};
+
+// ------------------------------------------------------------------------------
+// GreedyDual-Size-Frequency (Cherkasova): each entry has a priority
+// `L + frequency * cost / weight`, where `cost` is the time it took to compute
+// its value, `weight` its size (from the cache's `Weigher`, passed to the
+// constructor of `lru_cache_intrusive_impl` or `mt_memoize_lru`), and
+// `frequency` its number of hits plus one. The entry with the lowest priority
+// is evicted, and `L` (which starts at 0) becomes its priority, so that the
+// entries not hit for a while age compared to the newer ones. Entries which
+// were expensive to compute, small, or often hit survive longer.
+//
+// Each submap keeps its entries in a binary heap ordered by priority (and in
+// a list from the most to the least recently used, to visit them in order),
+// so an eviction or a hit costs O(log(entries)).
+// ------------------------------------------------------------------------------
+template<class Weigher = unit_weigher>
+struct gdsf_policy : priv::lru_policy_base
+{
+    using weigher_type = Weigher;
+
+    static constexpr bool shared_hit = false;
+
+    struct node_data
+    {
+        double   priority;
+        float    cost_per_weight;
+        uint32_t frequency;
+        uint32_t heap_pos;
+    };
+
+    struct list_data
+    {
+        priv::lru_ends        list;
+        std::vector<uint32_t> heap;            // node indices, lowest priority first
+        double                inflation = 0.0; // `L`, the priority of the last evicted entry
+    };
+
+    static void set_capacity(list_data& d, size_t max_size) { d.heap.reserve(max_size + 1); }
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&&)
+    {
+        auto& n           = ln.data(i);
+        n.cost_per_weight = 1;
+        n.frequency       = 1;
+        n.priority        = d.inflation + 1;
+        n.heap_pos        = static_cast<uint32_t>(d.heap.size());
+        d.heap.push_back(i);
+        sift_up(ln, d, n.heap_pos);
+        ln.push_front(d.list, i);
+    }
+
+    template<class Links>
+    static void set_cost(const Links& ln, list_data& d, uint32_t i, double cost, size_t weight)
+    {
+        auto& n           = ln.data(i);
+        n.cost_per_weight = static_cast<float>(cost / double((std::max)(weight, size_t(1))));
+        update(ln, d, i);
+    }
+
+    // the cost given to `set_cost()` (rounded), for an entry of this `weight`
+    static double cost(const node_data& n, size_t weight)
+    {
+        return double(n.cost_per_weight) * double((std::max)(weight, size_t(1)));
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data& d, uint32_t i)
+    {
+        ++ln.data(i).frequency;
+        update(ln, d, i);
+        ln.move_to_front(d.list, i);
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t victim = d.heap.front();
+        d.inflation     = ln.data(victim).priority;
+        remove(ln, d, victim);
+        return victim;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        uint32_t pos  = ln.data(i).heap_pos;
+        uint32_t last = d.heap.back();
+        d.heap.pop_back();
+        if (last != i) {
+            d.heap[pos]             = last;
+            ln.data(last).heap_pos = pos;
+            sift_up(ln, d, pos);
+            sift_down(ln, d, ln.data(last).heap_pos);
+        }
+        ln.unlink(d.list, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        f(d.list);
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        f(d.list.head);
+        f(d.list.tail);
+        for (auto& i : d.heap)
+            f(i);
+    }
+
+private:
+    template<class Links>
+    static void update(const Links& ln, list_data& d, uint32_t i)
+    {
+        auto& n    = ln.data(i);
+        n.priority = d.inflation + double(n.frequency) * n.cost_per_weight;
+        sift_up(ln, d, n.heap_pos);
+        sift_down(ln, d, n.heap_pos);
+    }
+
+    template<class Links>
+    static void sift_up(const Links& ln, list_data& d, uint32_t pos)
+    {
+        uint32_t i = d.heap[pos];
+        double   p = ln.data(i).priority;
+        while (pos > 0) {
+            uint32_t parent = (pos - 1) / 2;
+            uint32_t j      = d.heap[parent];
+            if (ln.data(j).priority <= p)
+                break;
+            d.heap[pos]         = j;
+            ln.data(j).heap_pos = pos;
+            pos                 = parent;
+        }
+        d.heap[pos]         = i;
+        ln.data(i).heap_pos = pos;
+    }
+
+    template<class Links>
+    static void sift_down(const Links& ln, list_data& d, uint32_t pos)
+    {
+        uint32_t i    = d.heap[pos];
+        double   p    = ln.data(i).priority;
+        uint32_t size = static_cast<uint32_t>(d.heap.size());
+        for (;;) {
+            uint32_t child = 2 * pos + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && ln.data(d.heap[child + 1]).priority < ln.data(d.heap[child]).priority)
+                ++child;
+            uint32_t j = d.heap[child];
+            if (p <= ln.data(j).priority)
+                break;
+            d.heap[pos]         = j;
+            ln.data(j).heap_pos = pos;
+            pos                 = child;
+        }
+        d.heap[pos]         = i;
+        ln.data(i).heap_pos = pos;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// Adds a per entry expiry to the eviction policy `Base`: see
+// `lru_cache_intrusive_impl::insert(key, value, ttl)`. `get()` treats expired
+// entries as misses, and the expired entries of a submap are evicted by the
+// next insert into that submap (or by `remove_expired()`).
+//
+// Each submap has a hierarchical timer wheel (Varghese & Lauck), so finding the
+// expired entries never needs a scan: 5 levels of 64 buckets, each level
+// covering 64 times the span of the previous one, starting with ~1ms buckets
+// (~67ms, ~4.3s, ~4.6min, ~4.9h and ~13 days per level). An entry goes into
+// the bucket of its expiry time in the lowest level that spans it. When the
+// wheel advances, the buckets it passes are emptied: their expired entries are
+// evicted, and the other ones are rescheduled into a lower level. Each entry
+// moves down at most 4 times.
+// ------------------------------------------------------------------------------
+template<class Base = lru_policy, class Clock = std::chrono::steady_clock>
+struct ttl_policy : priv::lru_policy_base
+{
+    using clock        = Clock;
+    using time_point   = typename Clock::time_point;
+    using duration     = typename Clock::duration;
+    using weigher_type = typename Base::weigher_type;
+
+    static constexpr bool shared_hit = Base::shared_hit;
+
+    static constexpr uint32_t num_levels  = 5;
+    static constexpr uint32_t level_bits  = 6; // 64 buckets per level
+    static constexpr uint32_t tick_bits   = 20; // a tick is 2^20 ns
+    static constexpr uint16_t not_in_wheel = 0xffff;
+
+    struct node_data
+    {
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Base::node_data base;
+
+        time_point expiry;
+        uint32_t   wheel_prev = priv::lru_nil;
+        uint32_t   wheel_next = priv::lru_nil;
+        uint16_t   bucket     = not_in_wheel;
+    };
+
+    struct list_data
+    {
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Base::list_data base;
+
+        uint64_t now_tick = 0; // the wheel's current time
+        uint32_t buckets[num_levels << level_bits];
+
+        list_data() { std::fill(std::begin(buckets), std::end(buckets), priv::lru_nil); }
+    };
+
+    static void set_capacity(list_data& d, size_t max_size) { Base::set_capacity(d.base, max_size); }
+
+    template<class Links, class KeyHash>
+    static void on_insert(const Links& ln, list_data& d, uint32_t i, KeyHash&& key_hash)
+    {
+        ln.data(i).bucket = not_in_wheel;
+        Base::on_insert(priv::lru_base_links<Links>{ ln }, d.base, i, std::forward<KeyHash>(key_hash));
+    }
+
+    template<class Links>
+    static void on_hit(const Links& ln, list_data& d, uint32_t i)
+    {
+        Base::on_hit(priv::lru_base_links<Links>{ ln }, d.base, i);
+    }
+
+    template<class Links>
+    static void set_cost(const Links& ln, list_data& d, uint32_t i, double cost, size_t weight)
+        requires requires(const priv::lru_base_links<Links>& bl) { Base::set_cost(bl, d.base, i, cost, weight); }
+    {
+        Base::set_cost(priv::lru_base_links<Links>{ ln }, d.base, i, cost, weight);
+    }
+
+    template<class Links>
+    static uint32_t evict(const Links& ln, list_data& d)
+    {
+        uint32_t i = Base::evict(priv::lru_base_links<Links>{ ln }, d.base);
+        unschedule(ln, d, i);
+        return i;
+    }
+
+    template<class Links>
+    static void remove(const Links& ln, list_data& d, uint32_t i)
+    {
+        Base::remove(priv::lru_base_links<Links>{ ln }, d.base, i);
+        unschedule(ln, d, i);
+    }
+
+    template<class F>
+    static void for_each_list(list_data& d, F&& f)
+    {
+        Base::for_each_list(d.base, std::forward<F>(f));
+    }
+
+    template<class F>
+    static void for_each_index(list_data& d, F&& f)
+    {
+        Base::for_each_index(d.base, f);
+        for (auto& b : d.buckets)
+            f(b);
+    }
+
+    template<class F>
+    static void for_each_node_index(node_data& n, F&& f)
+    {
+        Base::for_each_node_index(n.base, f);
+        f(n.wheel_prev);
+        f(n.wheel_next);
+    }
+
+    static bool expired(const node_data& n, time_point now) { return n.expiry <= now; }
+
+    // entry `i` expires at `expiry` (`time_point::max()`: never)
+    template<class Links>
+    static void set_expiry(const Links& ln, list_data& d, uint32_t i, time_point expiry)
+    {
+        unschedule(ln, d, i);
+        ln.data(i).expiry = expiry;
+        if (expiry != (time_point::max)())
+            schedule(ln, d, i);
+    }
+
+    // advances the wheel to `now`, calling `on_expired(i)` for each expired
+    // entry, after unlinking it.
+    template<class Links, class F>
+    static void expire(const Links& ln, list_data& d, time_point now, F&& on_expired)
+    {
+        const uint64_t prev = d.now_tick;
+        const uint64_t cur  = to_tick(now);
+        if (cur <= prev)
+            return;
+        d.now_tick = cur;
+
+        // higher levels first, so that their entries are rescheduled before the
+        // lower levels are processed
+        for (uint32_t level = num_levels; level-- > 0;) {
+            const uint32_t shift = level * level_bits;
+            const uint64_t lo    = prev >> shift;
+            const uint64_t hi    = cur >> shift;
+            if (lo == hi)
+                continue;
+            const uint64_t cnt = (std::min)(hi - lo + 1, uint64_t(1) << level_bits);
+            for (uint64_t t = hi + 1 - cnt; t <= hi; ++t) {
+                uint32_t& bucket = d.buckets[(level << level_bits) + (t & ((1 << level_bits) - 1))];
+                uint32_t  i      = bucket;
+                bucket           = priv::lru_nil;
+                while (i != priv::lru_nil) {
+                    node_data& n = ln.data(i);
+                    uint32_t   next = n.wheel_next;
+                    n.bucket        = not_in_wheel;
+                    if (expired(n, now)) {
+                        Base::remove(priv::lru_base_links<Links>{ ln }, d.base, i);
+                        on_expired(i);
+                    } else {
+                        schedule(ln, d, i);
+                    }
+                    i = next;
+                }
+            }
+        }
+    }
+
+private:
+    static uint64_t to_tick(time_point t)
+    {
+        return static_cast<uint64_t>(
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count()) >>
+               tick_bits;
+    }
+
+    template<class Links>
+    static void schedule(const Links& ln, list_data& d, uint32_t i)
+    {
+        node_data&     n     = ln.data(i);
+        const uint64_t tick  = (std::max)(to_tick(n.expiry), d.now_tick);
+        const uint64_t delta = tick - d.now_tick;
+        uint32_t       level = 0;
+        while (level + 1 < num_levels && (delta >> ((level + 1) * level_bits)) != 0)
+            ++level;
+
+        uint32_t  b      = (level << level_bits) + ((tick >> (level * level_bits)) & ((1 << level_bits) - 1));
+        uint32_t& bucket = d.buckets[b];
+        n.bucket         = static_cast<uint16_t>(b);
+        n.wheel_prev     = priv::lru_nil;
+        n.wheel_next     = bucket;
+        if (bucket != priv::lru_nil)
+            ln.data(bucket).wheel_prev = i;
+        bucket = i;
+    }
+
+    template<class Links>
+    static void unschedule(const Links& ln, list_data& d, uint32_t i)
+    {
+        node_data& n = ln.data(i);
+        if (n.bucket == not_in_wheel)
+            return;
+        if (n.wheel_prev != priv::lru_nil)
+            ln.data(n.wheel_prev).wheel_next = n.wheel_next;
+        else
+            d.buckets[n.bucket] = n.wheel_next;
+        if (n.wheel_next != priv::lru_nil)
+            ln.data(n.wheel_next).wheel_prev = n.wheel_prev;
+        n.bucket = not_in_wheel;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// Same interface and behavior as `lru_cache_impl`, but without any allocation
+// once constructed, and with each key stored only once.
+//
+// The entries live in a node array allocated upfront (`max_size / num_submaps +
+// 1` nodes per submap), each node holding the `std::pair<const K, V>` and the
+// prev/next indices of the submap's LRU list. The hash set only stores the
+// 4 byte index of the node (`lru_handle`): its hash and equality functors look
+// up the key in the node, so keys are not duplicated, and the list links never
+// need to be updated when the hash set is resized.
+//
+// `Policy` selects the entry evicted when a submap is full (`lru_policy`,
+// `sieve_policy`, `slru_policy`, `tinylfu_policy` or `gdsf_policy`, see
+// above), and can add an expiry to the entries (`ttl_policy`).
+//
+// Growing the cache with `set_cache_size()` reallocates the node array. As
+// with `reserve()`, it must not be called while other threads use the cache.
+//
+// With `Stats = cache_counters`, `stats()` also reports the time spent in the
+// functions computing the missing values of `get_or_insert()`.
 // ------------------------------------------------------------------------------
 template<class K,
          class V,
-         size_t N    = 4,
-         class Hash  = gtl::Hash<K>,
-         class Eq    = std::equal_to<K>,
-         class Mutex = std::mutex>
-class lru_cache_impl
+         size_t N     = 4,
+         class Hash   = gtl::Hash<K>,
+         class Eq     = std::equal_to<K>,
+         class Mutex  = std::mutex,
+         class Policy = lru_policy,
+         class Stats  = no_cache_stats>
+class lru_cache_intrusive_impl
 {
 public:
     using key_type    = K;
     using result_type = V;
-    using value_type  = typename std::pair<const key_type, result_type>;
+    using value_type   = typename std::pair<const key_type, result_type>;
+    using policy_type  = Policy;
+    using weigher_type = typename Policy::weigher_type;
+
+    // true if the entries can expire (`ttl_policy`)
+    static constexpr bool has_ttl = requires { typename Policy::clock; };
+
+private:
+    using handle = priv::lru_handle;
+
+    static constexpr uint32_t nil = priv::lru_nil;
+
+    struct node
+    {
+        uint32_t prev;
+        uint32_t next; // also links the free and the pending nodes
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Policy::node_data data;
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Stats::entry_data stats;
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+        value_type& value() { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+    };
+
+    using node_array = std::unique_ptr<node[]>;
+    using links      = priv::lru_links<node>;
+
+    // the AuxCont of each submap
+    struct lru_list
+    {
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS typename Policy::list_data lists;
+        uint32_t free    = nil; // unused nodes
+        uint32_t pending = nil; // evicted nodes, freed once erased from the hash set
+        uint32_t size    = 0;
+        GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS Stats stats; // not reset by `clear()`
+
+        void clear() {} // `lru_cache_intrusive_impl::clear()` releases the nodes
+    };
+
+    struct hasher
+    {
+        using is_transparent = void;
+
+        template<class Q>
+        size_t operator()(const Q& k) const
+        {
+            return hash(k);
+        }
+
+        size_t operator()(handle h) const { return hash((*nodes)[h.idx].value().first); }
+
+        const node_array* nodes = nullptr;
+        Hash              hash;
+    };
+
+    struct key_equal
+    {
+        using is_transparent = void;
+
+        bool operator()(handle a, handle b) const { return a.idx == b.idx; }
+
+        template<class Q>
+        bool operator()(handle a, const Q& k) const
+        {
+            return eq((*nodes)[a.idx].value().first, k);
+        }
+
+        template<class Q>
+        bool operator()(const Q& k, handle a) const
+        {
+            return eq(k, (*nodes)[a.idx].value().first);
+        }
+
+        const node_array* nodes = nullptr;
+        Eq                eq;
+    };
+
+    // the current time for `ttl_policy`, unused otherwise
+    static auto now()
+    {
+        if constexpr (has_ttl)
+            return Policy::clock::now();
+        else
+            return 0;
+    }
+
+    // the expiry of entries inserted without a ttl
+    static auto no_expiry()
+    {
+        if constexpr (has_ttl)
+            return (Policy::time_point::max)();
+        else
+            return 0;
+    }
+
+public:
+    using map_type =
+        gtl::parallel_flat_hash_set<handle, hasher, key_equal, std::allocator<handle>, N, Mutex, lru_list>;
+
+    static constexpr size_t num_submaps = map_type::subcnt();
+
+    // true if the policy weighs the entries by their cost (`gdsf_policy`)
+    static constexpr bool cost_aware = requires(const links& ln, typename Policy::list_data& d) {
+        Policy::set_cost(ln, d, uint32_t(0), 1.0, size_t(1));
+    };
+
+    // because the cache is sharded (multiple submaps and sublists)
+    // the max_size is an approximation. `weigher` gives the weight of the
+    // entries to a cost aware policy (`gdsf_policy<Weigher>`).
+    // ------------------------------------------------------------
+    lru_cache_intrusive_impl(size_t max_size = 65536, const weigher_type& weigher = weigher_type())
+        : _cache(0, hasher{ &_nodes, Hash() }, key_equal{ &_nodes, Eq() })
+        , _weigher(weigher)
+    {
+        reserve(max_size);
+        set_cache_size(max_size);
+        assert(_max_size > 2);
+    }
+
+    lru_cache_intrusive_impl(const lru_cache_intrusive_impl&)            = delete;
+    lru_cache_intrusive_impl& operator=(const lru_cache_intrusive_impl&) = delete;
+
+    ~lru_cache_intrusive_impl()
+    {
+        for (size_t s = 0; s < num_submaps; ++s)
+            destroy_nodes(_cache.get_inner(s).aux_);
+    }
+
+    bool exists(const K& k) { return exists_impl(k); }
+
+    std::optional<result_type> get(const K& k) { return get_impl(k); }
+
+    // same as `get()`, but neither counts a hit nor promotes the entry
+    std::optional<result_type> peek(const K& k) { return peek_impl(k); }
+
+    // lookups with a key of another type than `K`, which `Hash` and `Eq`
+    // accept without converting it when they are transparent
+    template<class Q>
+        requires requires { typename Hash::is_transparent; typename Eq::is_transparent; }
+    bool exists(const Q& k)
+    {
+        return exists_impl(k);
+    }
+
+    template<class Q>
+        requires requires { typename Hash::is_transparent; typename Eq::is_transparent; }
+    std::optional<result_type> get(const Q& k)
+    {
+        return get_impl(k);
+    }
+
+    template<class Q>
+        requires requires { typename Hash::is_transparent; typename Eq::is_transparent; }
+    std::optional<result_type> peek(const Q& k)
+    {
+        return peek_impl(k);
+    }
+
+    template<class Val>
+    void insert(const K& key, Val&& value)
+    {
+        insert_impl(
+            key,
+            store(std::forward<Val>(value)),
+            [&](Stats&) -> Val&& { return std::forward<Val>(value); },
+            no_expiry(),
+            1.0);
+    }
+
+    // same, but a new entry gets this `cost` instead of 1, as if computing it
+    // took `cost` ns (`cost_aware` policies only, see `for_each_oldest_first`)
+    template<class Val>
+    void insert(const K& key, Val&& value, double cost)
+        requires cost_aware
+    {
+        insert_impl(
+            key,
+            store(std::forward<Val>(value)),
+            [&](Stats&) -> Val&& { return std::forward<Val>(value); },
+            no_expiry(),
+            cost);
+    }
+
+    // inserts or updates `key`, which expires `ttl` from now (`ttl_policy` only)
+    template<class Val, class Rep, class Period>
+    void insert(const K& key, Val&& value, std::chrono::duration<Rep, Period> ttl)
+        requires has_ttl
+    {
+        insert_impl(
+            key,
+            store(std::forward<Val>(value)),
+            [&](Stats&) -> Val&& { return std::forward<Val>(value); },
+            expiry_after(ttl),
+            1.0);
+    }
+
+    // returns the value cached for `key` if present, otherwise inserts and
+    // returns `f()`. `f` is called while holding the submap's lock. With a
+    // `cost_aware` policy, the time spent in `f()` is the cost of the entry.
+    // As with `insert(key, value)`, the values computed by `f()` don't expire.
+    template<class Fn>
+    result_type get_or_insert(const K& key, Fn&& f)
+    {
+        return get_or_insert_impl(key, f, no_expiry());
+    }
+
+    // same, but the values computed by `f()` (for a missing or expired entry)
+    // expire `ttl` from now (`ttl_policy` only)
+    template<class Fn, class Rep, class Period>
+    result_type get_or_insert(const K& key, Fn&& f, std::chrono::duration<Rep, Period> ttl)
+        requires has_ttl
+    {
+        return get_or_insert_impl(key, f, expiry_after(ttl));
+    }
+
+    // evicts all the expired entries (`ttl_policy` only). Not needed for the
+    // cache to work, as each insert evicts the expired entries of its submap,
+    // but releases the memory owned by keys and values which may not be
+    // accessed again.
+    void remove_expired()
+        requires has_ttl
+    {
+        auto t = now();
+        for (size_t s = 0; s < num_submaps; ++s) {
+            _cache.with_submap_m(s, [&](typename map_type::EmbeddedSet& set) {
+                lru_list& l = _cache.get_inner(s).aux_;
+                release_pending(l);
+                Policy::expire(links{ _nodes.get() }, l.lists, t, [&](uint32_t i) { add_pending(l, i); });
+                for (handle h : priv::lru_pending<node>{ _nodes.get(), l.pending })
+                    set.erase(h);
+                release_pending(l);
+            });
+        }
+    }
 
-    using list_type = std::list<value_type>;
-    using list_iter = typename list_type::iterator;
+    void clear()
+    {
+        for (size_t s = 0; s < num_submaps; ++s) {
+            _cache.with_submap_m(s, [&](typename map_type::EmbeddedSet& set) {
+                lru_list& l = _cache.get_inner(s).aux_;
+                destroy_nodes(l);
+                set.clear();
+                init_list(s, l);
+            });
+        }
+    }
 
-    using map_type = gtl::parallel_flat_hash_map<K,
-                                                 list_iter,
-                                                 Hash,
-                                                 Eq,
-                                                 std::allocator<std::pair<const key_type, list_iter>>,
-                                                 N,
-                                                 Mutex,
-                                                 list_type>;
+    void reserve(size_t n) { _cache.reserve(size_t(n * 1.1f)); }
 
-    static constexpr size_t num_submaps = map_type::subcnt();
+    void set_cache_size(size_t max_size)
+    {
+        _max_size = max_size / num_submaps;
+        if (_max_size + 1 > _node_cnt)
+            resize_nodes(_max_size + 1);
+        for (size_t s = 0; s < num_submaps; ++s)
+            Policy::set_capacity(_cache.get_inner(s).aux_.lists, _max_size);
+    }
 
-    // because the cache is sharded (multiple submaps and sublists)
-    // the max_size is an approximation.
-    // ------------------------------------------------------------
-    lru_cache_impl(size_t max_size = 65536)
+    // the number of entries, including the expired ones not yet evicted
+    size_t size() const { return _cache.size(); }
+
+    // bytes used by the cache, not counting memory owned by the keys and values
+    size_t memory_used() const
     {
-        reserve(max_size);
-        set_cache_size(max_size);
-        assert(_max_size > 2);
+        return num_submaps * _node_cnt * sizeof(node) + _cache.capacity() * (sizeof(handle) + 1);
     }
 
-    bool exists(const K& k)
+    // the sum of the counters of the submaps (all zero unless `Stats` is enabled)
+    cache_stats stats() const
     {
-        return _cache.if_contains(k, [&](const auto&, list_type&) {});
+        cache_stats res;
+        for (size_t s = 0; s < num_submaps; ++s)
+            const_cast<map_type&>(_cache).get_inner(s).aux_.stats.add_to(res);
+        return res;
     }
 
-    std::optional<result_type> get(const K& k)
+    void reset_stats()
     {
-        if (result_type res; _cache.if_contains(k, [&](const auto& v, list_type& l) {
-                res = v.second->second;
-                l.splice(l.begin(), l, v.second);
-            }))
-            return { res };
-        return std::nullopt;
+        for (size_t s = 0; s < num_submaps; ++s)
+            _cache.get_inner(s).aux_.stats.reset();
+    }
+
+    // calls `f(key, value)` on the entries which are not expired, submap by
+    // submap (holding its lock), going through each of the policy's lists from
+    // the least recently used entry to the most recent one. Inserting the
+    // entries in this order in an empty cache restores the order of the lists
+    // with `lru_policy`. With a `cost_aware` policy, `f` can also take the
+    // cost of the entry, `f(key, value, cost)`, to be inserted with it.
+    template<class F>
+    void for_each_oldest_first(F&& f) const
+    {
+        [[maybe_unused]] auto t     = now();
+        auto&                 cache = const_cast<map_type&>(_cache);
+        for (size_t s = 0; s < num_submaps; ++s) {
+            cache.with_submap(s, [&](const typename map_type::EmbeddedSet&) {
+                lru_list& l = cache.get_inner(s).aux_;
+                Policy::for_each_list(l.lists, [&](priv::lru_ends& e) {
+                    for (uint32_t i = e.tail; i != nil; i = _nodes[i].prev) {
+                        if constexpr (has_ttl) {
+                            if (Policy::expired(_nodes[i].data, t))
+                                continue;
+                        }
+                        const value_type& v = _nodes[i].value();
+                        if constexpr (std::is_invocable_v<F&, const K&, const V&, double>)
+                            f(v.first, v.second, Policy::cost(_nodes[i].data, size_t(_weigher(v.first, v.second))));
+                        else
+                            f(v.first, v.second);
+                    }
+                });
+            });
+        }
+    }
+
+private:
+    template<class Q>
+    bool exists_impl(const Q& k)
+    {
+        [[maybe_unused]] auto t     = now();
+        bool                  found = false;
+        _cache.template if_contains<Q>(k, [&](const handle& h, lru_list&) {
+            if constexpr (has_ttl)
+                found = !Policy::expired(_nodes[h.idx].data, t);
+            else
+                found = true;
+        });
+        return found;
+    }
+
+    template<class Q>
+    std::optional<result_type> peek_impl(const Q& k)
+    {
+        [[maybe_unused]] auto      t = now();
+        std::optional<result_type> res;
+        _cache.template if_contains<Q>(k, [&](const handle& h, lru_list&) {
+            if constexpr (has_ttl) {
+                if (Policy::expired(_nodes[h.idx].data, t))
+                    return;
+            }
+            res = _nodes[h.idx].value().second;
+        });
+        return res;
+    }
+
+    template<class Q>
+    std::optional<result_type> get_impl(const Q& k)
+    {
+        [[maybe_unused]] auto      t = now();
+        std::optional<result_type> res;
+        auto                       hit = [&](const handle& h, lru_list& l) {
+            if constexpr (has_ttl) {
+                if (Policy::expired(_nodes[h.idx].data, t))
+                    return;
+            }
+            res = _nodes[h.idx].value().second;
+            Policy::on_hit(links{ _nodes.get() }, l.lists, h.idx);
+            l.stats.on_hit();
+        };
+        if constexpr (Policy::shared_hit)
+            _cache.template if_contains<Q>(k, hit);
+        else
+            _cache.template modify_if<Q>(k, hit);
+        if constexpr (Stats::enabled) {
+            if (!res)
+                stats_of(k).on_miss();
+        }
+        return res;
+    }
+
+    // `ttl` from now, saturated to the end of time
+    template<class Rep, class Period>
+    static auto expiry_after(std::chrono::duration<Rep, Period> ttl)
+    {
+        using time_point = typename Policy::time_point;
+        auto t           = now();
+        return ttl < std::chrono::duration_cast<decltype(ttl)>((time_point::max)() - t)
+                   ? t + std::chrono::duration_cast<typename Policy::duration>(ttl)
+                   : (time_point::max)();
+    }
+
+    template<class Fn, class Expiry>
+    result_type get_or_insert_impl(const K& key, Fn& f, Expiry expiry)
+    {
+        [[maybe_unused]] auto      t    = now();
+        double                     cost = 1.0;
+        std::optional<result_type> res;
+        insert_impl(
+            key,
+            [&](uint32_t i, Stats& stats) {
+                result_type& v        = _nodes[i].value().second;
+                bool         computed = false;
+                if constexpr (has_ttl) {
+                    if (Policy::expired(_nodes[i].data, t)) {
+                        v        = compute(stats, f, cost);
+                        computed = true;
+                    }
+                }
+                if (!computed)
+                    stats.on_hit();
+                res.emplace(v);
+                return computed;
+            },
+            [&](Stats& stats) -> result_type& { return res.emplace(compute(stats, f, cost)); },
+            expiry,
+            cost);
+        return std::move(*res);
     }
 
+    // the `hit` callback of `insert_impl` for `insert()`
     template<class Val>
-    void insert(const K& key, Val&& value)
+    auto store(Val&& value)
+    {
+        return [&](uint32_t i, Stats&) {
+            _nodes[i].value().second = std::forward<Val>(value);
+            return true;
+        };
+    }
+
+    // calls `f()` for a missing (or expired) value, and sets `cost` to the
+    // time it took in ns (`cost_aware` policies only)
+    template<class Fn>
+    static result_type compute(Stats& stats, Fn& f, [[maybe_unused]] double& cost)
+    {
+        using clock = std::chrono::steady_clock;
+
+        stats.on_miss();
+        auto                       t     = stats.start_timer();
+        [[maybe_unused]] clock::time_point start;
+        if constexpr (cost_aware)
+            start = clock::now();
+        auto res = f();
+        if constexpr (cost_aware)
+            cost = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        stats.on_computed(t);
+        return res;
+    }
+
+    // the counters of the submap of `k`, for the misses, which don't lock it
+    template<class Q>
+    Stats& stats_of(const Q& k)
+    {
+        return _cache.get_inner(map_type::subidx(_cache.hash(k))).aux_.stats;
+    }
+
+    // If `key` is present, calls `hit(i, stats)` with its node index and the
+    // counters of its submap. `hit` returns true if it updated the value, which
+    // then gets the new `expiry`. Otherwise constructs the value from
+    // `make_value(stats)` in a free node, which then costs `cost` (read after
+    // calling `make_value`).
+    template<class FHit, class FNew, class Expiry>
+    void insert_impl(const K&                       key,
+                     FHit&&                         hit,
+                     FNew&&                         make_value,
+                     [[maybe_unused]] Expiry        expiry,
+                     [[maybe_unused]] const double& cost)
     {
         _cache.lazy_emplace_l(
             key,
-            [&](typename map_type::value_type& v, list_type& l) {
+            [&](const handle& h, lru_list& l) {
                 // called only when key was already present
-                v.second->second = std::forward<Val>(value);
-                l.splice(l.begin(), l, v.second);
+                if (hit(h.idx, l.stats)) {
+                    if constexpr (has_ttl)
+                        Policy::set_expiry(links{ _nodes.get() }, l.lists, h.idx, expiry);
+                }
+                Policy::on_hit(links{ _nodes.get() }, l.lists, h.idx);
             },
-            [&](const typename map_type::constructor& ctor, list_type& l) {
-                // construct value_type in place when key not present
-                l.push_front(value_type(key, std::forward<Val>(value)));
-                ctor(key, l.begin());
-                if (l.size() > _max_size) {
-                    // remove oldest
-                    auto last = l.end();
-                    last--;
-                    auto to_delete = std::move(last->first);
-                    l.pop_back();
-                    return std::optional<key_type>{ to_delete };
+            [&](const typename map_type::constructor& ctor, lru_list& l) {
+                // construct value_type in a free node when key not present. If
+                // `make_value` throws, nothing has changed yet (the hash set
+                // cancels the insertion).
+                release_pending(l);
+                uint32_t i = l.free;
+                assert(i != nil);
+                ::new (static_cast<void*>(_nodes[i].storage)) value_type(key, make_value(l.stats));
+                l.free = _nodes[i].next;
+                if constexpr (has_ttl) {
+                    Policy::expire(links{ _nodes.get() }, l.lists, now(), [&](uint32_t j) { add_pending(l, j); });
                 }
-                return std::optional<key_type>{};
+                l.stats.on_insert(_nodes[i].stats);
+                Policy::on_insert(links{ _nodes.get() }, l.lists, i, [&]() { return _cache.hash(key); });
+                if constexpr (cost_aware) {
+                    const value_type& v = _nodes[i].value();
+                    Policy::set_cost(links{ _nodes.get() }, l.lists, i, cost, size_t(_weigher(v.first, v.second)));
+                }
+                if constexpr (has_ttl)
+                    Policy::set_expiry(links{ _nodes.get() }, l.lists, i, expiry);
+                ++l.size;
+                ctor(handle{ i });
+                if (l.size > _max_size)
+                    add_pending(l, Policy::evict(links{ _nodes.get() }, l.lists));
+
+                // The evicted nodes still hold their key, which is needed to
+                // erase them from the hash set, so they are only freed later.
+                return priv::lru_pending<node>{ _nodes.get(), l.pending };
             });
     }
 
-    void   clear() { _cache.clear(); }
-    void   reserve(size_t n) { _cache.reserve(size_t(n * 1.1f)); }
-    void   set_cache_size(size_t max_size) { _max_size = max_size / num_submaps; }
-    size_t size() const { return _cache.size(); }
+    // `i` was unlinked by the policy
+    void add_pending(lru_list& l, uint32_t i)
+    {
+        l.stats.on_evict(_nodes[i].stats);
+        _nodes[i].next = l.pending;
+        l.pending      = i;
+        --l.size;
+    }
 
-private:
-    size_t   _max_size;
-    map_type _cache;
+    void release_pending(lru_list& l)
+    {
+        while (l.pending != nil) {
+            uint32_t i = l.pending;
+            l.pending  = _nodes[i].next;
+            _nodes[i].value().~value_type();
+            _nodes[i].next = l.free;
+            l.free         = i;
+        }
+    }
+
+    // destroys the values of all the nodes of `l` (the nodes are not relinked)
+    void destroy_nodes(lru_list& l)
+    {
+        release_pending(l);
+        Policy::for_each_list(l.lists, [&](priv::lru_ends& e) {
+            for (uint32_t i = e.head; i != nil; i = _nodes[i].next)
+                _nodes[i].value().~value_type();
+        });
+        l.lists = typename Policy::list_data{};
+        l.size  = 0;
+    }
+
+    // all the nodes of submap `s` are free
+    void init_list(size_t s, lru_list& l)
+    {
+        uint32_t first = static_cast<uint32_t>(s * _node_cnt);
+        for (uint32_t i = 0; i < _node_cnt; ++i)
+            _nodes[first + i].next = (i + 1 < _node_cnt) ? first + i + 1 : nil;
+        l.lists   = typename Policy::list_data{};
+        l.free    = first;
+        l.pending = nil;
+        l.size    = 0;
+        Policy::set_capacity(l.lists, _max_size);
+    }
+
+    // Submap `s` owns the nodes [s * _node_cnt, (s + 1) * _node_cnt). When
+    // `_node_cnt` changes, nodes keep their position within their submap's range,
+    // and the handles stored in the hash set are updated (their hash does not
+    // change, since it is the hash of the key).
+    void resize_nodes(size_t node_cnt)
+    {
+        if (num_submaps * node_cnt >= nil)
+            throw std::length_error("gtl lru_cache_intrusive_impl: cache size too large");
+
+        const size_t old_cnt = _node_cnt;
+        node_array   nodes(new node[num_submaps * node_cnt]);
+        auto         remap = [&](uint32_t i) {
+            return i == nil ? nil : static_cast<uint32_t>(i / old_cnt * node_cnt + i % old_cnt);
+        };
+
+        if (old_cnt == 0) {
+            _nodes    = std::move(nodes);
+            _node_cnt = node_cnt;
+            for (size_t s = 0; s < num_submaps; ++s)
+                init_list(s, _cache.get_inner(s).aux_);
+            return;
+        }
+
+        for (size_t s = 0; s < num_submaps; ++s) {
+            lru_list& l = _cache.get_inner(s).aux_;
+            release_pending(l);
+            Policy::for_each_list(l.lists, [&](priv::lru_ends& e) {
+                for (uint32_t i = e.head; i != nil; i = _nodes[i].next) {
+                    node& dst = nodes[remap(i)];
+                    ::new (static_cast<void*>(dst.storage)) value_type(std::move(_nodes[i].value()));
+                    _nodes[i].value().~value_type();
+                    dst.prev = remap(_nodes[i].prev);
+                    dst.next = remap(_nodes[i].next);
+                    dst.data  = _nodes[i].data;
+                    dst.stats = _nodes[i].stats;
+                    Policy::for_each_node_index(dst.data, [&](uint32_t& j) { j = remap(j); });
+                }
+            });
+            for (uint32_t i = l.free; i != nil; i = _nodes[i].next)
+                nodes[remap(i)].next = remap(_nodes[i].next);
+
+            // the new nodes at the end of the submap's range are free
+            uint32_t free = remap(l.free);
+            for (size_t i = node_cnt; i-- > old_cnt;) {
+                nodes[s * node_cnt + i].next = free;
+                free                         = static_cast<uint32_t>(s * node_cnt + i);
+            }
+            Policy::for_each_index(l.lists, [&](uint32_t& i) { i = remap(i); });
+            l.free = free;
+        }
+        _cache.for_each_m([&](const handle& h) { const_cast<handle&>(h).idx = remap(h.idx); });
+        _nodes    = std::move(nodes);
+        _node_cnt = node_cnt;
+    }
+
+    size_t     _max_size = 0;
+    size_t     _node_cnt = 0; // nodes per submap
+    node_array _nodes;
+    map_type   _cache;
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS weigher_type _weigher;
 };
 
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using intrusive_lru_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_intrusive_lru_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::mutex>;
+
 // ------------------------------------------------------------------------------
-// test lru_cache_test.cpp will only pass if N==0 as it checks exact numbers
-// of items remaining in (or expunged from) cache.
-//
-// but it is fine to use a larger N for real-life applications, although it is
-// mostly useful in multi threaded contexts (when using std::mutex).
+// SIEVE eviction: `get()` hits of `mt_sieve_cache` only take a shared lock, so
+// concurrent hits on the same submap don't serialize.
 // ------------------------------------------------------------------------------
 template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
-using lru_cache = lru_cache_impl<K, V, 0, Hash, Eq, gtl::NullMutex>;
+using sieve_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex, sieve_policy>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_sieve_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::shared_mutex, sieve_policy>;
 
 // ------------------------------------------------------------------------------
-// uses std::mutex by default
+// W-TinyLFU admission: resists scans, and keeps frequently used entries even
+// when they were not used very recently.
 // ------------------------------------------------------------------------------
 template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
-using mt_lru_cache = lru_cache_impl<K, V, 6, Hash, Eq, std::mutex>;
+using tinylfu_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex, tinylfu_policy>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_tinylfu_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::mutex, tinylfu_policy>;
+
+// ------------------------------------------------------------------------------
+// Segmented LRU: entries hit at least twice are protected from the entries
+// inserted since.
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using slru_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex, slru_policy>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_slru_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::mutex, slru_policy>;
+
+// ------------------------------------------------------------------------------
+// GreedyDual-Size-Frequency: keeps the entries which were expensive to compute
+// (with `get_or_insert()`) over the cheap ones.
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using gdsf_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex, gdsf_policy<>>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_gdsf_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::mutex, gdsf_policy<>>;
 
+// ------------------------------------------------------------------------------
+// LRU with a per entry time to live: `insert(key, value, ttl)`
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using ttl_lru_cache = lru_cache_intrusive_impl<K, V, 0, Hash, Eq, gtl::NullMutex, ttl_policy<>>;
+
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using mt_ttl_lru_cache = lru_cache_intrusive_impl<K, V, 6, Hash, Eq, std::mutex, ttl_policy<>>;
+
+// ------------------------------------------------------------------------------
+// Like `lru_cache_impl`, but when a value is overwritten or evicted, it is
+// moved into the `delay_queue` pointed to by `dq` (if not null), to be released
+// at the time passed to `insert()`, so that readers still using it have time
+// to finish. The owner of the queue calls its `drain(now)` periodically.
+// ------------------------------------------------------------------------------
 template<class K,
          class V,
          unsigned DELAY_QUEUE_SIZE=1000000,
@@ -137,7 +2115,7 @@ template<class K,
          class Mutex = std::mutex>
 class lru_cache_with_q_impl {
 public:
-    typedef atomic_queue::AtomicQueue<std::pair<uint32_t, V>*, DELAY_QUEUE_SIZE> DelayQueue;
+    typedef gtl::delay_queue<V, DELAY_QUEUE_SIZE> DelayQueue;
     typedef std::shared_ptr<DelayQueue> DelayQueuePtr;
     using key_type    = K;
     using result_type = V;
@@ -184,13 +2162,10 @@ public:
         _cache.lazy_emplace_l(
             key,
             [&](typename map_type::value_type& v, list_type& l) {
-                // called only when key was already present
-                if (_delayed_recycle_queue_ptr) {
-                  auto ptr = new std::pair<uint32_t, V>(expirt, (v.second->second));
-                  if (!(*_delayed_recycle_queue_ptr)->try_push(ptr)) {  // 加入 延时删除 队列
-                    delete ptr;
-                  }
-                }
+                // called only when key was already present. If the queue is full,
+                // the old value is released right away.
+                if (_delayed_recycle_queue_ptr)
+                  (*_delayed_recycle_queue_ptr)->try_push(expirt, std::move(v.second->second));
                 v.second->second = std::forward<Val>(value);
                 l.splice(l.begin(), l, v.second);
             },
@@ -202,12 +2177,8 @@ public:
                     // remove oldest
                     auto last = l.end();
                     last--;
-                    if (_delayed_recycle_queue_ptr) {
-                      auto ptr = new std::pair<uint32_t, V>(expirt, (last->second));
-                      if (!(*_delayed_recycle_queue_ptr)->try_push(ptr)) {  // 加入 延时删除 队列
-                        delete ptr;
-                      }
-                    }
+                    if (_delayed_recycle_queue_ptr)
+                      (*_delayed_recycle_queue_ptr)->try_push(expirt, std::move(last->second));
                     auto to_delete = std::move(last->first);
                     l.pop_back();
                     return std::optional<key_type>{ to_delete };
@@ -228,6 +2199,10 @@ private:
 };
 
 
+// ------------------------------------------------------------------------------
+// Same as `lru_cache_with_q_impl`, but only the `second` member of the
+// overwritten or evicted values (of type `V_M`) goes to the delay queue.
+// ------------------------------------------------------------------------------
 template<class K,
          class V,
          class V_M, // M should be V member
@@ -238,7 +2213,7 @@ template<class K,
          class Mutex = std::mutex>
 class lru_cache_with_queue_impl {
 public:
-    typedef atomic_queue::AtomicQueue<std::pair<uint32_t, V_M>*, DELAY_QUEUE_SIZE> DelayQueue;
+    typedef gtl::delay_queue<V_M, DELAY_QUEUE_SIZE> DelayQueue;
     typedef std::shared_ptr<DelayQueue> DelayQueuePtr;
     using key_type    = K;
     using result_type = V;
@@ -285,13 +2260,10 @@ public:
         _cache.lazy_emplace_l(
             key,
             [&](typename map_type::value_type& v, list_type& l) {
-                // called only when key was already present
-                if (_delayed_recycle_queue_ptr) {
-                  auto ptr = new std::pair<uint32_t, V_M>(expirt, (v.second->second.second));
-                  if (!(*_delayed_recycle_queue_ptr)->try_push(ptr)) {  // 加入 延时删除 队列
-                    delete ptr;
-                  }
-                }
+                // called only when key was already present. If the queue is full,
+                // the old value is released right away.
+                if (_delayed_recycle_queue_ptr)
+                  (*_delayed_recycle_queue_ptr)->try_push(expirt, std::move(v.second->second.second));
                 v.second->second = std::forward<Val>(value);
                 l.splice(l.begin(), l, v.second);
             },
@@ -303,12 +2275,8 @@ public:
                     // remove oldest
                     auto last = l.end();
                     last--;
-                    if (_delayed_recycle_queue_ptr) {
-                      auto ptr = new std::pair<uint32_t, V_M>(expirt, (last->second.second));
-                      if (!(*_delayed_recycle_queue_ptr)->try_push(ptr)) {  // 加入 延时删除 队列
-                        delete ptr;
-                      }
-                    }
+                    if (_delayed_recycle_queue_ptr)
+                      (*_delayed_recycle_queue_ptr)->try_push(expirt, std::move(last->second.second));
                     auto to_delete = std::move(last->first);
                     l.pop_back();
                     return std::optional<key_type>{ to_delete };
@@ -341,6 +2309,225 @@ using shard_lru_cache = lru_cache_with_queue_impl<K, V,V_m, SIZE, 10, Hash, Eq,
 template<class K, class V, unsigned SIZE=1000000,class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
 using simple_shard_lru_cache = lru_cache_with_q_impl<K, V, SIZE, 10, Hash, Eq, std::mutex>;
 
+// ------------------------------------------------------------------------------
+// LRU cache whose `get()` returns a pointer to the cached value instead of a
+// copy. The pointer stays valid, even if the entry is overwritten or evicted,
+// until the `epoch_domain::guard` returned by `pin()` is destroyed:
+//
+//     auto guard = cache.pin();
+//     if (const V* v = cache.get(key, guard))
+//         use(*v);
+//
+// Hits only take the submap's lock in shared mode (with a shared mutex, as
+// `epoch_shard_lru_cache` does), to find the entry and set its `visited` bit:
+// they don't reorder the list, and entries are evicted as by `sieve_policy`
+// (the first entry not visited since the hand last passed it, going from the
+// oldest to the newest). The value is neither copied nor locked while it is
+// used.
+//
+// Overwriting a value inserts a new list node rather than assigning to the
+// value in place. The nodes of the overwritten or evicted values are moved
+// (without allocating) to a per submap list of retired nodes, tagged with the
+// current epoch. Every `retire_batch` retirements in a submap, the previous
+// batch is freed if no reader pinned before it was retired is still pinned,
+// and the current batch takes its place. So the memory kept for readers is
+// bounded by about 2 * `retire_batch` values per submap, as long as readers
+// don't stay pinned for long.
+// ------------------------------------------------------------------------------
+template<class K,
+         class V,
+         size_t N    = 4,
+         class Hash  = gtl::Hash<K>,
+         class Eq    = std::equal_to<K>,
+         class Mutex = std::mutex>
+class lru_cache_epoch_impl
+{
+public:
+    using key_type    = K;
+    using result_type = V;
+    using value_type  = typename std::pair<const key_type, result_type>;
+    using guard_type  = epoch_domain::guard;
+
+    static constexpr size_t retire_batch = 64;
+
+private:
+    struct node
+    {
+        template<class Val>
+        node(const key_type& key, Val&& value)
+            : kv(key, std::forward<Val>(value))
+        {
+        }
+
+        value_type                   kv;
+        mutable std::atomic<uint8_t> visited{ 0 }; // set by hits, under a shared lock
+    };
+
+public:
+    using list_type = std::list<node>; // front is the most recently inserted
+    using list_iter = typename list_type::iterator;
+
+private:
+    // the AuxCont of each submap
+    struct lru_list : public list_type
+    {
+        list_iter hand;               // next eviction candidate, if `has_hand`
+        bool      has_hand = false;   // otherwise start from the oldest entry
+        list_type retired;            // retired since the last collection
+        list_type sealed;             // retired before the last collection
+        uint64_t  retired_epoch = 0;  // epoch of the last value added to `retired`
+        uint64_t  sealed_epoch  = 0;  // `retired_epoch` when `sealed` was sealed
+    };
+
+public:
+    using map_type = gtl::parallel_flat_hash_map<K,
+                                                 list_iter,
+                                                 Hash,
+                                                 Eq,
+                                                 std::allocator<std::pair<const key_type, list_iter>>,
+                                                 N,
+                                                 Mutex,
+                                                 lru_list>;
+
+    static constexpr size_t num_submaps = map_type::subcnt();
+
+    // because the cache is sharded (multiple submaps and sublists)
+    // the max_size is an approximation.
+    // ------------------------------------------------------------
+    lru_cache_epoch_impl(size_t max_size = 65536)
+    {
+        reserve(max_size);
+        set_cache_size(max_size);
+        assert(_max_size > 2);
+    }
+
+    // the values returned by `get()` stay valid until the guard is destroyed
+    guard_type pin() { return _epochs.pin(); }
+
+    bool exists(const K& k)
+    {
+        return _cache.if_contains(k, [&](const auto&, lru_list&) {});
+    }
+
+    // `guard` must come from this cache's `pin()`
+    const result_type* get(const K& k, const guard_type& guard)
+    {
+        assert(guard.domain() == &_epochs);
+        (void)guard;
+        const result_type* res = nullptr;
+        _cache.if_contains(k, [&](const auto& v, lru_list&) {
+            // read first, so that hot entries don't keep their cache line dirty
+            auto& visited = v.second->visited;
+            if (!visited.load(std::memory_order_relaxed))
+                visited.store(1, std::memory_order_relaxed);
+            res = &v.second->kv.second;
+        });
+        return res;
+    }
+
+    // copies the value, after releasing the submap's lock
+    std::optional<result_type> get(const K& k)
+    {
+        auto guard = pin();
+        if (const result_type* v = get(k, guard))
+            return { *v };
+        return std::nullopt;
+    }
+
+    template<class Val>
+    void insert(const K& key, Val&& value)
+    {
+        _cache.lazy_emplace_l(
+            key,
+            [&](typename map_type::value_type& v, lru_list& l) {
+                // called only when key was already present. Readers may still
+                // use the old value, so it gets a new node.
+                l.emplace_front(key, std::forward<Val>(value));
+                retire(l, std::exchange(v.second, l.begin()));
+            },
+            [&](const typename map_type::constructor& ctor, lru_list& l) {
+                // construct value_type in place when key not present, after
+                // choosing the entry to evict so that it isn't the new one
+                std::optional<key_type> to_delete;
+                if (l.size() >= _max_size) {
+                    auto victim = evict_candidate(l);
+                    to_delete.emplace(victim->kv.first);
+                    retire(l, victim);
+                }
+                l.emplace_front(key, std::forward<Val>(value));
+                ctor(key, l.begin());
+                return to_delete;
+            });
+    }
+
+    void clear()
+    {
+        for (size_t s = 0; s < num_submaps; ++s) {
+            _cache.with_submap_m(s, [&](typename map_type::EmbeddedSet& set) {
+                lru_list& l = _cache.get_inner(s).aux_;
+                set.clear();
+                while (!l.empty())
+                    retire(l, l.begin());
+            });
+        }
+    }
+
+    void   reserve(size_t n) { _cache.reserve(size_t(n * 1.1f)); }
+    void   set_cache_size(size_t max_size) { _max_size = max_size / num_submaps; }
+    size_t size() const { return _cache.size(); }
+
+private:
+    // the SIEVE hand: clears the `visited` bits from the hand towards the
+    // newest entry (wrapping around), and stops at the first entry not visited
+    static list_iter evict_candidate(lru_list& l)
+    {
+        auto it = l.has_hand ? l.hand : std::prev(l.end());
+        while (it->visited.load(std::memory_order_relaxed)) {
+            it->visited.store(0, std::memory_order_relaxed);
+            it = it == l.begin() ? std::prev(l.end()) : std::prev(it);
+        }
+        l.hand     = it; // moved past it by `retire()`
+        l.has_hand = true;
+        return it;
+    }
+
+    // moves the node `it` of `l` to the retired nodes, called with the submap's
+    // lock held once `it` can't be found anymore.
+    void retire(lru_list& l, list_iter it)
+    {
+        if (l.has_hand && l.hand == it) {
+            l.has_hand = it != l.begin();
+            if (l.has_hand)
+                l.hand = std::prev(it);
+        }
+        l.retired.splice(l.retired.end(), l, it);
+        l.retired_epoch = _epochs.epoch();
+        if (l.retired.size() % retire_batch == 0)
+            collect(l);
+    }
+
+    void collect(lru_list& l)
+    {
+        if (!l.sealed.empty() && _epochs.min_pinned() > l.sealed_epoch)
+            l.sealed.clear();
+        if (l.sealed.empty()) {
+            l.sealed.splice(l.sealed.end(), l.retired);
+            l.sealed_epoch = l.retired_epoch;
+            _epochs.advance(); // so that new readers don't prevent releasing `sealed`
+        }
+    }
+
+    size_t       _max_size;
+    map_type     _cache;
+    epoch_domain _epochs;
+};
+
+// ------------------------------------------------------------------------------
+// same number of submaps as `shard_lru_cache`
+// ------------------------------------------------------------------------------
+template<class K, class V, class Hash = gtl::Hash<K>, class Eq = std::equal_to<K>>
+using epoch_shard_lru_cache = lru_cache_epoch_impl<K, V, 10, Hash, Eq, std::shared_mutex>;
+
 } // namespace gtl
 
 #endif // gtl_lru_cache_hpp_
@@ -11,12 +11,27 @@
 //      https://www.apache.org/licenses/LICENSE-2.0
 // ---------------------------------------------------------------------------
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <gtl/lru_cache.hpp>
 #include <gtl/phmap.hpp>
+#include <gtl/phmap_dump.hpp>
+#include <limits>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
 #include <tuple>
+#include <type_traits>
 
 namespace gtl {
 
@@ -53,6 +68,94 @@ struct pack_helper<R (LambdaClass::*)(Args...) const>
 template<class F>
 using this_pack_helper = typename pack_helper<F>::args;
 
+namespace priv {
+
+// ------------------------------------------------------------------------------
+// Hash and equality of the argument tuples, which also accept tuples of
+// references to the arguments, so that the lookups don't copy them.
+// `gtl::Hash<std::tuple<...>>` ignores the references of the element types.
+// ------------------------------------------------------------------------------
+struct memoize_key_hash
+{
+    using is_transparent = void;
+
+    template<class... Ts>
+    size_t operator()(const std::tuple<Ts...>& t) const
+    {
+        return gtl::Hash<std::tuple<Ts...>>()(t);
+    }
+};
+
+struct memoize_key_eq
+{
+    using is_transparent = void;
+
+    template<class... Ts, class... Us>
+    bool operator()(const std::tuple<Ts...>& a, const std::tuple<Us...>& b) const
+    {
+        return a == b;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// true if `res` is an empty `std::optional` or `std::expected` (any type with a
+// `has_value()` member), which `mt_memoize` caches as a failure
+// ------------------------------------------------------------------------------
+template<class T>
+bool memoize_is_empty_result([[maybe_unused]] const T& res)
+{
+    if constexpr (requires { res.has_value(); })
+        return !res.has_value();
+    else
+        return false;
+}
+
+// ------------------------------------------------------------------------------
+// The memoizers are saved entry by entry, as a sequence of records made of a
+// `1` byte, the arguments, the result and the `extra` data of the entry (such
+// as its cost with `gtl::gdsf_policy`), followed by a `0` byte.
+// ------------------------------------------------------------------------------
+template<class OutputArchive, class Serializer, class Key, class Result, class... Extra>
+bool memoize_save_entry(OutputArchive&    ar,
+                        const Serializer& ser,
+                        const Key&        key,
+                        const Result&     res,
+                        const Extra&... extra)
+{
+    uint8_t more = 1;
+    return ar.saveBinary(&more, 1) && std::apply([&](const auto&... a) { return (ser.save(ar, a) && ...); }, key) &&
+           ser.save(ar, res) && (ser.save(ar, extra) && ...);
+}
+
+template<class OutputArchive>
+bool memoize_save_end(OutputArchive& ar)
+{
+    uint8_t more = 0;
+    return ar.saveBinary(&more, 1);
+}
+
+// calls `f(key, result, extra...)` for each saved entry
+template<class Key, class Result, class... Extra, class InputArchive, class Serializer, class F>
+bool memoize_load_entries(InputArchive& ar, const Serializer& ser, F&& f)
+{
+    for (;;) {
+        uint8_t more = 0;
+        if (!ar.loadBinary(&more, 1) || more > 1)
+            return false;
+        if (more == 0)
+            return true;
+        Key                  key;
+        Result               res;
+        std::tuple<Extra...> extra;
+        if (!std::apply([&](auto&... a) { return (ser.load(ar, a) && ...); }, key) || !ser.load(ar, res) ||
+            !std::apply([&](auto&... e) { return (ser.load(ar, e) && ...); }, extra))
+            return false;
+        std::apply([&](auto&... e) { f(std::move(key), std::move(res), std::move(e)...); }, extra);
+    }
+}
+
+} // namespace priv
+
 // ------------------------------------------------------------------------------
 // Given a callable object (often a function), this class provides a new
 // callable which either invokes the original one, caching the returned value,
@@ -72,61 +175,146 @@ using this_pack_helper = typename pack_helper<F>::args;
 // N=6 create 64 submaps. Each submap has its own mutex to reduce contention
 // in a heavily multithreaded context.
 //
+// With `single_flight`, the function is called without holding any lock (as
+// when `recursive` is set), and when several threads miss the same key at the
+// same time, only the first one calls the function: the other ones wait for
+// its result (or exception) on a `std::shared_future`, kept in a second hash
+// map of the keys being computed. Without it, concurrent misses of a recursive
+// function all call it, and a non recursive function is called while holding
+// the submap's lock, blocking the other keys of the submap.
+//
+// With `Stats = gtl::cache_counters`, `stats()` returns the number of hits and
+// misses, and a histogram of the time spent in the memoized function.
+//
+// With `cache_failures`, the calls which throw, or return an empty result (see
+// `priv::memoize_is_empty_result`), are not retried until `failures_ttl` has
+// elapsed on `FailuresClock`: the calls with the same arguments rethrow the
+// same exception, or return the same empty result. Up to `failures_max_size`
+// failures are kept (split between the submaps, and raised to 3 per submap if
+// smaller), in a `gtl::lru_cache_intrusive_impl` with
+// `gtl::ttl_policy<gtl::lru_policy, FailuresClock>`, separate from the
+// results. So a key which always fails doesn't hit the backing computation on
+// every call, and the failures don't evict the results. The function is then
+// called without holding any lock, as when `recursive` is set.
+//
 // see example: examples/memoize/mt_memoize.cpp
 // ------------------------------------------------------------------------------
-template<class F, bool recursive = true, size_t N = 6, class Mutex = std::mutex, class = this_pack_helper<F>>
+template<class F,
+         bool recursive      = true,
+         size_t N            = 6,
+         class Mutex         = std::mutex,
+         bool single_flight  = false,
+         class Stats         = gtl::no_cache_stats,
+         bool cache_failures = false,
+         class FailuresClock = std::chrono::steady_clock,
+         class               = this_pack_helper<F>>
 class mt_memoize;
 
-template<class F, bool recursive, size_t N, class Mutex, class... Args>
-class mt_memoize<F, recursive, N, Mutex, pack<Args...>>
+template<class F,
+         bool recursive,
+         size_t N,
+         class Mutex,
+         bool single_flight,
+         class Stats,
+         bool cache_failures,
+         class FailuresClock,
+         class... Args>
+class mt_memoize<F, recursive, N, Mutex, single_flight, Stats, cache_failures, FailuresClock, pack<Args...>>
 {
 public:
-    using key_type    = std::tuple<Args...>;
+    using key_type    = std::tuple<std::remove_cvref_t<Args>...>;
     using result_type = decltype(std::declval<F>()(std::declval<Args>()...));
     using map_type    = gtl::parallel_flat_hash_map<key_type,
                                                  result_type,
-                                                 gtl::Hash<key_type>,
-                                                 std::equal_to<key_type>,
+                                                 priv::memoize_key_hash,
+                                                 priv::memoize_key_eq,
                                                  std::allocator<std::pair<const key_type, result_type>>,
                                                  N,
                                                  Mutex>;
 
-    mt_memoize(F&& f)
+    // the arguments of a call, looked up without copying them into a `key_type`,
+    // which is only constructed when a new result is stored
+    using key_ref_type = std::tuple<const std::remove_cvref_t<Args>&...>;
+
+    // the keys being computed, for `single_flight`
+    using in_flight_type =
+        gtl::parallel_flat_hash_map<key_type,
+                                    std::shared_future<result_type>,
+                                    priv::memoize_key_hash,
+                                    priv::memoize_key_eq,
+                                    std::allocator<std::pair<const key_type, std::shared_future<result_type>>>,
+                                    N,
+                                    Mutex>;
+
+    // a failed call, for `cache_failures`: its exception, or else its result
+    struct failure
+    {
+        std::exception_ptr error;
+        result_type        result;
+    };
+
+    using failure_cache_type = gtl::lru_cache_intrusive_impl<key_type,
+                                                             failure,
+                                                             N,
+                                                             priv::memoize_key_hash,
+                                                             priv::memoize_key_eq,
+                                                             Mutex,
+                                                             gtl::ttl_policy<gtl::lru_policy, FailuresClock>>;
+
+    static constexpr size_t num_submaps = map_type::subcnt();
+
+    // `failures_max_size` and `failures_ttl` are only used with `cache_failures`
+    mt_memoize(F&&                      f,
+               size_t                   failures_max_size = 4096,
+               std::chrono::nanoseconds failures_ttl      = std::chrono::seconds(1))
         : _f(std::move(f))
     {
+        init_failures(failures_max_size, failures_ttl);
     }
 
-    mt_memoize(F& f)
+    mt_memoize(F&                       f,
+               size_t                   failures_max_size = 4096,
+               std::chrono::nanoseconds failures_ttl      = std::chrono::seconds(1))
         : _f(f)
     {
+        init_failures(failures_max_size, failures_ttl);
     }
 
+    // the cached result, or the empty result of a cached failure
     std::optional<result_type> contains(Args... args)
     {
-        key_type key(args...);
-        if (result_type res; _cache.if_contains(key, [&](const auto& v) { res = v.second; }))
+        key_ref_type key(args...);
+        if (result_type res; find(key, res))
             return { res };
+        if constexpr (cache_failures) {
+            auto f = _failures->cache.get(key);
+            if (f && !f->error)
+                return { f->result };
+        }
         return {};
     }
 
     result_type operator()(Args... args)
     {
-        key_type key(args...);
-        if constexpr (!std::is_same_v<Mutex, gtl::NullMutex> && !recursive) {
+        key_ref_type key(args...);
+        if constexpr (single_flight) {
+            return call_single_flight(key, args...);
+        } else if constexpr (!std::is_same_v<Mutex, gtl::NullMutex> && !recursive && !cache_failures) {
             // because we are using a mutex, we must be in a multithreaded context,
             // so use lazy_emplace_l to take the lock only once.
             // --------------------------------------------------------------------
             result_type res;
-            _cache.lazy_emplace_l(
+            _cache.template lazy_emplace_l<key_ref_type>(
                 key,
                 [&](typename map_type::value_type& v) {
                     // called only when key was already present
                     res = v.second;
+                    on_hit(key);
                 },
                 [&](const typename map_type::constructor& ctor) {
                     // construct value_type in place when key not present
-                    res = _f(args...);
-                    ctor(key, res);
+                    res = compute(key, args...);
+                    ctor(key_type(key), res);
                 });
             return res;
         } else {
@@ -135,21 +323,204 @@ public:
             // hashmap APIs.
             // --------------------------------------------------------------
             result_type res;
-            if (_cache.if_contains(key, [&](const auto& v) { res = v.second; }))
+            if (find(key, res) || find_failure(key, res)) {
+                on_hit(key);
                 return res;
-            res = _f(args...);
-            _cache.emplace(key, res);
-            return res;
+            }
+            return compute_and_store(key, args...);
         }
     }
 
-    void   clear() { _cache.clear(); }
+    void clear()
+    {
+        _cache.clear();
+        if constexpr (cache_failures)
+            _failures->cache.clear();
+    }
+
     void   reserve(size_t n) { _cache.reserve(n); }
     size_t size() const { return _cache.size(); }
 
+    // the number of failures cached, including the expired ones not yet evicted
+    size_t failures_size() const
+        requires cache_failures
+    {
+        return _failures->cache.size();
+    }
+
+    // saves the cached results to `ar` (for example a `gtl::BinaryOutputArchive`),
+    // saving each argument and result with `ser.save(ar, v)`. The default
+    // serializer supports the trivially copyable types, strings and vectors.
+    template<class OutputArchive, class Serializer = binary_serializer>
+    bool dump(OutputArchive& ar, const Serializer& ser = Serializer()) const
+    {
+        bool ok = true;
+        _cache.for_each([&](const auto& v) { ok = ok && priv::memoize_save_entry(ar, ser, v.first, v.second); });
+        return ok && priv::memoize_save_end(ar);
+    }
+
+    // adds the results saved by `dump()` to the cache (the results already
+    // cached for the same arguments are kept)
+    template<class InputArchive, class Serializer = binary_serializer>
+    bool load(InputArchive& ar, const Serializer& ser = Serializer())
+    {
+        return priv::memoize_load_entries<key_type, result_type>(
+            ar, ser, [&](key_type&& key, result_type&& res) { _cache.emplace(std::move(key), std::move(res)); });
+    }
+
+    // the sum of the counters of the submaps (all zero unless `Stats` is enabled)
+    cache_stats stats() const
+    {
+        cache_stats res;
+        if constexpr (Stats::enabled) {
+            for (const auto& s : _stats)
+                s.add_to(res);
+        }
+        return res;
+    }
+
+    void reset_stats()
+    {
+        if constexpr (Stats::enabled) {
+            for (auto& s : _stats)
+                s.reset();
+        }
+    }
+
 private:
+    bool find(const key_ref_type& key, result_type& res)
+    {
+        return _cache.template if_contains<key_ref_type>(key, [&](const auto& v) { res = v.second; });
+    }
+
+    // true if a failure of this call is cached, then rethrows its exception
+    // or sets `res` to its result
+    bool find_failure([[maybe_unused]] const key_ref_type& key, [[maybe_unused]] result_type& res)
+    {
+        if constexpr (cache_failures) {
+            if (auto f = _failures->cache.get(key)) {
+                if (f->error) {
+                    on_hit(key);
+                    std::rethrow_exception(f->error);
+                }
+                res = std::move(f->result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // calls the function, and caches either its result or its failure
+    result_type compute_and_store(const key_ref_type& key, Args... args)
+    {
+        if constexpr (cache_failures) {
+            result_type res;
+            try {
+                res = compute(key, args...);
+            } catch (...) {
+                _failures->cache.insert(key_type(key), failure{ std::current_exception(), {} }, _failures->ttl);
+                throw;
+            }
+            if (priv::memoize_is_empty_result(res))
+                _failures->cache.insert(key_type(key), failure{ nullptr, res }, _failures->ttl);
+            else
+                _cache.emplace(key_type(key), res);
+            return res;
+        } else {
+            result_type res = compute(key, args...);
+            _cache.emplace(key_type(key), res);
+            return res;
+        }
+    }
+
+    result_type call_single_flight(const key_ref_type& key, Args... args)
+    {
+        result_type res;
+        if (find(key, res) || find_failure(key, res)) {
+            on_hit(key);
+            return res;
+        }
+
+        std::promise<result_type>       promise;
+        std::shared_future<result_type> result;
+        bool                            first = false;
+        _in_flight.template lazy_emplace_l<key_ref_type>(
+            key,
+            [&](typename in_flight_type::value_type& v) { result = v.second; },
+            [&](const typename in_flight_type::constructor& ctor) {
+                result = promise.get_future().share();
+                ctor(key_type(key), result);
+                first = true;
+            });
+        if (!first) {
+            on_hit(key);
+            return result.get();
+        }
+
+        try {
+            // another thread may have computed the value after our lookup
+            if (find(key, res) || find_failure(key, res)) {
+                on_hit(key);
+            } else {
+                res = compute_and_store(key, args...);
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            _in_flight.template erase<key_ref_type>(key);
+            throw;
+        }
+        promise.set_value(res);
+        _in_flight.template erase<key_ref_type>(key);
+        return res;
+    }
+
+    Stats& stats_of(const key_ref_type& key) { return _stats[map_type::subidx(_cache.hash(key))]; }
+
+    void on_hit([[maybe_unused]] const key_ref_type& key)
+    {
+        if constexpr (Stats::enabled)
+            stats_of(key).on_hit();
+    }
+
+    result_type compute([[maybe_unused]] const key_ref_type& key, Args... args)
+    {
+        if constexpr (Stats::enabled) {
+            Stats& stats = stats_of(key);
+            stats.on_miss();
+            stats.on_insert();
+            auto        t   = stats.start_timer();
+            result_type res = _f(args...);
+            stats.on_computed(t);
+            return res;
+        } else {
+            return _f(args...);
+        }
+    }
+
+    void init_failures([[maybe_unused]] size_t max_size, [[maybe_unused]] std::chrono::nanoseconds ttl)
+    {
+        if constexpr (cache_failures) {
+            // `lru_cache_intrusive_impl` needs more than 2 entries per submap
+            max_size = (std::max)(max_size, 3 * failure_cache_type::num_submaps);
+            _failures.reset(new failures{ failure_cache_type(max_size), ttl });
+        }
+    }
+
+    using stats_array = std::array<Stats, num_submaps>;
+
+    struct failures
+    {
+        failure_cache_type       cache;
+        std::chrono::nanoseconds ttl;
+    };
+
+    using failures_ptr = std::unique_ptr<failures>;
+
     F        _f;
     map_type _cache;
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS std::conditional_t<single_flight, in_flight_type, priv::empty> _in_flight;
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS std::conditional_t<Stats::enabled, stats_array, priv::empty> _stats;
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS std::conditional_t<cache_failures, failures_ptr, priv::empty> _failures;
 };
 
 // ------------------------------------------------------------------------------
@@ -163,8 +534,8 @@ private:
 // when the memoized function is used from a single thread, use the gtl::NullMutex
 // so we don't incur any locking cost.
 // ------------------------------------------------------------------------------
-template<class F, size_t N = 4>
-using memoize = mt_memoize<F, true, N, gtl::NullMutex>;
+template<class F, size_t N = 4, class Stats = gtl::no_cache_stats>
+using memoize = mt_memoize<F, true, N, gtl::NullMutex, false, Stats>;
 
 // ------------------------------------------------------------------------------
 // Given a callable object (often a function), this class provides a new
@@ -181,163 +552,428 @@ using memoize = mt_memoize<F, true, N, gtl::NullMutex>;
 // N=6 create 64 submaps. Each submap has its own mutex to reduce contention
 // in a heavily multithreaded context.
 //
+// Up to `max_size` results are kept, in a `gtl::lru_cache_intrusive_impl`.
+// `Policy` selects which result is dropped when the cache is full: the least
+// recently used one by default, or see `gtl::tinylfu_policy` when the
+// arguments sometimes sweep a large range of values only once, and
+// `gtl::gdsf_policy<Weigher>` when some results take much longer to compute
+// than others (it then times each call of the memoized function), or are much
+// larger: the `weigher` passed to the constructor gives the size of each
+// result, as `weigher(key, result)`. With
+// `gtl::ttl_policy<>`, the results expire `ttl` (a constructor argument) after
+// they were computed or loaded.
+//
+// With `Stats = gtl::cache_counters`, `stats()` returns the statistics of the
+// cache (see `gtl::lru_cache_intrusive_impl`), including the time spent in the
+// memoized function.
+//
+// All the member functions can be called from multiple threads, except
+// `reserve()` and `set_cache_size()`, which resize the cache.
+//
 // see example: examples/memoize/mt_memoize_lru.cpp
 //
 // ------------------------------------------------------------------------------
-template<class F, size_t N = 6, class Mutex = std::mutex, class = this_pack_helper<F>>
+template<class F,
+         size_t N     = 6,
+         class Mutex  = std::mutex,
+         class Policy = gtl::lru_policy,
+         class Stats  = gtl::no_cache_stats,
+         class        = this_pack_helper<F>>
 class mt_memoize_lru;
 
-template<class F, size_t N, class Mutex, class... Args>
-class mt_memoize_lru<F, N, Mutex, pack<Args...>>
+template<class F, size_t N, class Mutex, class Policy, class Stats, class... Args>
+class mt_memoize_lru<F, N, Mutex, Policy, Stats, pack<Args...>>
 {
 public:
-    using key_type    = std::tuple<Args...>;
+    using key_type    = std::tuple<std::remove_cvref_t<Args>...>;
     using result_type = decltype(std::declval<F>()(std::declval<Args>()...));
     using value_type  = typename std::pair<const key_type, result_type>;
 
-    using list_type = std::list<value_type>;
-    using list_iter = typename list_type::iterator;
+    using cache_type = gtl::lru_cache_intrusive_impl<key_type,
+                                                     result_type,
+                                                     N,
+                                                     gtl::Hash<key_type>,
+                                                     std::equal_to<key_type>,
+                                                     Mutex,
+                                                     Policy,
+                                                     Stats>;
+    using weigher_type = typename cache_type::weigher_type;
 
-    using map_type = gtl::parallel_flat_hash_map<key_type,
-                                                 list_iter,
-                                                 gtl::Hash<key_type>,
-                                                 std::equal_to<key_type>,
-                                                 std::allocator<std::pair<const key_type, list_iter>>,
-                                                 N,
-                                                 Mutex,
-                                                 list_type>;
+    static constexpr size_t num_submaps = cache_type::num_submaps;
 
-    static constexpr size_t num_submaps = map_type::subcnt();
+    mt_memoize_lru(F&& f, size_t max_size = 65536, const weigher_type& weigher = weigher_type())
+        : _f(std::move(f))
+        , _cache(max_size, weigher)
+    {
+    }
 
-    mt_memoize_lru(F&& f, size_t max_size = 65536)
+    mt_memoize_lru(F& f, size_t max_size = 65536, const weigher_type& weigher = weigher_type())
+        : _f(f)
+        , _cache(max_size, weigher)
+    {
+    }
+
+    mt_memoize_lru(F&& f, size_t max_size, std::chrono::nanoseconds ttl, const weigher_type& weigher = weigher_type())
+        requires cache_type::has_ttl
         : _f(std::move(f))
+        , _cache(max_size, weigher)
+        , _ttl(ttl)
     {
-        reserve(max_size);
-        set_cache_size(max_size);
-        assert(_max_size > 2);
     }
 
-    mt_memoize_lru(F& f, size_t max_size = 65536)
+    mt_memoize_lru(F& f, size_t max_size, std::chrono::nanoseconds ttl, const weigher_type& weigher = weigher_type())
+        requires cache_type::has_ttl
         : _f(f)
+        , _cache(max_size, weigher)
+        , _ttl(ttl)
     {
-        reserve(max_size);
-        set_cache_size(max_size);
-        assert(_max_size > 2);
     }
 
-    std::optional<result_type> contains(Args... args)
+    // the cached result, if any, which is neither promoted nor counted as a hit
+    std::optional<result_type> contains(Args... args) { return _cache.peek(key_type(args...)); }
+
+    result_type operator()(Args... args)
+    {
+        if constexpr (cache_type::has_ttl)
+            return _cache.get_or_insert(key_type(args...), [&]() { return _f(args...); }, _ttl);
+        else
+            return _cache.get_or_insert(key_type(args...), [&]() { return _f(args...); });
+    }
+
+    void clear() { _cache.clear(); }
+
+    // `reserve()` and `set_cache_size()` must not be called while other threads
+    // use the memoizer (growing the cache reallocates its nodes without locking)
+    void   reserve(size_t n) { _cache.reserve(n); }
+    void   set_cache_size(size_t max_size) { _cache.set_cache_size(max_size); }
+    size_t size() const { return _cache.size(); }
+
+    // saves the cached results to `ar` as `mt_memoize::dump()` does, from the
+    // least recently used to the most recent one in each submap. With
+    // `gtl::gdsf_policy`, the cost of each result (the time it took to compute
+    // it) is saved with it.
+    template<class OutputArchive, class Serializer = binary_serializer>
+    bool dump(OutputArchive& ar, const Serializer& ser = Serializer()) const
+    {
+        bool ok = true;
+        if constexpr (cache_type::cost_aware) {
+            _cache.for_each_oldest_first([&](const key_type& key, const result_type& res, double cost) {
+                ok = ok && priv::memoize_save_entry(ar, ser, key, res, cost);
+            });
+        } else {
+            _cache.for_each_oldest_first([&](const key_type& key, const result_type& res) {
+                ok = ok && priv::memoize_save_entry(ar, ser, key, res);
+            });
+        }
+        return ok && priv::memoize_save_end(ar);
+    }
+
+    // inserts the results saved by `dump()` in the cache, in the order they
+    // were saved, so that an empty cache of the same size gets the same
+    // entries, in the same order with `gtl::lru_policy`, and with the same
+    // cost with `gtl::gdsf_policy`
+    template<class InputArchive, class Serializer = binary_serializer>
+    bool load(InputArchive& ar, const Serializer& ser = Serializer())
+    {
+        if constexpr (cache_type::cost_aware) {
+            return priv::memoize_load_entries<key_type, result_type, double>(
+                ar, ser, [&](key_type&& key, result_type&& res, double cost) {
+                    _cache.insert(key, std::move(res), cost);
+                });
+        } else {
+            return priv::memoize_load_entries<key_type, result_type>(
+                ar, ser, [&](key_type&& key, result_type&& res) {
+                    if constexpr (cache_type::has_ttl)
+                        _cache.insert(key, std::move(res), _ttl);
+                    else
+                        _cache.insert(key, std::move(res));
+                });
+        }
+    }
+
+    cache_stats stats() const { return _cache.stats(); }
+    void        reset_stats() { _cache.reset_stats(); }
+
+private:
+    using ttl_type = std::conditional_t<cache_type::has_ttl, std::chrono::nanoseconds, priv::empty>;
+
+    static ttl_type no_ttl()
+    {
+        if constexpr (cache_type::has_ttl)
+            return (std::chrono::nanoseconds::max)();
+        else
+            return {};
+    }
+
+    F                                        _f;
+    cache_type                               _cache;
+    GTL_ATTRIBUTE_NO_UNIQUE_ADDRESS ttl_type _ttl = no_ttl();
+};
+
+// ------------------------------------------------------------------------------
+// when the memoized function is used from a single thread, use the gtl::NullMutex
+// so we don't incur any locking cost.
+// ------------------------------------------------------------------------------
+template<class F, size_t N = 4, class Policy = gtl::lru_policy, class Stats = gtl::no_cache_stats>
+using memoize_lru = mt_memoize_lru<F, N, gtl::NullMutex, Policy, Stats>;
+
+// ------------------------------------------------------------------------------
+// Runs the tasks of `async_memoize` in the calling thread.
+// ------------------------------------------------------------------------------
+struct inline_executor
+{
+    template<class Task>
+    void operator()(Task&& task) const
+    {
+        std::forward<Task>(task)();
+    }
+};
+
+// ------------------------------------------------------------------------------
+// Given a callable object (often a slow function), this class provides a new
+// callable which returns a `std::shared_future` of the result. On the first
+// call with given arguments, it stores a new future in the hash map and passes
+// a task computing the result to `executor` (for example to post it to a
+// thread pool), then returns the future without waiting. The following calls
+// with the same arguments, including the ones made while the result is being
+// computed, return the same future.
+//
+// The executor is called with a copyable `void()` callable, without holding any
+// lock, and must run it once (it may run it before returning), or throw
+// without running it, which stores the exception in the future. If the function
+// throws, the exception is stored in the future, and the entry is erased so
+// that a later call computes it again. The memoizer must outlive the tasks.
+//
+// As with `mt_memoize`, the results are kept in a `gtl::parallel_flat_hash_map`
+// of 2^N submaps, each with its own `Mutex`.
+// ------------------------------------------------------------------------------
+template<class F,
+         size_t N       = 6,
+         class Mutex    = std::mutex,
+         class Executor = inline_executor,
+         class          = this_pack_helper<F>>
+class async_memoize;
+
+template<class F, size_t N, class Mutex, class Executor, class... Args>
+class async_memoize<F, N, Mutex, Executor, pack<Args...>>
+{
+public:
+    using key_type     = std::tuple<std::remove_cvref_t<Args>...>;
+    using key_ref_type = std::tuple<const std::remove_cvref_t<Args>&...>;
+    using result_type  = decltype(std::declval<F>()(std::declval<Args>()...));
+    using future_type  = std::shared_future<result_type>;
+
+    // the future of a computation, and its promise, which identifies the entry
+    // a failed computation erases (another one may have replaced it)
+    struct entry
     {
-        key_type key(args...);
-        if (result_type res; _cache.if_contains(key, [&](const auto& v, list_type&) { res = v.second->second; }))
+        future_type                      future;
+        const std::promise<result_type>* promise;
+    };
+
+    using map_type = gtl::parallel_flat_hash_map<key_type,
+                                                 entry,
+                                                 priv::memoize_key_hash,
+                                                 priv::memoize_key_eq,
+                                                 std::allocator<std::pair<const key_type, entry>>,
+                                                 N,
+                                                 Mutex>;
+
+    async_memoize(F f, Executor executor = Executor())
+        : _f(std::move(f))
+        , _executor(std::move(executor))
+    {
+    }
+
+    // the future for these arguments, if they were already passed
+    std::optional<future_type> contains(Args... args)
+    {
+        key_ref_type key(args...);
+        if (future_type res;
+            _cache.template if_contains<key_ref_type>(key, [&](const auto& v) { res = v.second.future; }))
             return { res };
         return {};
     }
 
-    result_type operator()(Args... args)
+    future_type operator()(Args... args)
     {
-        key_type    key(args...);
-        result_type res;
-        _cache.lazy_emplace_l(
+        key_ref_type                                key(args...);
+        future_type                                 res;
+        std::shared_ptr<std::promise<result_type>> promise;
+        _cache.template lazy_emplace_l<key_ref_type>(
             key,
-            [&](typename map_type::value_type& v, list_type& l) {
+            [&](typename map_type::value_type& v) {
                 // called only when key was already present
-                res = v.second->second;
-                l.splice(l.begin(), l, v.second);
+                res = v.second.future;
             },
-            [&](const typename map_type::constructor& ctor, list_type& l) {
+            [&](const typename map_type::constructor& ctor) {
                 // construct value_type in place when key not present
-                res = _f(args...);
-                l.push_front(value_type(key, res));
-                ctor(key, l.begin());
-                if (l.size() >= _max_size) {
-                    // remove oldest
-                    auto last = l.end();
-                    last--;
-                    auto to_delete = std::move(last->first);
-                    l.pop_back();
-                    return std::optional<key_type>{ to_delete };
-                }
-                return std::optional<key_type>{};
+                promise = std::make_shared<std::promise<result_type>>();
+                res     = promise->get_future().share();
+                ctor(key_type(key), entry{ res, promise.get() });
             });
+
+        if (promise) {
+            auto task = [this, promise, key = key_type(key)]() {
+                try {
+                    promise->set_value(std::apply(_f, key));
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                    erase_failed(key, *promise);
+                }
+            };
+            try {
+                _executor(std::move(task));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+                erase_failed(key, *promise);
+            }
+        }
         return res;
     }
 
+    // the computations in progress still complete their future
     void   clear() { _cache.clear(); }
-    void   reserve(size_t n) { _cache.reserve(size_t(n * 1.1f)); }
-    void   set_cache_size(size_t max_size) { _max_size = max_size / num_submaps; }
+    void   reserve(size_t n) { _cache.reserve(n); }
     size_t size() const { return _cache.size(); }
 
 private:
+    // erases the entry of `key` if it is still the one of `promise`, and not
+    // a new computation started after a `clear()`. `promise` is alive, so no
+    // other entry can have its address.
+    template<class Key>
+    void erase_failed(const Key& key, const std::promise<result_type>& promise)
+    {
+        _cache.template erase_if<Key>(key, [&](const auto& v) { return v.second.promise == &promise; });
+    }
+
     F        _f;
-    size_t   _max_size;
+    Executor _executor;
     map_type _cache;
 };
 
 // ------------------------------------------------------------------------------
-// when the memoized function is used from a single thread, use the gtl::NullMutex
-// so we don't incur any locking cost.
-// ------------------------------------------------------------------------------
-template<class F, size_t N = 4>
-using memoize_lru = mt_memoize_lru<F, N, gtl::NullMutex>;
-
-// ------------------------------------------------------------------------------
-// Attempting to create a lazy list... not ready for prime time :-)
+// A lazily computed, memoized sequence: element 0 is `first`, and element
+// `idx > 0` is `next(this, idx)`, which may read other elements of the list
+// with `(*p)[i]`. Each element is computed at most once, when first read, and
+// then stays at the same address until the list is destroyed.
+//
+// The elements are stored in chunks of growing sizes (64, 128, 256, ...), which
+// never move, so reading an element already computed takes no lock. Computing
+// the missing ones holds `Mutex`, which must be recursive as `next` reads the
+// previous elements while it is held (`gtl::NullMutex` when a single thread
+// reads the list).
+//
+// When `next(idx)` reads `idx - 1`, reading a far element would recurse once
+// per missing element and could overflow the stack. So before computing an
+// element, the elements every `warm_up_step` indices after the last one
+// computed are computed first, which limits the recursion depth to
+// `warm_up_step`.
+//
+// see example: examples/memoize/memoize_primes.cpp
 // ------------------------------------------------------------------------------
-template<class T, class F>
+template<class T, class F, class Mutex = std::recursive_mutex>
 class lazy_list
 {
 public:
+    static constexpr size_t warm_up_step = 512;
+
     lazy_list(T first, F next)
-        : _first(std::move(first))
-        , _next(std::move(next))
+        : _next(std::move(next))
     {
+        slot& s = get_slot(0);
+        new (s.storage) T(std::move(first));
+        s.ready.store(true, std::memory_order_release);
     }
 
-#if 1
-    // wrong implementation, because it calls _next instead of the memoized version
-    const T& operator[](size_t idx) const
+    lazy_list(const lazy_list&)            = delete;
+    lazy_list& operator=(const lazy_list&) = delete;
+
+    ~lazy_list()
     {
-        if (idx == 0)
-            return _first;
-        return _next(this, idx);
+        for (size_t c = 0; c < num_chunks; ++c) {
+            slot* chunk = _chunks[c].load(std::memory_order_relaxed);
+            if (!chunk)
+                continue;
+            for (size_t i = 0; i < chunk_size(c); ++i)
+                if (chunk[i].ready.load(std::memory_order_relaxed))
+                    chunk[i].value()->~T();
+            delete[] chunk;
+        }
     }
-#else
-    // can't get this to build unfortunately
+
     const T& operator[](size_t idx) const
     {
-        auto _memoized_next{ gtl::memoize<decltype(_next)>(_next) };
-        if (idx == 0)
-            return _first;
-        return _memoized_next(this, idx);
+        if (const slot* s = find(idx))
+            return *s->value();
+        return materialize(idx);
     }
-#endif
+
+    // true if element `idx` was already computed
+    bool contains(size_t idx) const { return find(idx) != nullptr; }
 
 private:
-    using mem_next = T (*)(size_t idx, const T& first, F&& next);
-    // using memo_t = decltype(std::declval< gtl::memoize<F>(std::declval<F>()) >());
-
-#if 0
-    template <class F>
-    static T logify_recursion(F &f, size_t start, size_t end) {
-        // untested!
-        if (start == 0) {
-            auto hit = f.contains(end);
-            if (hit)
-                return *hit;
-        }
+    struct slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::atomic<bool> ready{ false };
+
+        T*       value() { return std::launder(reinterpret_cast<T*>(storage)); }
+        const T* value() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+    };
 
-        size_t width = end - start;
-        if (width > 64) {
-            (void)f(start + width / 2);
-            return logify_recursion(f, start + width / 2, end);
+    // chunk `c` holds the `64 << c` elements from `64 * (2^c - 1)`
+    static constexpr size_t first_chunk_bits = 6;
+    static constexpr size_t num_chunks       = std::numeric_limits<size_t>::digits - first_chunk_bits + 1;
+
+    static size_t chunk_of(size_t idx) { return std::bit_width((idx >> first_chunk_bits) + 1) - 1; }
+    static size_t chunk_start(size_t c) { return ((size_t(1) << c) - 1) << first_chunk_bits; }
+    static size_t chunk_size(size_t c) { return size_t(1) << (c + first_chunk_bits); }
+
+    // the slot of element `idx` if it was computed, otherwise nullptr
+    const slot* find(size_t idx) const
+    {
+        size_t      c     = chunk_of(idx);
+        const slot* chunk = _chunks[c].load(std::memory_order_acquire);
+        if (!chunk)
+            return nullptr;
+        const slot& s = chunk[idx - chunk_start(c)];
+        return s.ready.load(std::memory_order_acquire) ? &s : nullptr;
+    }
+
+    // the slot of element `idx`, allocating its chunk if needed. Called with
+    // `_mutex` held (or from the constructor).
+    slot& get_slot(size_t idx) const
+    {
+        size_t c     = chunk_of(idx);
+        slot*  chunk = _chunks[c].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new slot[chunk_size(c)];
+            _chunks[c].store(chunk, std::memory_order_release);
         }
+        return chunk[idx - chunk_start(c)];
+    }
 
-        return f(end);
+    const T& materialize(size_t idx) const
+    {
+        std::lock_guard<Mutex> lock(_mutex);
+        for (size_t i = _last + warm_up_step; i < idx; i += warm_up_step)
+            (void)(*this)[i];
+
+        slot& s = get_slot(idx);
+        if (!s.ready.load(std::memory_order_relaxed)) { // unless computed by another thread meanwhile
+            T value = _next(this, idx);
+            new (s.storage) T(std::move(value));
+            s.ready.store(true, std::memory_order_release);
+            _last = (std::max)(_last, idx);
+        }
+        return *s.value();
     }
-#endif
 
-    T _first;
-    F _next;
+    F                                                  _next;
+    mutable Mutex                                      _mutex;
+    mutable std::array<std::atomic<slot*>, num_chunks> _chunks{};
+    mutable size_t                                     _last = 0; // the largest index computed
 };
 
 } // namespace gtl
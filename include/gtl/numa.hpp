@@ -0,0 +1,296 @@
+#ifndef gtl_numa_hpp_guard
+#define gtl_numa_hpp_guard
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+//
+// NUMA aware placement of the submaps of the gtl parallel hash containers.
+//
+// - `gtl::numa_allocator<T>` is a stateful allocator which places its large
+//   allocations on a given NUMA node (using `mbind`).
+// - `gtl::numa_placement` maps each submap index to a node (round-robin, or
+//   with a user supplied function).
+// - `gtl::numa_place(map, placement)` gives each submap of a parallel hash
+//   container (whose `Alloc` is a `numa_allocator`) an allocator for its node,
+//   so that all its slot arrays are allocated there.
+// - `placement.local_submaps(map.subcnt())` returns the submaps placed on the
+//   node of the calling thread, so that work can be routed to them.
+//
+// No library is required: the `mbind`, `set_mempolicy` and `getcpu` system
+// calls are used directly on Linux. Elsewhere (or when a call fails) memory is
+// placed by the OS default first-touch policy, and the system is reported as
+// having a single node.
+// ---------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "gtl/huge_page_allocator.hpp"
+
+#if defined(__linux__)
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define GTL_HAVE_NUMA_SYSCALLS 1
+#else
+    #define GTL_HAVE_NUMA_SYSCALLS 0
+#endif
+
+namespace gtl {
+
+namespace numa {
+
+namespace priv {
+// from <linux/mempolicy.h>
+constexpr int kMpolPreferred = 1;
+
+constexpr size_t kMaxNodes = 1024;
+} // namespace priv
+
+// Number of NUMA nodes (the highest node id + 1), 1 when unknown.
+// ---------------------------------------------------------------------------
+inline int num_nodes()
+{
+    static const int n = []() {
+#if GTL_HAVE_NUMA_SYSCALLS
+        int highest = 0;
+        for (int i = 0; i < (int)priv::kMaxNodes; ++i) {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", i);
+            if (::access(path, F_OK) == 0)
+                highest = i;
+        }
+        return highest + 1;
+#else
+        return 1;
+#endif
+    }();
+    return n;
+}
+
+// NUMA node of the cpu the calling thread currently runs on, 0 when unknown.
+// ---------------------------------------------------------------------------
+inline int current_node()
+{
+#if GTL_HAVE_NUMA_SYSCALLS && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return (int)node;
+#endif
+    return 0;
+}
+
+// Asks the kernel to place the pages of [p, p + len) on `node`. `p` must be
+// page aligned. Pages fall back to other nodes if `node` is full (preferred
+// rather than strict binding). Returns false if the policy could not be set,
+// in which case pages are placed on first touch.
+// ---------------------------------------------------------------------------
+inline bool bind_memory(void* p, size_t len, int node)
+{
+#if GTL_HAVE_NUMA_SYSCALLS && defined(SYS_mbind)
+    if (node < 0 || node >= (int)priv::kMaxNodes)
+        return false;
+    unsigned long mask[priv::kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    return ::syscall(SYS_mbind, p, len, priv::kMpolPreferred, mask, priv::kMaxNodes, 0) == 0;
+#else
+    (void)p;
+    (void)len;
+    (void)node;
+    return false;
+#endif
+}
+
+// Makes `node` the preferred node for all further allocations of the calling
+// thread (`node < 0` restores the default local policy).
+// ---------------------------------------------------------------------------
+inline bool set_preferred_node(int node)
+{
+#if GTL_HAVE_NUMA_SYSCALLS && defined(SYS_set_mempolicy)
+    if (node < 0)
+        return ::syscall(SYS_set_mempolicy, 0, nullptr, 0) == 0; // MPOL_DEFAULT
+    if (node >= (int)priv::kMaxNodes)
+        return false;
+    unsigned long mask[priv::kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    return ::syscall(SYS_set_mempolicy, priv::kMpolPreferred, mask, priv::kMaxNodes) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+} // namespace numa
+
+// ---------------------------------------------------------------------------
+// numa_allocator: allocations of at least `Threshold` bytes are mapped with
+// `mmap` (on huge pages when possible, see `huge_page_allocator`) and bound to
+// the allocator's node. Smaller allocations, and all allocations of a default
+// constructed allocator (node -1), use `std::allocator` and first touch.
+//
+// The allocator is stateful, and propagates on container copy, move and swap,
+// so that a submap keeps its node.
+// ---------------------------------------------------------------------------
+template<class T, size_t Threshold = gtl::priv::huge_page_mmap::huge_page_size>
+class numa_allocator
+{
+public:
+    using value_type                             = T;
+    using size_type                              = size_t;
+    using difference_type                        = ptrdiff_t;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    template<class U>
+    struct rebind
+    {
+        using other = numa_allocator<U, Threshold>;
+    };
+
+    numa_allocator() noexcept = default;
+
+    explicit numa_allocator(int node) noexcept
+        : node_(node)
+    {
+    }
+
+    template<class U>
+    numa_allocator(const numa_allocator<U, Threshold>& o) noexcept
+        : node_(o.node())
+    {
+    }
+
+    int node() const noexcept { return node_; }
+
+    T* allocate(size_t n)
+    {
+        if (n > (std::numeric_limits<size_t>::max)() / sizeof(T))
+            throw std::bad_array_new_length();
+        size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes))
+            return std::allocator<T>().allocate(n);
+        void* p = gtl::priv::huge_page_mmap::map(bytes);
+        if (!p)
+            throw std::bad_alloc();
+        numa::bind_memory(p, gtl::priv::huge_page_mmap::round_up(bytes), node_);
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes))
+            std::allocator<T>().deallocate(p, n);
+        else
+            gtl::priv::huge_page_mmap::unmap(p, bytes);
+    }
+
+    bool use_mmap(size_t bytes) const noexcept { return GTL_HAVE_MMAP && node_ >= 0 && bytes >= Threshold; }
+
+    template<class U>
+    friend bool operator==(const numa_allocator& a, const numa_allocator<U, Threshold>& b) noexcept
+    {
+        return a.node() == b.node();
+    }
+
+    template<class U>
+    friend bool operator!=(const numa_allocator& a, const numa_allocator<U, Threshold>& b) noexcept
+    {
+        return !(a == b);
+    }
+
+private:
+    int node_ = -1;
+};
+
+// ---------------------------------------------------------------------------
+// numa_placement: which NUMA node each submap is placed on.
+// ---------------------------------------------------------------------------
+class numa_placement
+{
+public:
+    // submap `i` is placed on node `i % num_nodes`
+    numa_placement()
+        : numa_placement(numa::num_nodes())
+    {
+    }
+
+    explicit numa_placement(int num_nodes)
+        : node_of_([num_nodes](size_t idx) { return (int)(idx % (size_t)num_nodes); })
+    {
+    }
+
+    // user supplied mapping from submap index to node
+    explicit numa_placement(std::function<int(size_t)> node_of)
+        : node_of_(std::move(node_of))
+    {
+    }
+
+    int node_of(size_t submap_idx) const { return node_of_(submap_idx); }
+
+    // indices of the submaps placed on `node` (by default the node of the
+    // calling thread)
+    std::vector<size_t> local_submaps(size_t num_submaps, int node = numa::current_node()) const
+    {
+        std::vector<size_t> res;
+        for (size_t i = 0; i < num_submaps; ++i)
+            if (node_of(i) == node)
+                res.push_back(i);
+        return res;
+    }
+
+    // node of the submap holding `key` in the parallel hash container `m`
+    template<class PHS, class K>
+    int node_of_key(const PHS& m, const K& key) const
+    {
+        return node_of(m.subidx(m.hash(key)));
+    }
+
+private:
+    std::function<int(size_t)> node_of_;
+};
+
+// ---------------------------------------------------------------------------
+// Gives each submap of the parallel hash container `m` an allocator bound to
+// its node according to `placement`. The `Alloc` of `m` must be a
+// `numa_allocator`. Values already present are moved to memory on the new
+// node, so this is best called right after construction or `reserve()`.
+//
+// Only the submaps' slot arrays are placed. The submap objects themselves
+// (lock and table header) are part of `m` and live wherever `m` was allocated.
+// ---------------------------------------------------------------------------
+template<class PHS>
+void numa_place(PHS& m, const numa_placement& placement = numa_placement())
+{
+    for (size_t i = 0; i < m.subcnt(); ++i) {
+        m.with_submap_m(i, [&](typename PHS::EmbeddedSet& set) {
+            using Set = typename PHS::EmbeddedSet;
+            typename Set::allocator_type alloc(placement.node_of(i));
+            if (set.get_allocator() == alloc)
+                return;
+            size_t cap = set.capacity();
+            Set    tmp(std::move(set), alloc);
+            if (tmp.capacity() < cap)
+                tmp.rehash(cap);
+            set = std::move(tmp);
+        });
+    }
+}
+
+} // namespace gtl
+
+#endif // gtl_numa_hpp_guard
@@ -1841,15 +1841,20 @@ public:
     template<class K = key_type, class F, class C>
     decltype(auto) lazy_emplace_at(size_t& idx, F&& f, C& c)
     {
-        slot_type* slot = slots_ + idx;
-        return std::forward<F>(f)(constructor(&alloc_ref(), &slot), c);
+        slot_type*     slot = slots_ + idx;
+        cancel_insert  guard{ this, idx, &slot };
+        decltype(auto) res = std::forward<F>(f)(constructor(&alloc_ref(), &slot), c);
+        guard.self         = nullptr;
+        return res;
     }
 
     template<class K = key_type, class F>
     void lazy_emplace_at(size_t& idx, F&& f)
     {
-        slot_type* slot = slots_ + idx;
+        slot_type*    slot = slots_ + idx;
+        cancel_insert guard{ this, idx, &slot };
         std::forward<F>(f)(constructor(&alloc_ref(), &slot));
+        guard.self = nullptr;
         assert(!slot);
     }
 
@@ -1983,11 +1988,13 @@ public:
     }
 
 #if !defined(GTL_NON_DETERMINISTIC)
+    // Saves a header describing the layout of the table, then the table and
+    // its CRC-32C. `phmap_load` rejects the files with a different header.
     template<typename OutputArchive>
     bool phmap_dump(OutputArchive&) const;
 
     template<typename InputArchive>
-    bool phmap_load(InputArchive&);
+    bool phmap_load(InputArchive&, dump_load_mode mode = dump_load_mode::verify);
 #endif
 
     void rehash(size_t n)
@@ -2596,6 +2603,17 @@ protected:
 private:
     friend struct RawHashSetTestOnlyAccess;
 
+#if !defined(GTL_NON_DETERMINISTIC)
+    // the table and its CRC-32C, without the header (saved once for all the
+    // submaps of a parallel_hash_set). The files saved before the header was
+    // added have no CRC either.
+    template<typename OutputArchive>
+    bool phmap_dump_table(OutputArchive&) const;
+
+    template<typename InputArchive>
+    bool phmap_load_table(InputArchive&, dump_load_mode mode, bool with_crc = true);
+#endif
+
     probe_seq<Group::kWidth> probe(size_t hashval) const
     {
         return probe_seq<Group::kWidth>(H1(hashval, ctrl_), capacity_);
@@ -2611,6 +2629,31 @@ private:
 
     void reset_growth_left(size_t capacity) { growth_left() = CapacityToGrowth(capacity) - size_; }
 
+    // Runs when the lazy_emplace callback throws (the control byte isn't set yet).
+    // If the value was already constructed (`*slot` reset by `constructor`), it
+    // is kept, as the callback may have recorded it elsewhere. Otherwise the
+    // reservation made by `prepare_insert()` returning `idx` is undone.
+    struct cancel_insert
+    {
+        raw_hash_set* self;
+        size_t        idx;
+        slot_type**   slot;
+
+        ~cancel_insert()
+        {
+            if (!self)
+                return;
+            if (!*slot) {
+                size_t hashval = PolicyTraits::apply(HashElement{ self->hash_ref() },
+                                                     PolicyTraits::element(self->slots_ + idx));
+                self->set_ctrl(idx, H2(hashval));
+            } else {
+                --self->size_;
+                self->growth_left() += IsEmpty(self->ctrl_[idx]);
+            }
+        }
+    };
+
     size_t& growth_left() { return settings_.template get<0>(); }
 
     template<size_t N,
@@ -3756,7 +3799,7 @@ public:
             UniqueLock m(inner);
             inner.set_.clear();
             if constexpr (!std::is_same_v<gtl::priv::empty, aux_type>)
-                inner->aux_.clear();
+                inner.aux_.clear();
         }
     }
 
@@ -3768,7 +3811,7 @@ public:
         UniqueLock m(inner);
         inner.set_.clear();
         if constexpr (!std::is_same_v<gtl::priv::empty, aux_type>)
-            inner->aux_.clear();
+            inner.aux_.clear();
     }
 
     // This overload kicks in when the argument is an rvalue of insertable and
@@ -4134,6 +4177,10 @@ public:
     // if map does not contains key, the second lambda is called and it should invoke the
     // passed constructor to construct the value
     // returns true if key was not already present, false otherwise.
+    //
+    // with an AuxCont, the second lambda returns the keys to erase (still under the write
+    // lock) once the value is constructed: either an optional key, or a range of keys.
+    // The first lambda may return them too.
     // ---------------------------------------------------------------------------------------
     template<class K = key_type, class FExists, class FEmplace>
     bool lazy_emplace_l(const key_arg<K>& key, FExists&& fExists, FEmplace&& fEmplace)
@@ -4149,8 +4196,7 @@ public:
             } else {
                 auto del = inner->set_.lazy_emplace_at(std::get<1>(res), std::forward<FEmplace>(fEmplace), inner->aux_);
                 inner->set_.set_ctrl(std::get<1>(res), H2(hashval));
-                if (del)
-                    inner->set_.erase(*del);
+                erase_keys(*inner, del);
             }
         } else {
             auto it = this->iterator_at(inner, inner->set_.iterator_at(std::get<1>(res)));
@@ -4158,8 +4204,11 @@ public:
 
             if constexpr (std::is_same_v<gtl::priv::empty, aux_type>)
                 std::forward<FExists>(fExists)(const_cast<value_type&>(*it));
-            else
+            else if constexpr (std::is_void_v<decltype(std::forward<FExists>(fExists)(const_cast<value_type&>(*it),
+                                                                                      inner->aux_))>)
                 std::forward<FExists>(fExists)(const_cast<value_type&>(*it), inner->aux_);
+            else
+                erase_keys(*inner, std::forward<FExists>(fExists)(const_cast<value_type&>(*it), inner->aux_));
         }
         return std::get<2>(res);
     }
@@ -4366,7 +4415,7 @@ public:
     void reserve(size_t n)
     {
         size_t target     = GrowthToLowerboundCapacity(n);
-        size_t normalized = 16 * NormalizeCapacity(n / num_tables);
+        size_t normalized = num_tables * NormalizeCapacity(n / num_tables);
         rehash(normalized > target ? normalized : target);
     }
 
@@ -4524,10 +4573,25 @@ public:
     bool phmap_dump(OutputArchive& ar) const;
 
     template<typename InputArchive>
-    bool phmap_load(InputArchive& ar);
+    bool phmap_load(InputArchive& ar, dump_load_mode mode = dump_load_mode::verify);
+
+    // Same as phmap_dump / phmap_load, to a file starting with the offset and
+    // size of each submap, so that the submaps are written and read by
+    // `num_threads` threads at once (0: one per hardware thread).
+    bool phmap_dump_parallel(const char* file_path, size_t num_threads = 0) const;
+
+    bool phmap_load_parallel(const char* file_path,
+                             size_t         num_threads = 0,
+                             dump_load_mode mode        = dump_load_mode::verify);
 #endif
 
 private:
+#if !defined(GTL_NON_DETERMINISTIC)
+    // the number of submaps and their tables, which follow the header
+    template<typename InputArchive>
+    bool phmap_load_submaps(InputArchive& ar, dump_load_mode mode, bool with_crc);
+#endif
+
     template<class Container, typename Enabler>
     friend struct hashtable_debug_internal::HashtableDebugAccess;
 
@@ -4677,6 +4741,18 @@ private:
     allocator_type&       alloc_ref() { return sets_[0].set_.alloc_ref(); }
     const allocator_type& alloc_ref() const { return sets_[0].set_.alloc_ref(); }
 
+    // erases from `inner` the keys returned by a `lazy_emplace_l` lambda: either
+    // an optional key, or a range of keys
+    template<class Del>
+    static void erase_keys(Inner& inner, const Del& del)
+    {
+        if constexpr (requires { del.begin(); del.end(); }) {
+            for (const auto& k : del)
+                inner.set_.erase(k);
+        } else if (del)
+            inner.set_.erase(*del);
+    }
+
 protected: // protected in case users want to derive fromm this
     std::array<Inner, num_tables> sets_;
 };
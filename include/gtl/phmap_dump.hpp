@@ -19,10 +19,33 @@
 // limitations under the License.
 // ---------------------------------------------------------------------------
 
+#include "crc32c.hpp"
 #include "phmap.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if GTL_HAVE_MMAP // from gtl_config.hpp
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
 
 namespace gtl {
 
@@ -45,12 +68,202 @@ struct IsTriviallyCopyable<std::pair<T1, T2>>
 {
     static constexpr bool value = IsTriviallyCopyable<T1>::value && IsTriviallyCopyable<T2>::value;
 };
+
+// std::pair and std::tuple, saved member by member by `binary_serializer`
+template<class T>
+struct IsTupleLike : std::false_type
+{
+};
+
+template<class T1, class T2>
+struct IsTupleLike<std::pair<T1, T2>> : std::true_type
+{
+};
+
+template<class... Ts>
+struct IsTupleLike<std::tuple<Ts...>> : std::true_type
+{
+};
+
+// contiguous sequences, saved as their size followed by their elements
+template<class T>
+struct IsContiguousSequence : std::false_type
+{
+};
+
+template<class C, class Tr, class A>
+struct IsContiguousSequence<std::basic_string<C, Tr, A>> : std::true_type
+{
+};
+
+template<class T, class A>
+struct IsContiguousSequence<std::vector<T, A>> : std::bool_constant<!std::is_same_v<T, bool>>
+{
+};
 }
 
 namespace priv {
 
 #if !defined(GTL_NON_DETERMINISTIC) && !defined(GTL_DISABLE_DUMP)
 
+// cereal's archives return void and throw on errors
+template<typename OutputArchive>
+bool dump_save(OutputArchive& ar, const void* p, size_t sz)
+{
+    if constexpr (std::is_void_v<decltype(ar.saveBinary(p, sz))>) {
+        ar.saveBinary(p, sz);
+        return true;
+    } else {
+        return ar.saveBinary(p, sz);
+    }
+}
+
+template<typename InputArchive>
+bool dump_load(InputArchive& ar, void* p, size_t sz)
+{
+    if constexpr (std::is_void_v<decltype(ar.loadBinary(p, sz))>) {
+        ar.loadBinary(p, sz);
+        return true;
+    } else {
+        return ar.loadBinary(p, sz);
+    }
+}
+
+// the number of bytes left to load from the archive, when it knows it
+template<typename InputArchive>
+size_t dump_remaining(const InputArchive& ar)
+{
+    if constexpr (requires { ar.remaining(); })
+        return ar.remaining();
+    else
+        return (std::numeric_limits<size_t>::max)();
+}
+
+// ------------------------------------------------------------------------
+// The header starting the files saved by phmap_dump and phmap_dump_parallel.
+// The tables are saved as they are in memory, so they can only be loaded by
+// a container with the same layout: same version of the format (bumped when
+// the layout of the tables or the hash functions of gtl change), byte
+// order, size of size_t, group width, slot size, and hash function
+// (`hash_check` is the hash of a value-initialized key, 0 when the key is
+// not default constructible).
+// ------------------------------------------------------------------------
+struct dump_header
+{
+    static constexpr uint16_t current_version = 1;
+    static constexpr uint16_t byte_order_mark = 0x0102;
+
+    char     magic[4]    = { 'G', 'T', 'L', 'D' };
+    uint16_t version     = current_version;
+    uint16_t byte_order  = byte_order_mark;
+    uint8_t  size_t_size = uint8_t(sizeof(size_t));
+    uint8_t  group_width = uint8_t(Group::kWidth);
+    uint16_t slot_size   = 0;
+    uint32_t reserved    = 0;
+    uint64_t hash_check  = 0;
+
+    template<class Set>
+    static dump_header of(const Set& set)
+    {
+        using key_type = typename Set::key_type;
+        dump_header h;
+        h.slot_size = uint16_t(sizeof(typename Set::slot_type));
+        if constexpr (std::is_default_constructible_v<key_type>)
+            h.hash_check = uint64_t(set.hash_function()(key_type{}));
+        return h;
+    }
+
+    // prints the first difference with `expected` to std::cerr
+    bool matches(const dump_header& expected) const
+    {
+        const char* error = nullptr;
+        if (byte_order != expected.byte_order)
+            error = "saved on a machine with a different byte order";
+        else if (version != expected.version)
+            error = "saved with a different version of the dump format";
+        else if (size_t_size != expected.size_t_size || group_width != expected.group_width ||
+                 slot_size != expected.slot_size)
+            error = "saved with a different table layout (size_t, group width or slot size)";
+        else if (hash_check != expected.hash_check)
+            error = "saved with a different hash function";
+        if (error)
+            std::cerr << "phmap_load: " << error << std::endl;
+        return error == nullptr;
+    }
+};
+
+static_assert(sizeof(dump_header) == 24, "the header is saved as is");
+
+// ------------------------------------------------------------------------
+// An output archive which only counts the bytes saved
+// ------------------------------------------------------------------------
+struct byte_count_archive
+{
+    uint64_t size = 0;
+
+    bool saveBinary(const void*, size_t sz)
+    {
+        size += sz;
+        return true;
+    }
+};
+
+// ------------------------------------------------------------------------
+// The files saved before the header was added start with the first table
+// (or the number of submaps) instead, and have no CRCs. When the magic is
+// missing, the bytes read as the start of a header are loaded again, before
+// the rest of the file, by this archive.
+// ------------------------------------------------------------------------
+template<typename InputArchive>
+struct legacy_dump_archive
+{
+    static constexpr size_t prefix_size = offsetof(dump_header, size_t_size);
+
+    InputArchive& ar;
+    char          prefix[prefix_size] = {};
+    size_t        prefix_used = 0;
+
+    bool loadBinary(void* p, size_t sz)
+    {
+        size_t n = (std::min)(sz, prefix_size - prefix_used);
+        std::memcpy(p, prefix + prefix_used, n);
+        prefix_used += n;
+        return n == sz || dump_load(ar, static_cast<char*>(p) + n, sz - n);
+    }
+
+    size_t remaining() const
+    {
+        size_t n = dump_remaining(ar);
+        return (std::min)(n, (std::numeric_limits<size_t>::max)() - prefix_size) + (prefix_size - prefix_used);
+    }
+};
+
+enum class dump_format
+{
+    invalid,
+    legacy, // no header, continue loading from `legacy`
+    current
+};
+
+template<class Set, typename InputArchive>
+dump_format load_dump_header(const Set& set, legacy_dump_archive<InputArchive>& legacy)
+{
+    dump_header h;
+    auto        header_bytes = reinterpret_cast<char*>(&h);
+    if (!dump_load(legacy.ar, legacy.prefix, legacy.prefix_size)) {
+        std::cerr << "phmap_load: failed to read the header" << std::endl;
+        return dump_format::invalid;
+    }
+    std::memcpy(header_bytes, legacy.prefix, legacy.prefix_size);
+    if (std::memcmp(h.magic, dump_header().magic, sizeof(h.magic)) != 0)
+        return dump_format::legacy;
+    if (!dump_load(legacy.ar, header_bytes + legacy.prefix_size, sizeof(h) - legacy.prefix_size)) {
+        std::cerr << "phmap_load: failed to read the header" << std::endl;
+        return dump_format::invalid;
+    }
+    return h.matches(dump_header::of(set)) ? dump_format::current : dump_format::invalid;
+}
+
 // ------------------------------------------------------------------------
 // dump/load for raw_hash_set
 // ------------------------------------------------------------------------
@@ -61,38 +274,110 @@ bool raw_hash_set<Policy, Hash, Eq, Alloc>::phmap_dump(OutputArchive& ar) const
     static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
                   "value_type should be trivially copyable");
 
-    ar.saveBinary(&size_, sizeof(size_t));
-    ar.saveBinary(&capacity_, sizeof(size_t));
-    if (size_ == 0)
-        return true;
-    ar.saveBinary(ctrl_, sizeof(ctrl_t) * (capacity_ + Group::kWidth + 1));
-    ar.saveBinary(slots_, sizeof(slot_type) * capacity_);
-    return true;
+    auto header = dump_header::of(*this);
+    return dump_save(ar, &header, sizeof(header)) && phmap_dump_table(ar);
 }
 
 template<class Policy, class Hash, class Eq, class Alloc>
 template<typename InputArchive>
-bool raw_hash_set<Policy, Hash, Eq, Alloc>::phmap_load(InputArchive& ar)
+bool raw_hash_set<Policy, Hash, Eq, Alloc>::phmap_load(InputArchive& ar, dump_load_mode mode)
 {
     static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
                   "value_type should be trivially copyable");
-    raw_hash_set<Policy, Hash, Eq, Alloc>().swap(*this); // clear any existing content
-    ar.loadBinary(&size_, sizeof(size_t));
-    ar.loadBinary(&capacity_, sizeof(size_t));
 
+    legacy_dump_archive<InputArchive> legacy{ ar };
+    switch (load_dump_header(*this, legacy)) {
+        case dump_format::current:
+            return phmap_load_table(ar, mode);
+        case dump_format::legacy:
+            return phmap_load_table(legacy, mode, false);
+        default:
+            raw_hash_set(0, hash_ref(), eq_ref(), alloc_ref()).swap(*this);
+            return false;
+    }
+}
+
+// size, capacity, the control bytes and the slots (when not empty), and the
+// CRC-32C of all of them
+template<class Policy, class Hash, class Eq, class Alloc>
+template<typename OutputArchive>
+bool raw_hash_set<Policy, Hash, Eq, Alloc>::phmap_dump_table(OutputArchive& ar) const
+{
+    constexpr bool counting = std::is_same_v<OutputArchive, byte_count_archive>; // no need for the CRC
+
+    uint32_t crc = 0;
+    if (!counting)
+        crc = crc32c(crc32c(0, &size_, sizeof(size_t)), &capacity_, sizeof(size_t));
+    if (!dump_save(ar, &size_, sizeof(size_t)) || !dump_save(ar, &capacity_, sizeof(size_t)))
+        return false;
+    if (size_ != 0) {
+        const size_t ctrl_bytes = sizeof(ctrl_t) * (capacity_ + Group::kWidth + 1);
+        const size_t slot_bytes = sizeof(slot_type) * capacity_;
+        if (!counting)
+            crc = crc32c(crc32c(crc, ctrl_, ctrl_bytes), slots_, slot_bytes);
+        if (!dump_save(ar, ctrl_, ctrl_bytes) || !dump_save(ar, slots_, slot_bytes))
+            return false;
+    }
+    return dump_save(ar, &crc, sizeof(crc));
+}
+
+template<class Policy, class Hash, class Eq, class Alloc>
+template<typename InputArchive>
+bool raw_hash_set<Policy, Hash, Eq, Alloc>::phmap_load_table(InputArchive& ar, dump_load_mode mode, bool with_crc)
+{
+    // clear any existing content, keeping the allocator (e.g. the node of a numa_allocator)
+    raw_hash_set(0, hash_ref(), eq_ref(), alloc_ref()).swap(*this);
+    size_t size = 0, capacity = 0;
+    if (!dump_load(ar, &size, sizeof(size_t)) || !dump_load(ar, &capacity, sizeof(size_t)) || size > capacity ||
+        (capacity != 0 && !IsValidCapacity(capacity)))
+        return false;
+
+    // `capacity` comes from the file, which may be corrupted: don't allocate
+    // more control bytes and slots than are left to load (the table of an
+    // empty map is not saved, so it is loaded with no capacity)
+    if (size != 0 && capacity > dump_remaining(ar) / (sizeof(ctrl_t) + sizeof(slot_type))) {
+        std::cerr << "phmap_load: the capacity is larger than the file" << std::endl;
+        return false;
+    }
+
+    if (!with_crc)
+        mode = dump_load_mode::trust;
+    uint32_t crc = 0;
+    if (mode == dump_load_mode::verify)
+        crc = crc32c(crc32c(0, &size, sizeof(size_t)), &capacity, sizeof(size_t));
+    size_     = size;
+    capacity_ = size != 0 ? capacity : 0;
     if (capacity_) {
         // allocate memory for ctrl_ and slots_
         initialize_slots(capacity_);
     }
-    if (size_ == 0)
-        return true;
-    ar.loadBinary(ctrl_, sizeof(ctrl_t) * (capacity_ + Group::kWidth + 1));
-    ar.loadBinary(slots_, sizeof(slot_type) * capacity_);
-    return true;
+
+    bool ok = true;
+    if (size_ != 0) {
+        const size_t ctrl_bytes = sizeof(ctrl_t) * (capacity_ + Group::kWidth + 1);
+        const size_t slot_bytes = sizeof(slot_type) * capacity_;
+        ok = dump_load(ar, ctrl_, ctrl_bytes) && dump_load(ar, slots_, slot_bytes);
+        if (ok && mode == dump_load_mode::verify)
+            crc = crc32c(crc32c(crc, ctrl_, ctrl_bytes), slots_, slot_bytes);
+    }
+    uint32_t saved_crc = 0;
+    ok                 = ok && (!with_crc || dump_load(ar, &saved_crc, sizeof(saved_crc)));
+    if (ok && mode == dump_load_mode::verify && saved_crc != crc) {
+        std::cerr << "phmap_load: CRC mismatch, the file is corrupted" << std::endl;
+        ok = false;
+    }
+    if (!ok && size_ != 0) {
+        // the slots are trivially copyable, so nothing needs to be destroyed
+        size_ = 0;
+        reset_ctrl(capacity_);
+        reset_growth_left(capacity_);
+    }
+    return ok;
 }
 
 // ------------------------------------------------------------------------
-// dump/load for parallel_hash_set
+// dump/load for parallel_hash_set: the header, the number of submaps, and
+// the tables of the submaps
 // ------------------------------------------------------------------------
 template<size_t N,
          template<class, class, class, class>
@@ -109,12 +394,14 @@ bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap
     static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
                   "value_type should be trivially copyable");
 
+    auto   header       = dump_header::of(*this);
     size_t submap_count = subcnt();
-    ar.saveBinary(&submap_count, sizeof(size_t));
+    if (!dump_save(ar, &header, sizeof(header)) || !dump_save(ar, &submap_count, sizeof(size_t)))
+        return false;
     for (size_t i = 0; i < sets_.size(); ++i) {
         auto&                         inner = sets_[i];
         typename Lockable::UniqueLock m(const_cast<Inner&>(inner));
-        if (!inner.set_.phmap_dump(ar)) {
+        if (!inner.set_.phmap_dump_table(ar)) {
             std::cerr << "Failed to dump submap " << i << std::endl;
             return false;
         }
@@ -132,23 +419,60 @@ template<size_t N,
          class Eq,
          class Alloc>
 template<typename InputArchive>
-bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap_load(InputArchive& ar)
+bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap_load(InputArchive&  ar,
+                                                                                      dump_load_mode mode)
 {
     static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
                   "value_type should be trivially copyable");
 
+    legacy_dump_archive<InputArchive> legacy{ ar };
+    switch (load_dump_header(*this, legacy)) {
+        case dump_format::current:
+            return phmap_load_submaps(ar, mode, true);
+        case dump_format::legacy:
+            return phmap_load_submaps(legacy, mode, false);
+        default:
+            clear();
+            return false;
+    }
+}
+
+template<size_t N,
+         template<class, class, class, class>
+         class RefSet,
+         class Mtx_,
+         class AuxCont,
+         class Policy,
+         class Hash,
+         class Eq,
+         class Alloc>
+template<typename InputArchive>
+bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap_load_submaps(InputArchive&  ar,
+                                                                                              dump_load_mode mode,
+                                                                                              bool with_crc)
+{
     size_t submap_count = 0;
-    ar.loadBinary(&submap_count, sizeof(size_t));
+    if (!dump_load(ar, &submap_count, sizeof(size_t))) {
+        clear();
+        return false;
+    }
     if (submap_count != subcnt()) {
         std::cerr << "submap count(" << submap_count << ") != N(" << N << ")" << std::endl;
+        clear();
         return false;
     }
 
     for (size_t i = 0; i < submap_count; ++i) {
-        auto&                         inner = sets_[i];
-        typename Lockable::UniqueLock m(const_cast<Inner&>(inner));
-        if (!inner.set_.phmap_load(ar)) {
+        bool ok;
+        {
+            auto&                         inner = sets_[i];
+            typename Lockable::UniqueLock m(const_cast<Inner&>(inner));
+            ok = inner.set_.phmap_load_table(ar, mode, with_crc);
+        }
+        if (!ok) {
+            // as `phmap_load_parallel()`, don't keep the submaps already loaded
             std::cerr << "Failed to load submap " << i << std::endl;
+            clear();
             return false;
         }
     }
@@ -162,6 +486,10 @@ bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap
 // ------------------------------------------------------------------------
 // BinaryArchive
 //       File is closed when archive object is destroyed
+//
+// `saveBinary` / `loadBinary` return false once the stream failed (for
+// example when the file could not be opened, the disk is full, or the file
+// is shorter than expected), as does `ok()`.
 // ------------------------------------------------------------------------
 
 // ------------------------------------------------------------------------
@@ -174,17 +502,19 @@ public:
         ofs_.open(file_path, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
     }
 
+    bool ok() const { return ofs_.good(); }
+
     bool saveBinary(const void* p, size_t sz)
     {
         ofs_.write(reinterpret_cast<const char*>(p), sz);
-        return true;
+        return ofs_.good();
     }
 
     template<typename V>
     typename std::enable_if<type_traits_internal::IsTriviallyCopyable<V>::value, bool>::type saveBinary(const V& v)
     {
         ofs_.write(reinterpret_cast<const char*>(&v), sizeof(V));
-        return true;
+        return ofs_.good();
     }
 
     template<typename Map>
@@ -193,6 +523,20 @@ public:
         return v.phmap_dump(*this);
     }
 
+    bool flush()
+    {
+        ofs_.flush();
+        return ofs_.good();
+    }
+
+    // closes the file, returns true if all the writes succeeded
+    bool close()
+    {
+        if (ofs_.is_open())
+            ofs_.close();
+        return ofs_.good();
+    }
+
 private:
     std::ofstream ofs_;
 };
@@ -200,19 +544,32 @@ private:
 class BinaryInputArchive
 {
 public:
-    BinaryInputArchive(const char* file_path) { ifs_.open(file_path, std::ofstream::in | std::ofstream::binary); }
+    BinaryInputArchive(const char* file_path)
+    {
+        ifs_.open(file_path, std::ofstream::in | std::ofstream::binary);
+        if (ifs_.seekg(0, std::ios::end)) {
+            auto end = ifs_.tellg();
+            if (ifs_.seekg(0, std::ios::beg) && end >= 0)
+                remaining_ = size_t(end);
+        }
+    }
+
+    bool ok() const { return ifs_.good(); }
+
+    // the number of bytes left in the file
+    size_t remaining() const { return remaining_; }
 
     bool loadBinary(void* p, size_t sz)
     {
         ifs_.read(reinterpret_cast<char*>(p), sz);
-        return true;
+        remaining_ -= (std::min)(remaining_, size_t(ifs_.gcount()));
+        return ifs_.good();
     }
 
     template<typename V>
     typename std::enable_if<type_traits_internal::IsTriviallyCopyable<V>::value, bool>::type loadBinary(V* v)
     {
-        ifs_.read(reinterpret_cast<char*>(v), sizeof(V));
-        return true;
+        return loadBinary(v, sizeof(V));
     }
 
     template<typename Map>
@@ -223,6 +580,536 @@ public:
 
 private:
     std::ifstream ifs_;
+    size_t        remaining_ = (std::numeric_limits<size_t>::max)();
+};
+
+#if GTL_HAVE_MMAP
+
+// ------------------------------------------------------------------------
+// Same as BinaryOutputArchive, without iostreams: small writes are gathered
+// in a 1 MiB buffer, and larger ones (such as the slots of a hash map) are
+// written from the caller's memory with `pwritev`, along with the buffered
+// bytes, without copying them.
+//
+// `error()` returns the `errno` of the first failure (0 if none), after
+// which nothing more is written. The file is closed by `close()` or by the
+// destructor: call `close()` to know if the last writes succeeded.
+//
+// An archive can also write to an open file from a given `offset`, without
+// closing it, so that several threads write different parts of the file.
+// ------------------------------------------------------------------------
+class BufferedOutputArchive
+{
+public:
+    static constexpr size_t buffer_size = size_t(1) << 20;
+
+    BufferedOutputArchive(const char* file_path)
+        : fd_(::open(file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+        , owns_fd_(true)
+    {
+        if (fd_ < 0)
+            error_ = errno;
+        else
+            buf_.reset(new char[buffer_size]);
+    }
+
+    BufferedOutputArchive(int fd, uint64_t offset)
+        : fd_(fd)
+        , owns_fd_(false)
+        , offset_(offset)
+        , buf_(new char[buffer_size])
+    {
+    }
+
+    BufferedOutputArchive(const BufferedOutputArchive&)            = delete;
+    BufferedOutputArchive& operator=(const BufferedOutputArchive&) = delete;
+
+    ~BufferedOutputArchive() { close(); }
+
+    bool ok() const { return error_ == 0; }
+    int  error() const { return error_; }
+    int  fd() const { return fd_; }
+
+    // the offset in the file of the next byte saved
+    uint64_t offset() const { return offset_ + used_; }
+
+    bool saveBinary(const void* p, size_t sz)
+    {
+        if (error_)
+            return false;
+        if (sz <= buffer_size - used_) {
+            std::memcpy(buf_.get() + used_, p, sz);
+            used_ += sz;
+            return true;
+        }
+        if (sz < buffer_size) {
+            if (!flush())
+                return false;
+            std::memcpy(buf_.get(), p, sz);
+            used_ = sz;
+            return true;
+        }
+        struct iovec iov[2] = { { buf_.get(), used_ }, { const_cast<void*>(p), sz } };
+        used_ = 0;
+        return write_all(iov, 2);
+    }
+
+    template<typename V>
+    typename std::enable_if<type_traits_internal::IsTriviallyCopyable<V>::value, bool>::type saveBinary(const V& v)
+    {
+        return saveBinary(&v, sizeof(V));
+    }
+
+    template<typename Map>
+    auto saveBinary(const Map& v) -> decltype(v.phmap_dump(*this), bool())
+    {
+        return v.phmap_dump(*this);
+    }
+
+    // writes the buffered bytes to the file
+    bool flush()
+    {
+        if (error_)
+            return false;
+        struct iovec iov = { buf_.get(), used_ };
+        used_            = 0;
+        return write_all(&iov, 1);
+    }
+
+    // flushes and closes the file (if opened by the archive), returns true
+    // if all the writes succeeded
+    bool close()
+    {
+        if (fd_ < 0)
+            return ok();
+        flush();
+        if (owns_fd_ && ::close(fd_) != 0 && !error_)
+            error_ = errno;
+        fd_ = -1;
+        return ok();
+    }
+
+private:
+    bool write_all(struct iovec* iov, int cnt)
+    {
+        for (;;) {
+            for (; cnt > 0 && iov->iov_len == 0; ++iov, --cnt)
+                ;
+            if (cnt == 0)
+                break;
+            ssize_t n = ::pwritev(fd_, iov, cnt, off_t(offset_));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                error_ = n < 0 ? errno : EIO;
+                return false;
+            }
+            // skip what was written, which may end in the middle of a buffer
+            size_t done = size_t(n);
+            offset_ += done;
+            for (; cnt > 0 && done >= iov->iov_len; ++iov, --cnt)
+                done -= iov->iov_len;
+            if (cnt > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+                iov->iov_len -= done;
+            }
+        }
+        return true;
+    }
+
+    int                     fd_;
+    bool                    owns_fd_;
+    int                     error_  = 0;
+    uint64_t                offset_ = 0; // of the first buffered byte
+    size_t                  used_   = 0;
+    std::unique_ptr<char[]> buf_;
+};
+
+// ------------------------------------------------------------------------
+// Same as BinaryInputArchive, reading from a read-only mapping of the file:
+// small loads copy the bytes straight from the page cache, with no system
+// call. Loads of at least `pread_size` bytes (such as the slots of a hash
+// map) are read with `pread` into the caller's memory instead, which copies
+// them once, rather than faulting in the pages of the mapping and then
+// copying them.
+//
+// `error()` returns the `errno` of the failure to open, map or read the file,
+// or `EIO` after reading past its end (0 if none), after which nothing more is
+// read.
+//
+// An archive can also read `size` bytes from `offset` in the file of another
+// archive, which must outlive it, or `size` bytes at `data`.
+// ------------------------------------------------------------------------
+class MmapInputArchive
+{
+public:
+    static constexpr size_t pread_size = size_t(1) << 20;
+
+    MmapInputArchive(const char* data, size_t size)
+        : data_(data)
+        , size_(size)
+        , owns_data_(false)
+    {
+    }
+
+    MmapInputArchive(const MmapInputArchive& file, uint64_t offset, size_t size)
+        : data_(file.data_ + offset)
+        , size_(size)
+        , fd_(file.fd_)
+        , fd_offset_(file.fd_offset_ + offset)
+        , owns_data_(false)
+    {
+    }
+
+    MmapInputArchive(const char* file_path)
+    {
+        int fd = ::open(file_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error_ = errno;
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            error_ = errno;
+        } else if (st.st_size > 0) {
+            void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error_ = errno;
+            } else {
+                data_ = static_cast<const char*>(p);
+                size_ = size_t(st.st_size);
+    #ifdef MADV_SEQUENTIAL
+                ::madvise(p, size_, MADV_SEQUENTIAL); // only a hint, failure is fine
+    #endif
+            }
+        }
+        if (data_)
+            fd_ = fd; // for the large loads
+        else
+            ::close(fd);
+    }
+
+    MmapInputArchive(const MmapInputArchive&)            = delete;
+    MmapInputArchive& operator=(const MmapInputArchive&) = delete;
+
+    ~MmapInputArchive()
+    {
+        if (data_ && owns_data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+            ::close(fd_);
+        }
+    }
+
+    bool ok() const { return error_ == 0; }
+    int  error() const { return error_; }
+
+    const char* data() const { return data_; }
+    size_t      size() const { return size_; }
+    size_t      remaining() const { return size_ - pos_; }
+
+    bool loadBinary(void* p, size_t sz)
+    {
+        if (error_)
+            return false;
+        if (sz > size_ - pos_) {
+            error_ = EIO;
+            return false;
+        }
+        if (sz >= pread_size && fd_ >= 0) {
+            if (!read_all(static_cast<char*>(p), sz))
+                return false;
+        } else if (sz) { // `data_` is nullptr for an empty file
+            std::memcpy(p, data_ + pos_, sz);
+        }
+        pos_ += sz;
+        return true;
+    }
+
+    template<typename V>
+    typename std::enable_if<type_traits_internal::IsTriviallyCopyable<V>::value, bool>::type loadBinary(V* v)
+    {
+        return loadBinary(v, sizeof(V));
+    }
+
+    template<typename Map>
+    auto loadBinary(Map* v) -> decltype(v->phmap_load(*this), bool())
+    {
+        return v->phmap_load(*this);
+    }
+
+private:
+    bool read_all(char* p, size_t sz)
+    {
+        for (size_t done = 0; done < sz;) {
+            ssize_t n = ::pread(fd_, p + done, sz - done, off_t(fd_offset_ + pos_ + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                error_ = n < 0 ? errno : EIO;
+                return false;
+            }
+            done += size_t(n);
+        }
+        return true;
+    }
+
+    const char* data_      = nullptr;
+    size_t      size_      = 0;
+    size_t      pos_       = 0;
+    int         fd_        = -1;
+    uint64_t    fd_offset_ = 0; // of data_[0] in the file
+    int         error_     = 0;
+    bool        owns_data_ = true;
+};
+
+#else
+
+// without mmap and writev, the same as the iostream archives
+using BufferedOutputArchive = BinaryOutputArchive;
+using MmapInputArchive      = BinaryInputArchive;
+
+#endif // GTL_HAVE_MMAP
+
+namespace priv {
+
+#if !defined(GTL_NON_DETERMINISTIC) && !defined(GTL_DISABLE_DUMP)
+
+// ------------------------------------------------------------------------
+// Calls `f(i)` for each `i` in [0, n), from up to `num_threads` threads (0:
+// one per hardware thread) including the calling one. Returns true if all
+// the calls returned true. An exception thrown by `f` is rethrown once all
+// the threads are done.
+// ------------------------------------------------------------------------
+template<class F>
+bool parallel_for_index(size_t n, size_t num_threads, F&& f)
+{
+    if (num_threads == 0)
+        num_threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+    num_threads = (std::min)(num_threads, n);
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool>   ok{ true };
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+    auto                work = [&]() {
+        try {
+            for (size_t i; (i = next.fetch_add(1)) < n;)
+                if (!f(i))
+                    ok = false;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            error = std::current_exception();
+            next  = n; // stop the other threads
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+        threads.emplace_back(work);
+    work();
+    for (auto& t : threads)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+    return ok;
+}
+
+// ------------------------------------------------------------------------
+// parallel dump/load for parallel_hash_set. The file contains:
+// - the header (see dump_header),
+// - the number of submaps (uint64_t),
+// - the offset in the file and the size of each submap (2 uint64_t each),
+// - the tables of the submaps, each followed by its CRC-32C.
+// All the submaps are locked (shared) during the dump, so that they are
+// saved as they were at the same time, and their sizes don't change between
+// the computation of the offsets and the writes.
+// ------------------------------------------------------------------------
+template<size_t N,
+         template<class, class, class, class>
+         class RefSet,
+         class Mtx_,
+         class AuxCont,
+         class Policy,
+         class Hash,
+         class Eq,
+         class Alloc>
+bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap_dump_parallel(
+    const char* file_path,
+    [[maybe_unused]] size_t num_threads) const
+{
+    static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
+                  "value_type should be trivially copyable");
+
+    std::vector<SharedLock> locks;
+    locks.reserve(sets_.size());
+    for (auto& inner : sets_)
+        locks.emplace_back(const_cast<Inner&>(inner));
+
+    const auto            header       = dump_header::of(*this);
+    const uint64_t        submap_count = subcnt();
+    std::vector<uint64_t> index(2 * submap_count);
+    uint64_t              offset = sizeof(header) + sizeof(uint64_t) * (1 + index.size());
+    for (size_t i = 0; i < submap_count; ++i) {
+        byte_count_archive counter;
+        sets_[i].set_.phmap_dump_table(counter);
+        index[2 * i]     = offset;
+        index[2 * i + 1] = counter.size;
+        offset += counter.size;
+    }
+
+    BufferedOutputArchive ar(file_path);
+    bool ok = ar.saveBinary(header) && ar.saveBinary(submap_count) &&
+              ar.saveBinary(index.data(), index.size() * sizeof(uint64_t));
+    #if GTL_HAVE_MMAP
+    ok = ok && ar.flush() && parallel_for_index(submap_count, num_threads, [&](size_t i) {
+             BufferedOutputArchive sub(ar.fd(), index[2 * i]);
+             return sets_[i].set_.phmap_dump_table(sub) && sub.close();
+         });
+    #else
+    for (size_t i = 0; ok && i < submap_count; ++i)
+        ok = sets_[i].set_.phmap_dump_table(ar); // the submaps are contiguous
+    #endif
+    return ar.close() && ok;
+}
+
+template<size_t N,
+         template<class, class, class, class>
+         class RefSet,
+         class Mtx_,
+         class AuxCont,
+         class Policy,
+         class Hash,
+         class Eq,
+         class Alloc>
+bool parallel_hash_set<N, RefSet, Mtx_, AuxCont, Policy, Hash, Eq, Alloc>::phmap_load_parallel(
+    const char* file_path,
+    [[maybe_unused]] size_t num_threads,
+    dump_load_mode          mode)
+{
+    static_assert(type_traits_internal::IsTriviallyCopyable<value_type>::value,
+                  "value_type should be trivially copyable");
+
+    MmapInputArchive                      ar(file_path);
+    legacy_dump_archive<MmapInputArchive> legacy{ ar };
+    uint64_t                              submap_count = 0;
+    std::vector<uint64_t>                 index;
+    switch (load_dump_header(*this, legacy)) {
+        case dump_format::current:
+            break;
+        case dump_format::legacy: // saved by phmap_dump, with no offset index
+            return phmap_load_submaps(legacy, mode, false);
+        default:
+            clear();
+            return false;
+    }
+    if (!ar.loadBinary(&submap_count) || submap_count != subcnt()) {
+        clear();
+        return false;
+    }
+    index.resize(2 * submap_count);
+    bool ok = ar.loadBinary(index.data(), index.size() * sizeof(uint64_t));
+    try {
+    #if GTL_HAVE_MMAP
+        ok = ok && parallel_for_index(submap_count, num_threads, [&](size_t i) {
+                 uint64_t offset = index[2 * i], size = index[2 * i + 1];
+                 if (offset > ar.size() || size > ar.size() - offset)
+                     return false;
+                 MmapInputArchive sub(ar, offset, size);
+                 Inner&           inner = sets_[i];
+                 UniqueLock       m(inner);
+                 return inner.set_.phmap_load_table(sub, mode);
+             });
+    #else
+        for (size_t i = 0; ok && i < submap_count; ++i) {
+            UniqueLock m(sets_[i]);
+            ok = sets_[i].set_.phmap_load_table(ar, mode); // the submaps are contiguous
+        }
+    #endif
+    } catch (...) {
+        clear(); // as on failure, don't keep the submaps already loaded
+        throw;
+    }
+    if (!ok)
+        clear();
+    return ok;
+}
+
+#endif // !defined(GTL_NON_DETERMINISTIC) && !defined(GTL_DISABLE_DUMP)
+
+} // namespace priv
+
+// ------------------------------------------------------------------------
+// Saves and loads single values to and from an archive: trivially copyable
+// values as their bytes, std::pair and std::tuple member by member, and
+// std::basic_string and std::vector as their size followed by their
+// elements. Used by the containers which are saved entry by entry (such as
+// the memoizers of memoize.hpp), which also take a user provided serializer,
+// with the same `save` and `load` members, for other types.
+// ------------------------------------------------------------------------
+struct binary_serializer
+{
+    template<class OutputArchive, class T>
+    bool save(OutputArchive& ar, const T& v) const
+    {
+        if constexpr (type_traits_internal::IsTriviallyCopyable<T>::value) {
+            return ar.saveBinary(&v, sizeof(T));
+        } else if constexpr (type_traits_internal::IsTupleLike<T>::value) {
+            return std::apply([&](const auto&... e) { return (save(ar, e) && ...); }, v);
+        } else if constexpr (type_traits_internal::IsContiguousSequence<T>::value) {
+            using elem_type = typename T::value_type;
+            size_t n        = v.size();
+            if (!ar.saveBinary(&n, sizeof(size_t)))
+                return false;
+            if constexpr (type_traits_internal::IsTriviallyCopyable<elem_type>::value) {
+                return n == 0 || ar.saveBinary(v.data(), n * sizeof(elem_type));
+            } else {
+                for (const auto& e : v)
+                    if (!save(ar, e))
+                        return false;
+                return true;
+            }
+        } else {
+            static_assert(sizeof(T) == 0, "binary_serializer can't save this type, provide a serializer");
+            return false;
+        }
+    }
+
+    template<class InputArchive, class T>
+    bool load(InputArchive& ar, T& v) const
+    {
+        if constexpr (type_traits_internal::IsTriviallyCopyable<T>::value) {
+            return ar.loadBinary(&v, sizeof(T));
+        } else if constexpr (type_traits_internal::IsTupleLike<T>::value) {
+            return std::apply([&](auto&... e) { return (load(ar, e) && ...); }, v);
+        } else if constexpr (type_traits_internal::IsContiguousSequence<T>::value) {
+            using elem_type = typename T::value_type;
+            size_t n        = 0;
+            if (!ar.loadBinary(&n, sizeof(size_t)))
+                return false;
+            // `n` comes from the file: grow `v` by at most 1 MiB at a time, so
+            // that a corrupted length fails at the end of the archive instead
+            // of allocating that much memory upfront
+            constexpr size_t chunk = (std::max)(size_t(1), (size_t(1) << 20) / sizeof(elem_type));
+            v.clear();
+            for (size_t done = 0; done < n;) {
+                size_t cnt = (std::min)(n - done, chunk);
+                v.resize(done + cnt);
+                if constexpr (type_traits_internal::IsTriviallyCopyable<elem_type>::value) {
+                    if (!ar.loadBinary(v.data() + done, cnt * sizeof(elem_type)))
+                        return false;
+                } else {
+                    for (size_t i = done; i < done + cnt; ++i)
+                        if (!load(ar, v[i]))
+                            return false;
+                }
+                done += cnt;
+            }
+            return true;
+        } else {
+            static_assert(sizeof(T) == 0, "binary_serializer can't load this type, provide a serializer");
+            return false;
+        }
+    }
 };
 
 } // namespace gtl
@@ -50,6 +50,15 @@ using Pair = typename std::pair<T1, T2>;
 
 class NullMutex;
 
+// How `phmap_load` checks the tables it reads (see gtl/phmap_dump.hpp): the
+// header of the file is always checked, and with `verify` the CRC-32C of
+// each table as well. `trust` skips the CRCs, for files known to be intact.
+enum class dump_load_mode
+{
+    verify,
+    trust
+};
+
 namespace priv {
 
 // The hash of an object of type T is computed by using gtl::Hash.
@@ -0,0 +1,619 @@
+#ifndef gtl_soa_hash_map_hpp_guard_
+#define gtl_soa_hash_map_hpp_guard_
+
+// ---------------------------------------------------------------------------
+// Copyright (c) 2022, Gregory Popovitch - greg7mdp@gmail.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "gtl/phmap.hpp"
+
+namespace gtl {
+
+// ------------------------------------------------------------------------------
+// soa_flat_hash_map: a flat hash map storing keys and values in two separate
+// arrays (structure of arrays), which share the control bytes of the
+// `raw_hash_set` scheme (same Group / H1 / H2 probing).
+//
+// With `gtl::flat_hash_map`, each slot is a `std::pair<const K, V>`, so when
+// `V` is large every key compared during probing drags its value into cache.
+// Here probing only touches the control bytes and the key array, and the value
+// is loaded once, on a hit. This is worthwhile when values are much larger than
+// keys (say 64 bytes or more) and many lookups are membership tests or misses.
+// When every lookup hits and reads the value, the extra cache miss on the value
+// array usually makes `gtl::flat_hash_map` faster (see
+// benchmarks/soa_hash_map_bench.cpp).
+//
+// The API follows `gtl::flat_hash_map`, except that since keys and values are
+// not stored together, iterators dereference to a `std::pair<const K&, V&>`
+// proxy rather than to a `value_type&`.
+// ------------------------------------------------------------------------------
+template<class K,
+         class V,
+         class Hash  = gtl::priv::hash_default_hash<K>,
+         class Eq    = gtl::priv::hash_default_eq<K>,
+         class Alloc = gtl::priv::Allocator<gtl::priv::Pair<const K, V>>> // alias for std::allocator
+class soa_flat_hash_map
+{
+    using ctrl_t = priv::ctrl_t;
+    using h2_t   = priv::h2_t;
+    using Group  = priv::Group;
+
+    using KeyAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<K>;
+    using KeyTraits = std::allocator_traits<KeyAlloc>;
+    using ValAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<V>;
+    using ValTraits = std::allocator_traits<ValAlloc>;
+
+public:
+    using key_type        = K;
+    using mapped_type     = V;
+    using value_type      = std::pair<const K, V>;
+    using init_type       = std::pair<K, V>;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Eq;
+    using allocator_type  = Alloc;
+    using reference       = std::pair<const K&, V&>;
+    using const_reference = std::pair<const K&, const V&>;
+
+    // ------------------------------------------------------------------------
+    template<bool is_const>
+    class iterator_impl
+    {
+        friend class soa_flat_hash_map;
+        template<bool>
+        friend class iterator_impl;
+
+        using key_ptr = const K*;
+        using val_ptr = std::conditional_t<is_const, const V*, V*>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename soa_flat_hash_map::value_type;
+        using reference         = std::conditional_t<is_const, const_reference, typename soa_flat_hash_map::reference>;
+        using difference_type   = typename soa_flat_hash_map::difference_type;
+
+        struct pointer
+        {
+            reference  ref;
+            reference* operator->() { return &ref; }
+        };
+
+        iterator_impl() = default;
+
+        // conversion from iterator to const_iterator
+        template<bool c = is_const, std::enable_if_t<c, int> = 0>
+        iterator_impl(const iterator_impl<false>& o)
+            : ctrl_(o.ctrl_)
+            , key_(o.key_)
+            , val_(o.val_)
+        {
+        }
+
+        reference operator*() const { return { *key_, *val_ }; }
+        pointer   operator->() const { return { **this }; }
+
+        iterator_impl& operator++()
+        {
+            ++ctrl_;
+            ++key_;
+            ++val_;
+            skip_empty_or_deleted();
+            return *this;
+        }
+
+        iterator_impl operator++(int)
+        {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) { return a.ctrl_ == b.ctrl_; }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) { return !(a == b); }
+
+    private:
+        iterator_impl(const ctrl_t* ctrl, key_ptr key, val_ptr val)
+            : ctrl_(ctrl)
+            , key_(key)
+            , val_(val)
+        {
+        }
+
+        void skip_empty_or_deleted()
+        {
+            while (priv::IsEmptyOrDeleted(*ctrl_)) {
+                uint32_t shift = Group{ ctrl_ }.CountLeadingEmptyOrDeleted();
+                ctrl_ += shift;
+                key_ += shift;
+                val_ += shift;
+            }
+        }
+
+        const ctrl_t* ctrl_ = nullptr;
+        key_ptr       key_  = nullptr;
+        val_ptr       val_  = nullptr;
+    };
+
+    using iterator       = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    // ------------------------------------------------------------------------
+    soa_flat_hash_map() noexcept(std::is_nothrow_default_constructible_v<hasher> &&
+                                 std::is_nothrow_default_constructible_v<key_equal> &&
+                                 std::is_nothrow_default_constructible_v<allocator_type>)
+    {
+    }
+
+    explicit soa_flat_hash_map(size_t                bucket_count,
+                               const hasher&         hash  = hasher(),
+                               const key_equal&      eq    = key_equal(),
+                               const allocator_type& alloc = allocator_type())
+        : hash_(hash)
+        , eq_(eq)
+        , alloc_(alloc)
+    {
+        if (bucket_count)
+            resize(priv::NormalizeCapacity(bucket_count));
+    }
+
+    soa_flat_hash_map(std::initializer_list<value_type> init,
+                      size_t                            bucket_count = 0,
+                      const hasher&                     hash         = hasher(),
+                      const key_equal&                  eq           = key_equal(),
+                      const allocator_type&             alloc        = allocator_type())
+        : soa_flat_hash_map(bucket_count, hash, eq, alloc)
+    {
+        insert(init.begin(), init.end());
+    }
+
+    soa_flat_hash_map(const soa_flat_hash_map& o)
+        : hash_(o.hash_)
+        , eq_(o.eq_)
+        , alloc_(o.alloc_)
+    {
+        reserve(o.size());
+        for (auto it = o.begin(); it != o.end(); ++it)
+            try_emplace(it->first, it->second);
+    }
+
+    soa_flat_hash_map(soa_flat_hash_map&& o) noexcept
+        : hash_(std::move(o.hash_))
+        , eq_(std::move(o.eq_))
+        , alloc_(std::move(o.alloc_))
+    {
+        steal(o);
+    }
+
+    soa_flat_hash_map& operator=(const soa_flat_hash_map& o)
+    {
+        if (this != &o) {
+            soa_flat_hash_map tmp(o);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    soa_flat_hash_map& operator=(soa_flat_hash_map&& o) noexcept
+    {
+        if (this != &o) {
+            destroy_slots();
+            hash_  = std::move(o.hash_);
+            eq_    = std::move(o.eq_);
+            alloc_ = std::move(o.alloc_);
+            steal(o);
+        }
+        return *this;
+    }
+
+    ~soa_flat_hash_map() { destroy_slots(); }
+
+    // ------------------------------------------------------------------------
+    iterator begin()
+    {
+        iterator it(ctrl_, keys_, vals_);
+        it.skip_empty_or_deleted();
+        return it;
+    }
+    iterator end() { return { ctrl_ + capacity_, keys_ + capacity_, vals_ + capacity_ }; }
+
+    const_iterator begin() const { return const_cast<soa_flat_hash_map*>(this)->begin(); }
+    const_iterator end() const { return const_cast<soa_flat_hash_map*>(this)->end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool   empty() const { return !size(); }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    size_t max_size() const { return (std::numeric_limits<size_t>::max)(); }
+    float  load_factor() const { return capacity_ ? static_cast<float>(size_) / capacity_ : 0.0f; }
+
+    hasher         hash_function() const { return hash_; }
+    key_equal      key_eq() const { return eq_; }
+    allocator_type get_allocator() const { return alloc_; }
+
+    void clear()
+    {
+        if (!capacity_)
+            return;
+        for (size_t i = 0; i != capacity_; ++i) {
+            if (priv::IsFull(ctrl_[i])) {
+                destroy_at(i);
+            }
+        }
+        size_ = 0;
+        reset_ctrl(capacity_);
+        growth_left_ = priv::CapacityToGrowth(capacity_);
+    }
+
+    void reserve(size_t n)
+    {
+        size_t m = priv::GrowthToLowerboundCapacity(n);
+        if (m > capacity_)
+            resize(priv::NormalizeCapacity(m));
+    }
+
+    void rehash(size_t n)
+    {
+        if (n == 0 && capacity_ == 0)
+            return;
+        if (n == 0 && size_ == 0) {
+            destroy_slots();
+            return;
+        }
+        auto m = priv::NormalizeCapacity((std::max)(n, priv::GrowthToLowerboundCapacity(size())));
+        if (n == 0 || m > capacity_)
+            resize(m);
+    }
+
+    // ------------------------------------------------------------------------
+    template<class... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args)
+    {
+        return try_emplace_impl(k, std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args)
+    {
+        return try_emplace_impl(std::move(k), std::forward<Args>(args)...);
+    }
+
+    // emplace(k, args...) constructs the key from `k` and the value from
+    // `args`. A single pair argument, or `std::piecewise_construct` with two
+    // tuples, is first turned into an `init_type` and split into key and value.
+    template<class KK, class... Args>
+    std::pair<iterator, bool> emplace(KK&& k, Args&&... args)
+    {
+        if constexpr (sizeof...(Args) == 0 || std::is_same_v<std::decay_t<KK>, std::piecewise_construct_t>) {
+            init_type v(std::forward<KK>(k), std::forward<Args>(args)...);
+            return try_emplace_impl(std::move(v.first), std::move(v.second));
+        } else {
+            return try_emplace_impl(key_type(std::forward<KK>(k)), std::forward<Args>(args)...);
+        }
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+
+    // `init_type` has a non-const key, so both members can be moved from
+    template<class P, std::enable_if_t<std::is_constructible_v<init_type, P&&>, int> = 0>
+    std::pair<iterator, bool> insert(P&& p)
+    {
+        init_type v(std::forward<P>(p));
+        return try_emplace_impl(std::move(v.first), std::move(v.second));
+    }
+
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+
+    template<class M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj)
+    {
+        auto res = try_emplace_impl(k, std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    mapped_type& operator[](const key_type& k) { return try_emplace_impl(k).first->second; }
+    mapped_type& operator[](key_type&& k) { return try_emplace_impl(std::move(k)).first->second; }
+
+    mapped_type& at(const key_type& k)
+    {
+        size_t i = find_index(k, hash(k));
+        if (i == npos)
+            throw std::out_of_range("gtl soa_flat_hash_map::at failed bounds check");
+        return vals_[i];
+    }
+
+    const mapped_type& at(const key_type& k) const { return const_cast<soa_flat_hash_map*>(this)->at(k); }
+
+    // ------------------------------------------------------------------------
+    iterator find(const key_type& k)
+    {
+        size_t i = find_index(k, hash(k));
+        return i == npos ? end() : iterator_at(i);
+    }
+
+    const_iterator find(const key_type& k) const { return const_cast<soa_flat_hash_map*>(this)->find(k); }
+
+    bool   contains(const key_type& k) const { return find_index(k, hash(k)) != npos; }
+    size_t count(const key_type& k) const { return contains(k) ? 1 : 0; }
+
+    // ------------------------------------------------------------------------
+    size_t erase(const key_type& k)
+    {
+        size_t i = find_index(k, hash(k));
+        if (i == npos)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    void erase(iterator it) { erase_at(static_cast<size_t>(it.ctrl_ - ctrl_)); }
+    void erase(const_iterator it) { erase_at(static_cast<size_t>(it.ctrl_ - ctrl_)); }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while (first != last) {
+            auto it = first++;
+            erase(it);
+        }
+        return iterator_at(static_cast<size_t>(last.ctrl_ - ctrl_));
+    }
+
+    void swap(soa_flat_hash_map& o) noexcept
+    {
+        using std::swap;
+        swap(ctrl_, o.ctrl_);
+        swap(keys_, o.keys_);
+        swap(vals_, o.vals_);
+        swap(size_, o.size_);
+        swap(capacity_, o.capacity_);
+        swap(growth_left_, o.growth_left_);
+        swap(hash_, o.hash_);
+        swap(eq_, o.eq_);
+        swap(alloc_, o.alloc_);
+    }
+
+    friend void swap(soa_flat_hash_map& a, soa_flat_hash_map& b) noexcept { a.swap(b); }
+
+    friend bool operator==(const soa_flat_hash_map& a, const soa_flat_hash_map& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (auto it = a.begin(); it != a.end(); ++it) {
+            auto other = b.find(it->first);
+            if (other == b.end() || !(other->second == it->second))
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const soa_flat_hash_map& a, const soa_flat_hash_map& b) { return !(a == b); }
+
+private:
+    static constexpr size_t npos = (std::numeric_limits<size_t>::max)();
+
+    // ------------------------------------------------------------------------
+    // Memory layout of the single allocation: `capacity + Group::kWidth` control
+    // bytes (with the sentinel and cloned bytes as in `raw_hash_set`), then the
+    // key array, then the value array.
+    // ------------------------------------------------------------------------
+    static constexpr size_t kAlign = (std::max)({ alignof(K), alignof(V), alignof(size_t) });
+
+    static size_t align_up(size_t n, size_t a) { return (n + a - 1) & ~(a - 1); }
+    static size_t keys_offset(size_t cap) { return align_up(cap + Group::kWidth, alignof(K)); }
+    static size_t vals_offset(size_t cap) { return align_up(keys_offset(cap) + cap * sizeof(K), alignof(V)); }
+    static size_t alloc_size(size_t cap) { return vals_offset(cap) + cap * sizeof(V); }
+
+    size_t hash(const key_type& k) const { return phmap_mix<sizeof(size_t)>()(static_cast<size_t>(hash_(k))); }
+
+    priv::probe_seq<Group::kWidth> probe(size_t hashval) const
+    {
+        return priv::probe_seq<Group::kWidth>(priv::H1(hashval, ctrl_), capacity_);
+    }
+
+    iterator iterator_at(size_t i) { return { ctrl_ + i, keys_ + i, vals_ + i }; }
+
+    size_t find_index(const key_type& k, size_t hashval) const
+    {
+        auto seq = probe(hashval);
+        while (true) {
+            Group g{ ctrl_ + seq.offset() };
+            for (uint32_t i : g.Match((h2_t)priv::H2(hashval))) {
+                size_t idx = seq.offset((size_t)i);
+                if (GTL_PREDICT_TRUE(eq_(keys_[idx], k)))
+                    return idx;
+            }
+            if (GTL_PREDICT_TRUE(g.MatchEmpty()))
+                return npos;
+            seq.next();
+            assert(seq.getindex() < capacity_ + 1 && "full table!");
+        }
+    }
+
+    size_t find_first_non_full(size_t hashval) const
+    {
+        auto seq = probe(hashval);
+        while (true) {
+            Group g{ ctrl_ + seq.offset() };
+            auto  mask = g.MatchEmptyOrDeleted();
+            if (mask)
+                return seq.offset((size_t)mask.LowestBitSet());
+            assert(seq.getindex() < capacity_ && "full table!");
+            seq.next();
+        }
+    }
+
+    template<class KK, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(KK&& k, Args&&... args)
+    {
+        size_t hashval = hash(k);
+        size_t i       = find_index(k, hashval);
+        if (i != npos)
+            return { iterator_at(i), false };
+
+        i = find_first_non_full(hashval);
+        if (GTL_PREDICT_FALSE(growth_left_ == 0 && !priv::IsDeleted(ctrl_[i]))) {
+            rehash_and_grow_if_necessary();
+            i = find_first_non_full(hashval);
+        }
+        KeyAlloc ka(alloc_);
+        KeyTraits::construct(ka, keys_ + i, std::forward<KK>(k));
+        try {
+            ValAlloc va(alloc_);
+            ValTraits::construct(va, vals_ + i, std::forward<Args>(args)...);
+        } catch (...) {
+            KeyTraits::destroy(ka, keys_ + i);
+            throw;
+        }
+        ++size_;
+        growth_left_ -= priv::IsEmpty(ctrl_[i]);
+        set_ctrl(i, priv::H2(hashval));
+        return { iterator_at(i), true };
+    }
+
+    void destroy_at(size_t i)
+    {
+        KeyAlloc ka(alloc_);
+        ValAlloc va(alloc_);
+        KeyTraits::destroy(ka, keys_ + i);
+        ValTraits::destroy(va, vals_ + i);
+    }
+
+    // same logic as `raw_hash_set::erase_meta_only()`
+    void erase_at(size_t index)
+    {
+        assert(priv::IsFull(ctrl_[index]) && "erasing a dangling iterator");
+        destroy_at(index);
+        --size_;
+        const size_t index_before = (index - Group::kWidth) & capacity_;
+        const auto   empty_after  = Group(ctrl_ + index).MatchEmpty();
+        const auto   empty_before = Group(ctrl_ + index_before).MatchEmpty();
+
+        bool was_never_full =
+            empty_before && empty_after &&
+            static_cast<size_t>(empty_after.TrailingZeros() + empty_before.LeadingZeros()) < Group::kWidth;
+
+        set_ctrl(index, was_never_full ? priv::kEmpty : priv::kDeleted);
+        growth_left_ += was_never_full;
+    }
+
+    void set_ctrl(size_t i, ctrl_t h)
+    {
+        assert(i < capacity_);
+        ctrl_[i]                                                                         = h;
+        ctrl_[((i - Group::kWidth) & capacity_) + 1 + ((Group::kWidth - 1) & capacity_)] = h;
+    }
+
+    void reset_ctrl(size_t capacity)
+    {
+        std::memset(ctrl_, priv::kEmpty, capacity + Group::kWidth);
+        ctrl_[capacity] = priv::kSentinel;
+    }
+
+    void rehash_and_grow_if_necessary()
+    {
+        if (capacity_ == 0)
+            resize(1);
+        else if (size() <= priv::CapacityToGrowth(capacity_) / 2)
+            resize(capacity_); // squash deleted slots without growing
+        else
+            resize(capacity_ * 2 + 1);
+    }
+
+    void resize(size_t new_capacity)
+    {
+        assert(priv::IsValidCapacity(new_capacity));
+        ctrl_t*      old_ctrl     = ctrl_;
+        K*           old_keys     = keys_;
+        V*           old_vals     = vals_;
+        const size_t old_capacity = capacity_;
+
+        char* mem    = static_cast<char*>(Allocate<kAlign>(&alloc_, alloc_size(new_capacity)));
+        ctrl_        = reinterpret_cast<ctrl_t*>(mem);
+        keys_        = reinterpret_cast<K*>(mem + keys_offset(new_capacity));
+        vals_        = reinterpret_cast<V*>(mem + vals_offset(new_capacity));
+        capacity_    = new_capacity;
+        growth_left_ = priv::CapacityToGrowth(new_capacity) - size_;
+        reset_ctrl(new_capacity);
+
+        KeyAlloc ka(alloc_);
+        ValAlloc va(alloc_);
+        for (size_t i = 0; i != old_capacity; ++i) {
+            if (priv::IsFull(old_ctrl[i])) {
+                size_t hashval = hash(old_keys[i]);
+                size_t new_i   = find_first_non_full(hashval);
+                set_ctrl(new_i, priv::H2(hashval));
+                KeyTraits::construct(ka, keys_ + new_i, std::move(old_keys[i]));
+                KeyTraits::destroy(ka, old_keys + i);
+                ValTraits::construct(va, vals_ + new_i, std::move(old_vals[i]));
+                ValTraits::destroy(va, old_vals + i);
+            }
+        }
+        if (old_capacity)
+            Deallocate<kAlign>(&alloc_, old_ctrl, alloc_size(old_capacity));
+    }
+
+    void destroy_slots()
+    {
+        if (!capacity_)
+            return;
+        clear();
+        Deallocate<kAlign>(&alloc_, ctrl_, alloc_size(capacity_));
+        ctrl_        = priv::EmptyGroup();
+        keys_        = nullptr;
+        vals_        = nullptr;
+        capacity_    = 0;
+        growth_left_ = 0;
+    }
+
+    void steal(soa_flat_hash_map& o)
+    {
+        ctrl_        = std::exchange(o.ctrl_, priv::EmptyGroup());
+        keys_        = std::exchange(o.keys_, nullptr);
+        vals_        = std::exchange(o.vals_, nullptr);
+        size_        = std::exchange(o.size_, 0);
+        capacity_    = std::exchange(o.capacity_, 0);
+        growth_left_ = std::exchange(o.growth_left_, 0);
+    }
+
+    ctrl_t*        ctrl_        = priv::EmptyGroup(); // [(capacity + 1) * ctrl_t]
+    K*             keys_        = nullptr;            // [capacity * K]
+    V*             vals_        = nullptr;            // [capacity * V]
+    size_t         size_        = 0;                  // number of full slots
+    size_t         capacity_    = 0;                  // total number of slots
+    size_t         growth_left_ = 0;
+    hasher         hash_;
+    key_equal      eq_;
+    allocator_type alloc_;
+};
+
+} // namespace gtl
+
+#endif // gtl_soa_hash_map_hpp_guard_
@@ -0,0 +1,40 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <gtl/crc32c.hpp>
+
+TEST(Crc32cTest, KnownValues)
+{
+    EXPECT_EQ(gtl::crc32c(0, "", 0), 0u);
+    EXPECT_EQ(gtl::crc32c(0, "123456789", 9), 0xE3069283u);
+
+    // RFC 3720 (iSCSI), B.4
+    std::vector<uint8_t> zeros(32, 0), ones(32, 0xff), inc(32);
+    for (size_t i = 0; i < inc.size(); ++i)
+        inc[i] = uint8_t(i);
+    EXPECT_EQ(gtl::crc32c(0, zeros.data(), zeros.size()), 0x8A9136AAu);
+    EXPECT_EQ(gtl::crc32c(0, ones.data(), ones.size()), 0x62A8AB43u);
+    EXPECT_EQ(gtl::crc32c(0, inc.data(), inc.size()), 0x46DD794Eu);
+}
+
+TEST(Crc32cTest, SoftwareMatchesDefault)
+{
+    std::string s;
+    for (size_t i = 0; i < 1000; ++i)
+        s.push_back(char(i * 7919 >> 3));
+    for (size_t len : { 0, 1, 7, 8, 9, 63, 1000 }) {
+        uint32_t sw = ~gtl::priv::crc32c_sw(~0u, reinterpret_cast<const unsigned char*>(s.data()), len);
+        EXPECT_EQ(gtl::crc32c(0, s.data(), len), sw) << len;
+    }
+}
+
+TEST(Crc32cTest, Chains)
+{
+    std::string s = "the quick brown fox jumps over the lazy dog";
+    uint32_t    whole = gtl::crc32c(0, s.data(), s.size());
+    for (size_t cut = 0; cut <= s.size(); ++cut)
+        EXPECT_EQ(gtl::crc32c(gtl::crc32c(0, s.data(), cut), s.data() + cut, s.size() - cut), whole);
+}
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <gtl/delay_queue.hpp>
+
+TEST(DelayQueueTest, DrainReleasesElapsedValuesInOrder)
+{
+    gtl::delay_queue<std::string, 6> q;
+    EXPECT_EQ(q.capacity, 8u);
+    EXPECT_TRUE(q.empty());
+
+    std::string s("one");
+    EXPECT_TRUE(q.try_push(10, std::move(s)));
+    EXPECT_TRUE(q.try_push(20, std::string("two")));
+    EXPECT_TRUE(q.try_push(15, std::string("three"))); // released after "two"
+    EXPECT_EQ(q.size(), 3u);
+
+    std::vector<std::string> out;
+    auto                     f = [&](std::string&& v) { out.push_back(std::move(v)); };
+    EXPECT_EQ(q.drain(9, f), 0u);
+    EXPECT_EQ(q.drain(15, f), 1u);
+    EXPECT_EQ(out, (std::vector<std::string>{ "one" }));
+    EXPECT_EQ(q.drain(20, f), 2u);
+    EXPECT_EQ(out, (std::vector<std::string>{ "one", "two", "three" }));
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(DelayQueueTest, FullQueueLeavesValueUntouched)
+{
+    gtl::delay_queue<std::unique_ptr<int>, 4> q;
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(q.try_push(0, std::make_unique<int>(i)));
+
+    auto p = std::make_unique<int>(4);
+    EXPECT_FALSE(q.try_push(0, std::move(p)));
+    ASSERT_TRUE(p);
+    EXPECT_EQ(*p, 4);
+
+    EXPECT_EQ(q.drain(0), 4u);
+    EXPECT_TRUE(q.try_push(0, std::move(p))); // slots are reused
+    EXPECT_FALSE(p);
+}
+
+TEST(DelayQueueTest, DestructorReleasesValues)
+{
+    auto counted = std::make_shared<int>(0);
+    {
+        gtl::delay_queue<std::shared_ptr<int>, 16> q;
+        for (int i = 0; i < 10; ++i)
+            q.try_push(100, std::shared_ptr<int>(counted));
+        EXPECT_EQ(counted.use_count(), 11);
+    }
+    EXPECT_EQ(counted.use_count(), 1);
+}
+
+TEST(DelayQueueTest, ConcurrentPushAndDrain)
+{
+    constexpr int num_producers = 4;
+    constexpr int per_producer  = 100000;
+
+    gtl::delay_queue<uint64_t, 1024> q;
+    std::atomic<int>                 done{ 0 };
+    std::atomic<uint64_t>            sum{ 0 };
+    std::atomic<size_t>              released{ 0 };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_producers; ++t)
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < per_producer; ++i) {
+                uint64_t v = uint64_t(t) * per_producer + i;
+                while (!q.try_push(0, uint64_t(v)))
+                    std::this_thread::yield();
+            }
+            ++done;
+        });
+    for (int t = 0; t < 2; ++t)
+        threads.emplace_back([&]() {
+            auto f = [&](uint64_t&& v) { sum += v; };
+            while (done < num_producers || !q.empty())
+                released += q.drain(0, f);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    uint64_t n = uint64_t(num_producers) * per_producer;
+    EXPECT_EQ(released, n);
+    EXPECT_EQ(sum, n * (n - 1) / 2);
+}
@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <gtl/epoch.hpp>
+
+TEST(EpochTest, MinPinned)
+{
+    gtl::epoch_domain d;
+    constexpr auto    none = (std::numeric_limits<uint64_t>::max)();
+    EXPECT_EQ(d.min_pinned(), none);
+
+    auto g1 = d.pin();
+    EXPECT_EQ(g1.domain(), &d);
+    uint64_t e1 = d.epoch();
+    EXPECT_EQ(d.min_pinned(), e1);
+
+    d.advance();
+    auto g2 = d.pin();
+    EXPECT_EQ(d.min_pinned(), e1); // g1 still pinned
+
+    g1.release();
+    EXPECT_EQ(d.min_pinned(), e1 + 1);
+
+    gtl::epoch_domain::guard g3(std::move(g2));
+    EXPECT_EQ(g2.domain(), nullptr);
+    EXPECT_EQ(d.min_pinned(), e1 + 1);
+    g3 = gtl::epoch_domain::guard();
+    EXPECT_EQ(d.min_pinned(), none);
+}
+
+TEST(EpochTest, ManyGuards)
+{
+    gtl::epoch_domain                     d;
+    std::vector<gtl::epoch_domain::guard> guards;
+    for (size_t i = 0; i < gtl::epoch_domain::max_pinned; ++i)
+        guards.push_back(d.pin());
+    EXPECT_EQ(d.min_pinned(), d.epoch());
+
+    std::thread t([&]() { auto g = d.pin(); }); // waits for a free slot
+    guards.pop_back();
+    t.join();
+    guards.clear();
+    EXPECT_EQ(d.min_pinned(), (std::numeric_limits<uint64_t>::max)());
+}
@@ -0,0 +1,23 @@
+#ifndef gtl_tests_fake_clock_hpp_
+#define gtl_tests_fake_clock_hpp_
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+
+// a clock which only moves when the tests advance `current`, for the caches
+// with a `ttl_policy`
+struct fake_clock
+{
+    using rep        = int64_t;
+    using period     = std::nano;
+    using duration   = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point<fake_clock>;
+
+    static constexpr bool is_steady = true;
+    static time_point     now() { return current; }
+
+    static inline time_point current{ std::chrono::hours(1000) };
+};
+
+#endif // gtl_tests_fake_clock_hpp_
@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <gtl/huge_page_allocator.hpp>
+#include <gtl/phmap.hpp>
+#include <gtl/vector.hpp>
+
+TEST(HugePageAllocatorTest, SmallAndLarge)
+{
+    gtl::huge_page_allocator<uint64_t> a;
+
+    uint64_t* small = a.allocate(16);
+    small[15]       = 1;
+    a.deallocate(small, 16);
+
+    constexpr size_t n     = (size_t(8) << 20) / sizeof(uint64_t) + 3; // a bit more than 8 MiB
+    uint64_t*        large = a.allocate(n);
+    ASSERT_NE(large, nullptr);
+    if (a.use_mmap(n * sizeof(uint64_t))) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % gtl::priv::huge_page_mmap::huge_page_size, 0u);
+    }
+    for (size_t i = 0; i < n; i += 512)
+        large[i] = i;
+    large[n - 1] = 7;
+    EXPECT_EQ(large[512], 512u);
+    a.deallocate(large, n);
+}
+
+TEST(HugePageAllocatorTest, Rebind)
+{
+    gtl::huge_page_allocator<int> a;
+    using B = std::allocator_traits<gtl::huge_page_allocator<int>>::rebind_alloc<double>;
+    B b(a);
+    EXPECT_TRUE(a == b);
+    static_assert(std::is_same_v<B, gtl::huge_page_allocator<double>>);
+}
+
+TEST(HugePageAllocatorTest, HashMap)
+{
+    using Alloc = gtl::huge_page_allocator<std::pair<const uint64_t, uint64_t>, 1 << 16>;
+    gtl::flat_hash_map<uint64_t, uint64_t, gtl::Hash<uint64_t>, gtl::EqualTo<uint64_t>, Alloc> m;
+    for (uint64_t i = 0; i < 100000; ++i)
+        m[i] = i * 2;
+    for (uint64_t i = 0; i < 100000; ++i)
+        EXPECT_EQ(m[i], i * 2);
+    m.clear();
+    m.rehash(0);
+    EXPECT_TRUE(m.empty());
+
+    gtl::parallel_flat_hash_map<uint64_t, uint64_t, gtl::Hash<uint64_t>, gtl::EqualTo<uint64_t>, Alloc> pm;
+    for (uint64_t i = 0; i < 100000; ++i)
+        pm[i] = i;
+    EXPECT_EQ(pm.size(), 100000u);
+}
+
+TEST(HugePageAllocatorTest, Vector)
+{
+    gtl::vector<uint32_t, gtl::huge_page_allocator<uint32_t, 1 << 16>> v;
+    for (uint32_t i = 0; i < 1000000; ++i)
+        v.push_back(i);
+    EXPECT_EQ(v.size(), 1000000u);
+    EXPECT_EQ(v[999999], 999999u);
+    v.clear();
+    v.shrink_to_fit();
+    EXPECT_TRUE(v.empty());
+}
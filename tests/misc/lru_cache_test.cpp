@@ -1,5 +1,20 @@
 #include "gtest/gtest.h"
 #include <gtl/lru_cache.hpp>
+#include <gtl/memoize.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "fake_clock.hpp"
 
 constexpr int CACHETEST1_NUM_OF_RECORDS = 100;
 constexpr int CACHETEST1_CACHE_CAPACITY = 50;
@@ -58,3 +73,853 @@ TEST(CacheTest1, mtKeepsAllValuesWithinCapacity)
         EXPECT_EQ(i, *cache.get(i));
     }
 }
+
+TEST(IntrusiveCacheTest, KeepsAllValuesWithinCapacity)
+{
+    gtl::intrusive_lru_cache<int, int> cache(CACHETEST1_CACHE_CAPACITY);
+
+    for (int i = 0; i < CACHETEST1_NUM_OF_RECORDS; ++i) {
+        cache.insert(i, i);
+    }
+
+    for (int i = 0; i < CACHETEST1_NUM_OF_RECORDS - CACHETEST1_CACHE_CAPACITY; ++i) {
+        EXPECT_FALSE(cache.exists(i));
+    }
+
+    for (int i = CACHETEST1_NUM_OF_RECORDS - CACHETEST1_CACHE_CAPACITY;
+         i < CACHETEST1_NUM_OF_RECORDS;
+         ++i) {
+        EXPECT_TRUE(cache.exists(i));
+        EXPECT_EQ(i, *cache.get(i));
+    }
+
+    size_t size = cache.size();
+    EXPECT_EQ(static_cast<size_t>(CACHETEST1_CACHE_CAPACITY), size);
+}
+
+TEST(IntrusiveCacheTest, RecencyResizeClear)
+{
+    gtl::intrusive_lru_cache<int, std::string> cache(10);
+    for (int i = 0; i < 10; ++i)
+        cache.insert(i, std::to_string(i));
+    EXPECT_EQ(*cache.get(0), "0"); // 0 becomes the most recently used
+    cache.insert(10, "10");        // evicts 1
+    EXPECT_TRUE(cache.exists(0));
+    EXPECT_FALSE(cache.exists(1));
+    cache.insert(2, "two"); // update, 2 becomes the most recently used
+    cache.insert(11, "11"); // evicts 3
+    EXPECT_FALSE(cache.exists(3));
+    EXPECT_EQ(*cache.get(2), "two");
+
+    // growing keeps the entries and their order
+    cache.set_cache_size(20);
+    for (int i = 12; i < 22; ++i)
+        cache.insert(i, std::to_string(i));
+    EXPECT_EQ(cache.size(), 20u);
+    EXPECT_EQ(*cache.get(4), "4");
+    cache.insert(22, "22"); // evicts 5
+    EXPECT_FALSE(cache.exists(5));
+    EXPECT_TRUE(cache.exists(4));
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_FALSE(cache.get(4));
+    for (int i = 0; i < 100; ++i)
+        cache.insert(i, std::to_string(i));
+    EXPECT_EQ(cache.size(), 20u);
+    EXPECT_EQ(*cache.get(99), "99");
+}
+
+TEST(IntrusiveCacheTest, mtKeepsAllValuesWithinCapacity)
+{
+    gtl::mt_intrusive_lru_cache<int, int> cache(5000); // an approximation
+
+    for (int i = 0; i < 10000; ++i) {
+        cache.insert(i, i);
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        EXPECT_FALSE(cache.exists(i));
+    }
+
+    for (int i = 8000; i < 10000; ++i) {
+        EXPECT_TRUE(cache.exists(i));
+        EXPECT_EQ(i, *cache.get(i));
+    }
+}
+
+TEST(SieveCacheTest, EvictsUnvisited)
+{
+    gtl::sieve_cache<int, int> cache(4);
+    for (int i = 0; i < 4; ++i)
+        cache.insert(i, i);
+    EXPECT_EQ(*cache.get(0), 0);
+    EXPECT_EQ(*cache.get(2), 2);
+
+    cache.insert(4, 4); // hand clears 0, evicts 1
+    EXPECT_FALSE(cache.exists(1));
+    cache.insert(5, 5); // hand clears 2, evicts 3
+    EXPECT_FALSE(cache.exists(3));
+    cache.insert(6, 6); // evicts 4
+    EXPECT_FALSE(cache.exists(4));
+    for (int i : { 0, 2, 5, 6 })
+        EXPECT_EQ(*cache.get(i), i);
+    EXPECT_EQ(cache.size(), 4u);
+
+    // visited bits and the hand survive growing the cache
+    cache.set_cache_size(8);
+    for (int i = 7; i < 11; ++i)
+        cache.insert(i, i);
+    cache.insert(11, 11); // all of 0, 2, 5, 6 were visited: evicts 7
+    EXPECT_FALSE(cache.exists(7));
+    EXPECT_EQ(cache.size(), 8u);
+
+    cache.clear();
+    EXPECT_FALSE(cache.get(0));
+    for (int i = 0; i < 100; ++i)
+        cache.insert(i, i);
+    EXPECT_EQ(cache.size(), 8u);
+    EXPECT_EQ(*cache.get(99), 99);
+}
+
+TEST(SieveCacheTest, mtConcurrentHits)
+{
+    gtl::mt_sieve_cache<int, int> cache(5000); // an approximation
+    for (int i = 0; i < 4000; ++i)
+        cache.insert(i, i);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                int k = (i * 7 + t) % 4000;
+                if (auto v = cache.get(k)) {
+                    EXPECT_EQ(*v, k);
+                }
+                if (i % 16 == 0)
+                    cache.insert(4000 + t * 20000 + i, i);
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    EXPECT_LE(cache.size(), 5000u);
+}
+
+TEST(TinyLfuCacheTest, ScanResistant)
+{
+    gtl::tinylfu_cache<int, int>        tinylfu(100);
+    gtl::intrusive_lru_cache<int, int> lru(100);
+
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            if (!tinylfu.get(i))
+                tinylfu.insert(i, i);
+            if (!lru.get(i))
+                lru.insert(i, i);
+        }
+    }
+    for (int i = 1000; i < 3000; ++i) { // one-off scan
+        tinylfu.insert(i, i);
+        lru.insert(i, i);
+    }
+
+    int tinylfu_hot = 0, lru_hot = 0;
+    for (int i = 0; i < 50; ++i) {
+        tinylfu_hot += tinylfu.exists(i);
+        lru_hot += lru.exists(i);
+    }
+    EXPECT_EQ(lru_hot, 0);
+    EXPECT_GE(tinylfu_hot, 45);
+    EXPECT_EQ(tinylfu.size(), 100u);
+}
+
+TEST(SlruCacheTest, ProtectsHitEntries)
+{
+    gtl::slru_cache<int, int>          slru(100);
+    gtl::intrusive_lru_cache<int, int> lru(100);
+
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            if (!slru.get(i))
+                slru.insert(i, i);
+            if (!lru.get(i))
+                lru.insert(i, i);
+        }
+    }
+    for (int i = 1000; i < 3000; ++i) { // new keys, inserted once
+        slru.insert(i, i);
+        lru.insert(i, i);
+    }
+
+    int slru_hot = 0, lru_hot = 0;
+    for (int i = 0; i < 50; ++i) {
+        slru_hot += slru.exists(i);
+        lru_hot += lru.exists(i);
+    }
+    EXPECT_EQ(lru_hot, 0);
+    EXPECT_EQ(slru_hot, 50);
+    EXPECT_EQ(slru.size(), 100u);
+}
+
+TEST(SlruCacheTest, DemotesProtectedOverflow)
+{
+    gtl::mt_slru_cache<int, std::string> cache(2000);
+    std::mt19937                         gen(5);
+    for (int i = 0; i < 100000; ++i) {
+        int k = (int)(gen() % 5000);
+        if (auto v = cache.get(k)) {
+            EXPECT_EQ(*v, std::to_string(k));
+        } else {
+            cache.insert(k, std::to_string(k));
+        }
+    }
+    EXPECT_LE(cache.size(), 2000u);
+    EXPECT_GT(cache.size(), 1500u);
+}
+
+TEST(GdsfCacheTest, KeepsExpensiveResults)
+{
+    // keys under 20 take 1ms to compute, the other ones almost nothing
+    int  calls = 0;
+    auto f     = [&](int k) {
+        ++calls;
+        if (k < 20)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return k;
+    };
+    gtl::memoize_lru<decltype(f), 0, gtl::gdsf_policy<>> gdsf(f, 100);
+    gtl::memoize_lru<decltype(f), 0, gtl::lru_policy>    lru(f, 100);
+
+    for (int k = 0; k < 20; ++k) {
+        EXPECT_EQ(gdsf(k), k);
+        EXPECT_EQ(lru(k), k);
+    }
+    for (int k = 1000; k < 3000; ++k) { // a stream of cheap calls
+        EXPECT_EQ(gdsf(k), k);
+        EXPECT_EQ(lru(k), k);
+    }
+
+    int gdsf_kept = 0, lru_kept = 0;
+    for (int k = 0; k < 20; ++k) {
+        gdsf_kept += gdsf.contains(k).has_value();
+        lru_kept += lru.contains(k).has_value();
+    }
+    EXPECT_EQ(lru_kept, 0);
+    EXPECT_EQ(gdsf_kept, 20);
+    EXPECT_EQ(gdsf.size(), 100u);
+}
+
+// the weight of a result is its size in units of `unit` bytes
+struct result_size_weigher
+{
+    explicit result_size_weigher(size_t u)
+        : unit(u)
+    {
+    }
+
+    size_t operator()(const std::tuple<int>&, const std::string& s) const { return s.size() / unit; }
+
+    size_t unit;
+};
+
+TEST(GdsfCacheTest, EvictsLargeResults)
+{
+    // all the calls take 1ms, keys 10 to 14 return much larger results
+    auto large = [](int k) { return k >= 10 && k < 15; };
+    auto f     = [&](int k) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return std::string(large(k) ? 100000 : 10, 'x');
+    };
+    gtl::memoize_lru<decltype(f), 0, gtl::gdsf_policy<result_size_weigher>> gdsf(f, 25, result_size_weigher(10));
+
+    for (int k = 0; k < 30; ++k) // 5 evictions: the large results, not the oldest ones
+        EXPECT_EQ(gdsf(k).size(), large(k) ? 100000u : 10u);
+    for (int k = 0; k < 30; ++k)
+        EXPECT_EQ(gdsf.contains(k).has_value(), !large(k));
+    EXPECT_EQ(gdsf.size(), 25u);
+}
+
+TEST(GdsfCacheTest, DumpLoadKeepsCosts)
+{
+    // keys under 10 take 1ms to compute, the other ones almost nothing
+    auto f = [](int k) {
+        if (k < 10)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return k;
+    };
+    const char* path = "gdsf_memoize_dump.bin";
+    {
+        gtl::memoize_lru<decltype(f), 0, gtl::gdsf_policy<>> memo(f, 50);
+        for (int k = 0; k < 10; ++k)
+            memo(k);
+        gtl::BinaryOutputArchive ar(path);
+        EXPECT_TRUE(memo.dump(ar));
+    }
+    gtl::memoize_lru<decltype(f), 0, gtl::gdsf_policy<>> memo(f, 50);
+    {
+        gtl::BinaryInputArchive ar(path);
+        EXPECT_TRUE(memo.load(ar));
+    }
+    for (int k = 1000; k < 2000; ++k) // a stream of cheap calls
+        EXPECT_EQ(memo(k), k);
+
+    // the loaded results are still the expensive ones
+    for (int k = 0; k < 10; ++k)
+        EXPECT_EQ(memo.contains(k), k);
+    EXPECT_EQ(memo.size(), 50u);
+    std::remove(path);
+}
+
+TEST(GdsfCacheTest, ValuesResize)
+{
+    gtl::mt_gdsf_cache<int, std::string> cache(2000);
+    std::mt19937                         gen(7);
+    for (int i = 0; i < 100000; ++i) {
+        int k = (int)(gen() % 5000);
+        if (i % 7 == 0) {
+            cache.insert(k, std::to_string(k));
+        } else if (auto v = cache.get(k)) {
+            EXPECT_EQ(*v, std::to_string(k));
+        } else {
+            EXPECT_EQ(cache.get_or_insert(k, [&]() { return std::to_string(k); }), std::to_string(k));
+        }
+        if (i == 50000)
+            cache.set_cache_size(4000);
+    }
+    EXPECT_LE(cache.size(), 4000u);
+    EXPECT_GT(cache.size(), 3000u);
+}
+
+TEST(TinyLfuCacheTest, ValuesResizeClear)
+{
+    gtl::mt_tinylfu_cache<int, std::string> cache(2000);
+    std::mt19937                             gen(3);
+    for (int i = 0; i < 100000; ++i) {
+        int k = (int)(gen() % 5000);
+        if (auto v = cache.get(k)) {
+            EXPECT_EQ(*v, std::to_string(k));
+        } else {
+            cache.insert(k, std::to_string(k));
+        }
+        if (i == 50000)
+            cache.set_cache_size(4000);
+    }
+    EXPECT_LE(cache.size(), 4000u);
+    EXPECT_GT(cache.size(), 3000u);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.get_or_insert(7, []() { return std::string("seven"); }), "seven");
+    EXPECT_EQ(cache.get_or_insert(7, []() { return std::string("other"); }), "seven");
+}
+
+template<class Policy>
+using fake_ttl_cache =
+    gtl::lru_cache_intrusive_impl<int, int, 0, gtl::Hash<int>, std::equal_to<int>, gtl::NullMutex, Policy>;
+
+TEST(TtlCacheTest, ExpiredAreMisses)
+{
+    using namespace std::chrono_literals;
+    fake_ttl_cache<gtl::ttl_policy<gtl::lru_policy, fake_clock>> cache(100);
+    cache.insert(1, 1, 10ms);
+    cache.insert(2, 2, 1s);
+    cache.insert(3, 3);
+    EXPECT_EQ(*cache.get(1), 1);
+
+    fake_clock::current += 20ms;
+    EXPECT_FALSE(cache.get(1));
+    EXPECT_FALSE(cache.exists(1));
+    EXPECT_EQ(*cache.get(2), 2);
+    EXPECT_EQ(*cache.get(3), 3);
+    EXPECT_EQ(cache.size(), 3u); // not evicted yet
+
+    cache.insert(4, 4); // evicts 1
+    EXPECT_EQ(cache.size(), 3u);
+
+    cache.insert(2, 20, 10ms); // updating sets the new expiry
+    fake_clock::current += 500ms;
+    EXPECT_FALSE(cache.get(2));
+    cache.insert(1, 10, 1h);
+    EXPECT_EQ(*cache.get(1), 10);
+    EXPECT_EQ(cache.size(), 3u);
+
+    fake_clock::current += 2h;
+    cache.remove_expired();
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(*cache.get(3), 3);
+    EXPECT_EQ(cache.get_or_insert(5, []() { return 5; }), 5);
+}
+
+TEST(TtlCacheTest, GetOrInsertWithTtl)
+{
+    using namespace std::chrono_literals;
+    fake_ttl_cache<gtl::ttl_policy<gtl::lru_policy, fake_clock>> cache(100);
+    int                                                          calls = 0;
+    auto                                                         f     = [&]() { return ++calls; };
+
+    cache.insert(1, 0, 1s);
+    fake_clock::current += 2s;
+    EXPECT_EQ(cache.get_or_insert(1, f, 10ms), 1); // expired: recomputed
+    EXPECT_EQ(cache.get_or_insert(1, f, 10ms), 1);
+    EXPECT_EQ(cache.get_or_insert(2, f, 10ms), 2);
+    fake_clock::current += 20ms;
+    EXPECT_FALSE(cache.get(1));
+    EXPECT_FALSE(cache.get(2));
+    EXPECT_EQ(cache.get_or_insert(2, f, 1h), 3);
+
+    // without a ttl, the computed values don't expire
+    EXPECT_EQ(cache.get_or_insert(1, f), 4);
+    fake_clock::current += 24h * 365;
+    EXPECT_EQ(*cache.get(1), 4);
+    EXPECT_FALSE(cache.get(2));
+}
+
+TEST(TtlCacheTest, ThrowingGetOrInsert)
+{
+    using namespace std::chrono_literals;
+    fake_ttl_cache<gtl::ttl_policy<gtl::lru_policy, fake_clock>> cache(100);
+    for (int k = 0; k < 100; ++k)
+        cache.insert(k, k, k < 50 ? 1s : 1h);
+    fake_clock::current += 2s;
+
+    auto fail = []() -> int { throw std::runtime_error("fail"); };
+    EXPECT_THROW(cache.get_or_insert(1000, fail), std::runtime_error);
+    EXPECT_THROW(cache.get_or_insert(10, fail), std::runtime_error); // expired
+    EXPECT_EQ(cache.size(), 100u);
+    EXPECT_FALSE(cache.exists(1000));
+
+    // the expired entries are still evicted by the following inserts
+    for (int k = 1000; k < 1200; ++k)
+        EXPECT_EQ(cache.get_or_insert(k, [&]() { return k; }, 1h), k);
+    EXPECT_LE(cache.size(), 101u);
+    for (int k = 1100; k < 1200; ++k)
+        EXPECT_EQ(*cache.get(k), k);
+    cache.remove_expired();
+    for (int k = 0; k < 50; ++k)
+        EXPECT_FALSE(cache.exists(k));
+}
+
+template<class Policy>
+void check_ttl_against_reference()
+{
+    using namespace std::chrono_literals;
+    fake_ttl_cache<gtl::ttl_policy<Policy, fake_clock>> cache(20000);
+    std::map<int, fake_clock::time_point>               expiry;
+    std::mt19937                                        gen(5);
+
+    for (int step = 0; step < 400; ++step) {
+        for (int i = 0; i < 50; ++i) {
+            int  k   = (int)(gen() % 10000);
+            auto ttl = std::chrono::milliseconds(gen() % 4000000); // up to ~1h
+            cache.insert(k, k, ttl);
+            expiry[k] = fake_clock::now() + ttl;
+        }
+        if (step == 200)
+            cache.set_cache_size(40000);
+        fake_clock::current += std::chrono::milliseconds(gen() % 30000);
+        if (step % 10 == 0)
+            cache.remove_expired();
+
+        for (int k = 0; k < 10000; k += 97) {
+            auto it    = expiry.find(k);
+            bool alive = it != expiry.end() && it->second > fake_clock::now();
+            EXPECT_EQ(cache.get(k).has_value(), alive);
+        }
+    }
+
+    cache.remove_expired();
+    size_t alive = 0;
+    for (auto& [k, e] : expiry)
+        alive += e > fake_clock::now();
+    EXPECT_EQ(cache.size(), alive);
+}
+
+TEST(TtlCacheTest, TimerWheelMatchesReference)
+{
+    check_ttl_against_reference<gtl::lru_policy>();
+    check_ttl_against_reference<gtl::sieve_policy>();
+    check_ttl_against_reference<gtl::tinylfu_policy>();
+    check_ttl_against_reference<gtl::slru_policy>();
+    check_ttl_against_reference<gtl::gdsf_policy<>>();
+}
+
+struct string_weigher
+{
+    size_t operator()(int, const std::string& s) const { return s.size(); }
+};
+
+TEST(WeightedCacheTest, EvictsToStayWithinBudget)
+{
+    gtl::weighted_lru_cache<int, std::string, string_weigher> cache(1000);
+    for (int i = 0; i < 20; ++i)
+        cache.insert(i, std::string(100, 'x'));
+    EXPECT_EQ(cache.size(), 10u);
+    EXPECT_EQ(cache.weight(), 1000u);
+    EXPECT_FALSE(cache.exists(9));
+    EXPECT_TRUE(cache.exists(10));
+
+    cache.insert(100, std::string(450, 'y')); // evicts 10 to 14
+    EXPECT_EQ(cache.size(), 6u);
+    EXPECT_EQ(cache.weight(), 950u);
+    EXPECT_FALSE(cache.exists(14));
+    EXPECT_TRUE(cache.exists(15));
+
+    cache.insert(15, std::string(200, 'z')); // heavier update, evicts 16
+    EXPECT_EQ(cache.weight(), 950u);
+    EXPECT_FALSE(cache.exists(16));
+    EXPECT_TRUE(cache.exists(17));
+    cache.insert(101, std::string(10, 'w'));
+    EXPECT_EQ(cache.weight(), 960u);
+
+    cache.insert(102, std::string(2000, 'v')); // heavier than the whole budget
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.weight(), 0u);
+
+    cache.insert(1, "one");
+    cache.clear();
+    EXPECT_EQ(cache.weight(), 0u);
+}
+
+TEST(WeightedCacheTest, HeavierOverwrites)
+{
+    gtl::weighted_lru_cache<int, std::string, string_weigher> cache(1000);
+    for (int i = 0; i < 10; ++i)
+        cache.insert(i, std::string(100, 'x'));
+
+    // overwriting a hot key with growing values evicts the least recently used entries
+    for (size_t len = 100; len <= 1000; len += 50) {
+        cache.insert(9, std::string(len, 'y'));
+        EXPECT_LE(cache.weight(), 1000u);
+        EXPECT_EQ(cache.get(9)->size(), len);
+    }
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.weight(), 1000u);
+
+    cache.insert(9, std::string(1001, 'z')); // heavier than the whole budget
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.weight(), 0u);
+
+    gtl::mt_weighted_lru_cache<int, std::string, string_weigher> mt_cache(64 * 1000);
+    for (int i = 0; i < 10000; ++i)
+        mt_cache.insert(i, std::string(10, 'x'));
+    for (int j = 1; j <= 100; ++j)
+        for (int i = 0; i < 64; ++i)
+            mt_cache.insert(i, std::string(10 * j, 'y'));
+    EXPECT_LE(mt_cache.weight(), 64u * 1000);
+}
+
+// a key whose copy constructor throws once `copies_left` copies have been made
+struct throwing_key
+{
+    static inline int copies_left = -1;
+
+    int v;
+
+    throwing_key(int i)
+        : v(i)
+    {
+    }
+    throwing_key(const throwing_key& o)
+        : v(o.v)
+    {
+        if (copies_left == 0)
+            throw std::runtime_error("copy");
+        if (copies_left > 0)
+            --copies_left;
+    }
+    throwing_key(throwing_key&& o) noexcept = default;
+    throwing_key& operator=(const throwing_key&) = default;
+
+    friend bool operator==(const throwing_key& a, const throwing_key& b) { return a.v == b.v; }
+};
+
+struct throwing_key_hash
+{
+    size_t operator()(const throwing_key& k) const { return std::hash<int>()(k.v); }
+};
+
+struct one_weigher
+{
+    size_t operator()(const throwing_key&, int) const { return 1; }
+};
+
+TEST(WeightedCacheTest, ThrowingKeyCopyOnEviction)
+{
+    gtl::weighted_lru_cache<throwing_key, int, one_weigher, throwing_key_hash> cache(4);
+    for (int i = 0; i < 4; ++i)
+        cache.insert(i, i);
+
+    // the list entry and the hash map slot are created, then copying the key
+    // of the evicted entry throws: the new entry is kept, and nothing is evicted
+    throwing_key::copies_left = 2;
+    EXPECT_THROW(cache.insert(4, 4), std::runtime_error);
+    throwing_key::copies_left = -1;
+    EXPECT_EQ(cache.size(), 5u);
+    EXPECT_EQ(cache.weight(), 5u);
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(*cache.get(i), i);
+
+    cache.insert(5, 5); // evicts the two least recently used entries
+    EXPECT_EQ(cache.size(), 4u);
+    EXPECT_EQ(cache.weight(), 4u);
+    EXPECT_FALSE(cache.exists(0));
+    EXPECT_FALSE(cache.exists(1));
+    for (int i = 2; i < 6; ++i)
+        EXPECT_EQ(*cache.get(i), i);
+}
+
+TEST(WeightedCacheTest, mtWeight)
+{
+    gtl::mt_weighted_lru_cache<int, std::string, string_weigher> cache(64 * 1000);
+    for (int i = 0; i < 10000; ++i)
+        cache.insert(i, std::string(1 + i % 100, 'x'));
+    EXPECT_LE(cache.weight(), 64u * 1000);
+    EXPECT_GT(cache.weight(), 60u * 1000);
+
+    size_t total = 0;
+    for (int i = 0; i < 10000; ++i)
+        if (auto v = cache.get(i))
+            total += v->size();
+    EXPECT_EQ(total, cache.weight());
+
+    gtl::mt_lru_cache<int, int> counted(6400);
+    for (int i = 0; i < 10000; ++i)
+        counted.insert(i, i);
+    EXPECT_EQ(counted.weight(), counted.size());
+}
+
+TEST(GlobalCacheTest, ExactCapacity)
+{
+    gtl::mt_global_lru_cache<int, int> cache(1000);
+    for (int i = 0; i < 10000; ++i)
+        cache.insert(i, i);
+    EXPECT_EQ(cache.size(), 1000u);
+    EXPECT_EQ(cache.weight(), 1000u);
+
+    cache.clear();
+    for (int i = 0; i < 1000; ++i)
+        cache.insert(i, i);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(cache.get(i));
+    for (int i = 1000; i < 1100; ++i)
+        cache.insert(i, i);
+    EXPECT_EQ(cache.size(), 1000u);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(cache.exists(i)); // hits are more recent than the evicted entries
+    for (int i = 1000; i < 1100; ++i)
+        EXPECT_TRUE(cache.exists(i));
+
+    cache.set_cache_size(500);
+    cache.insert(-1, -1);
+    EXPECT_EQ(cache.size(), 500u);
+    EXPECT_TRUE(cache.exists(-1));
+}
+
+TEST(GlobalCacheTest, mtInsert)
+{
+    gtl::mt_global_lru_cache<int, int> cache(5000);
+    std::vector<std::thread>           threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            for (int i = 0; i < 50000; ++i) {
+                int k = (int)(gen() % 20000);
+                if (!cache.get(k))
+                    cache.insert(k, k);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    EXPECT_LE(cache.size(), 5000u);
+    EXPECT_GT(cache.size(), 4900u);
+    EXPECT_EQ(cache.size(), cache.weight());
+}
+
+TEST(DelayQueueCacheTest, RecyclesOverwrittenAndEvictedValues)
+{
+    using cache_type = gtl::lru_cache_with_q_impl<int,
+                                                  std::string,
+                                                  16,
+                                                  0,
+                                                  gtl::Hash<int>,
+                                                  std::equal_to<int>,
+                                                  gtl::NullMutex>;
+    auto       dq    = std::make_shared<cache_type::DelayQueue>();
+    cache_type cache(3, &dq);
+
+    cache.insert(1, std::string("a"), 10);
+    cache.insert(2, std::string("b"), 10);
+    cache.insert(1, std::string("c"), 10); // "a" is recycled
+    cache.insert(3, std::string("d"), 20);
+    cache.insert(4, std::string("e"), 20); // evicts 2, "b" is recycled until 20
+    EXPECT_FALSE(cache.exists(2));
+    EXPECT_EQ(dq->size(), 2u);
+
+    std::string res;
+    EXPECT_TRUE(cache.get(1, res));
+    EXPECT_EQ(res, "c");
+
+    std::vector<std::string> released;
+    auto                     f = [&](std::string&& v) { released.push_back(std::move(v)); };
+    dq->drain(15, f);
+    EXPECT_EQ(released, (std::vector<std::string>{ "a" }));
+    dq->drain(20, f);
+    EXPECT_EQ(released, (std::vector<std::string>{ "a", "b" }));
+}
+
+TEST(EpochCacheTest, PinnedValuesOutliveOverwriteAndEviction)
+{
+    using cache_type = gtl::lru_cache_epoch_impl<int,
+                                                 std::shared_ptr<int>,
+                                                 0,
+                                                 gtl::Hash<int>,
+                                                 std::equal_to<int>,
+                                                 gtl::NullMutex>;
+    cache_type cache(100);
+
+    auto first = std::make_shared<int>(1);
+    cache.insert(1, first);
+    {
+        auto                        guard = cache.pin();
+        const std::shared_ptr<int>* v     = cache.get(1, guard);
+        ASSERT_TRUE(v);
+        EXPECT_EQ(**v, 1);
+
+        cache.insert(1, std::make_shared<int>(2)); // overwrite
+        for (int i = 2; i < 1000; ++i)             // evicts and retires many entries
+            cache.insert(i, std::make_shared<int>(i));
+        EXPECT_FALSE(cache.exists(1));
+        EXPECT_EQ(**v, 1); // still alive, as the reader is pinned
+        EXPECT_GT(first.use_count(), 1);
+    }
+    for (int i = 1000; i < 1000 + 4 * (int)cache_type::retire_batch; ++i)
+        cache.insert(i, std::make_shared<int>(i));
+    EXPECT_EQ(first.use_count(), 1); // released once unpinned
+    EXPECT_EQ(cache.size(), 100u);
+
+    auto v = cache.get(1200);
+    ASSERT_TRUE(v);
+    EXPECT_EQ(**v, 1200);
+}
+
+TEST(EpochCacheTest, HitsProtectFromEviction)
+{
+    gtl::lru_cache_epoch_impl<int, int, 0, gtl::Hash<int>, std::equal_to<int>, gtl::NullMutex> cache(10);
+    for (int i = 0; i < 10; ++i)
+        cache.insert(i, i);
+    EXPECT_TRUE(cache.get(0)); // the oldest, but visited
+    EXPECT_TRUE(cache.get(1));
+    cache.insert(10, 10);
+    EXPECT_TRUE(cache.exists(0));
+    EXPECT_TRUE(cache.exists(1));
+    EXPECT_FALSE(cache.exists(2));
+    cache.insert(11, 11);
+    EXPECT_FALSE(cache.exists(3));
+    EXPECT_EQ(cache.size(), 10u);
+}
+
+TEST(EpochCacheTest, mtReadersAndWriters)
+{
+    gtl::epoch_shard_lru_cache<int, std::string> cache(4096);
+    std::atomic<bool>                           stop{ false };
+    std::atomic<size_t>                         errors{ 0 };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t)
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            for (int i = 0; i < 200000; ++i) {
+                int k = (int)(gen() % 10000);
+                cache.insert(k, std::string(32 + k % 64, char('a' + k % 26)));
+            }
+        });
+    for (int t = 0; t < 2; ++t)
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(100 + t);
+            while (!stop) {
+                auto guard = cache.pin();
+                int  k     = (int)(gen() % 10000);
+                if (const std::string* v = cache.get(k, guard)) {
+                    if (v->size() != size_t(32 + k % 64) || (*v)[v->size() - 1] != char('a' + k % 26))
+                        ++errors;
+                }
+            }
+        });
+    threads[0].join();
+    threads[1].join();
+    stop = true;
+    threads[2].join();
+    threads[3].join();
+    EXPECT_EQ(errors, 0u);
+    EXPECT_LE(cache.size(), 4096u);
+}
+
+TEST(CacheStatsTest, LruCache)
+{
+    using cache_type = gtl::lru_cache_impl<int,
+                                           int,
+                                           0,
+                                           gtl::Hash<int>,
+                                           std::equal_to<int>,
+                                           gtl::NullMutex,
+                                           gtl::unit_weigher,
+                                           false,
+                                           gtl::cache_counters>;
+    cache_type cache(10);
+    for (int i = 0; i < 15; ++i)
+        cache.insert(i, i);
+    for (int i = 0; i < 15; ++i)
+        (void)cache.get(i);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 10u);
+    EXPECT_EQ(stats.misses, 5u);
+    EXPECT_EQ(stats.insertions, 15u);
+    EXPECT_EQ(stats.evictions, 5u);
+    EXPECT_EQ(stats.eviction_age.count(), 5u);
+    EXPECT_DOUBLE_EQ(stats.hit_ratio(), 10.0 / 15);
+
+    cache.clear(); // keeps the counters
+    EXPECT_EQ(cache.stats().insertions, 15u);
+    cache.reset_stats();
+    EXPECT_EQ(cache.stats().requests(), 0u);
+
+    // disabled by default
+    gtl::lru_cache<int, int> plain(10);
+    plain.insert(1, 1);
+    EXPECT_EQ(plain.stats().insertions, 0u);
+}
+
+TEST(CacheStatsTest, mtIntrusiveCache)
+{
+    using cache_type = gtl::lru_cache_intrusive_impl<int,
+                                                     int,
+                                                     4,
+                                                     gtl::Hash<int>,
+                                                     std::equal_to<int>,
+                                                     std::mutex,
+                                                     gtl::lru_policy,
+                                                     gtl::cache_counters>;
+    cache_type cache(1600);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            for (int i = 0; i < 20000; ++i) {
+                int k = (int)(gen() % 4000);
+                EXPECT_EQ(cache.get_or_insert(k, [&] { return k; }), k);
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.requests(), 80000u);
+    EXPECT_EQ(stats.misses, stats.insertions);
+    EXPECT_EQ(stats.miss_latency.count(), stats.misses);
+    EXPECT_EQ(stats.insertions - stats.evictions, cache.size());
+    EXPECT_GT(stats.hit_ratio(), 0.3);
+    EXPECT_LT(stats.hit_ratio(), 0.5);
+}
@@ -0,0 +1,513 @@
+#include "gtest/gtest.h"
+#include <gtl/memoize.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "fake_clock.hpp"
+
+TEST(CacheStatsTest, Memoize)
+{
+    auto slow = [](int x) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        return x * x;
+    };
+    gtl::mt_memoize<decltype(slow), false, 4, std::mutex, false, gtl::cache_counters> memo(slow);
+    for (int round = 0; round < 4; ++round)
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(memo(i), i * i);
+
+    auto stats = memo.stats();
+    EXPECT_EQ(stats.hits, 30u);
+    EXPECT_EQ(stats.misses, 10u);
+    EXPECT_EQ(stats.miss_latency.count(), 10u);
+    EXPECT_GE(stats.miss_latency.mean(), std::chrono::microseconds(200));
+    EXPECT_GE(stats.miss_latency.quantile(0.5), std::chrono::microseconds(200));
+
+    gtl::memoize_lru<decltype(slow), 0, gtl::lru_policy, gtl::cache_counters> memo_lru(slow, 5);
+    for (int i = 0; i < 10; ++i)
+        memo_lru(i % 7);
+    EXPECT_EQ(memo_lru.stats().misses, 10u); // 0, 1 and 2 were evicted before they were called again
+    EXPECT_EQ(memo_lru.stats().evictions, 5u);
+}
+
+TEST(MemoizeTest, SingleFlight)
+{
+    std::atomic<int>  calls{ 0 };
+    std::atomic<bool> release{ false };
+    auto              slow = [&](int x) {
+        ++calls;
+        if (x == 0) {
+            while (!release)
+                std::this_thread::yield();
+        }
+        if (x < 0)
+            throw std::invalid_argument("negative");
+        return x * 2;
+    };
+    gtl::mt_memoize<decltype(slow), true, 0, std::mutex, true> memo(slow); // a single submap
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&]() { EXPECT_EQ(memo(0), 0); });
+
+    // while key 0 is computed, the other keys of its submap are not blocked
+    while (calls == 0)
+        std::this_thread::yield();
+    EXPECT_EQ(memo(1), 2);
+    EXPECT_EQ(calls, 2);
+
+    release = true;
+    for (auto& th : threads)
+        th.join();
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(memo.size(), 2u);
+
+    // exceptions are propagated, and not cached
+    EXPECT_THROW(memo(-1), std::invalid_argument);
+    EXPECT_THROW(memo(-1), std::invalid_argument);
+    EXPECT_EQ(calls, 4);
+}
+
+TEST(MemoizeTest, Async)
+{
+    std::atomic<int>  calls{ 0 };
+    std::atomic<bool> release{ false };
+    auto              slow = [&](int x) {
+        ++calls;
+        while (!release)
+            std::this_thread::yield();
+        if (x < 0)
+            throw std::invalid_argument("negative");
+        return x * 2;
+    };
+
+    std::vector<std::thread> workers;
+    auto executor = [&](std::function<void()> task) { workers.emplace_back(std::move(task)); };
+    gtl::async_memoize<decltype(slow), 4, std::mutex, decltype(executor)> memo(slow, executor);
+
+    auto f1 = memo(21);
+    auto f2 = memo(21); // same computation
+    auto f3 = memo(-1);
+    EXPECT_EQ(workers.size(), 2u);
+    EXPECT_EQ(f1.wait_for(std::chrono::milliseconds(1)), std::future_status::timeout);
+
+    release = true;
+    EXPECT_EQ(f1.get(), 42);
+    EXPECT_EQ(f2.get(), 42);
+    EXPECT_THROW(f3.get(), std::invalid_argument);
+    for (auto& th : workers)
+        th.join();
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(memo.size(), 1u); // the exception is not cached
+    EXPECT_EQ(memo(21).get(), 42);
+    EXPECT_FALSE(memo.contains(-1));
+
+    gtl::async_memoize<decltype(slow)> inline_memo(slow); // runs in the calling thread
+    EXPECT_EQ(inline_memo(5).get(), 10);
+    EXPECT_EQ(calls, 3);
+}
+
+TEST(MemoizeTest, AsyncStaleFailureKeepsNewEntry)
+{
+    // the first call fails, after `clear()` started a new computation
+    int  calls = 0;
+    auto f     = [&](int x) {
+        if (++calls == 1)
+            throw std::runtime_error("first call");
+        return x * 2;
+    };
+
+    std::vector<std::function<void()>> tasks;
+    auto executor = [&](std::function<void()> task) { tasks.push_back(std::move(task)); };
+    gtl::async_memoize<decltype(f), 4, std::mutex, decltype(executor)> memo(f, executor);
+
+    auto stale = memo(21);
+    memo.clear();
+    auto fresh = memo(21);
+    EXPECT_EQ(tasks.size(), 2u);
+
+    tasks[0](); // fails, but must not erase the entry of `fresh`
+    EXPECT_THROW(stale.get(), std::runtime_error);
+    EXPECT_EQ(memo.size(), 1u);
+    memo(21); // shares `fresh`, no new task
+    ASSERT_EQ(tasks.size(), 2u);
+
+    tasks[1]();
+    EXPECT_EQ(fresh.get(), 42);
+    EXPECT_EQ(memo.contains(21)->get(), 42);
+    EXPECT_EQ(calls, 2);
+}
+
+namespace {
+struct counted_arg
+{
+    static inline int copies = 0;
+
+    explicit counted_arg(int val)
+        : v(val)
+    {
+    }
+    counted_arg(const counted_arg& o)
+        : v(o.v)
+    {
+        ++copies;
+    }
+    counted_arg(counted_arg&&) noexcept = default;
+
+    bool operator==(const counted_arg& o) const { return v == o.v; }
+
+    friend size_t hash_value(const counted_arg& a) { return gtl::Hash<int>()(a.v); }
+
+    int v;
+};
+} // namespace
+
+TEST(MemoizeTest, LookupsDontCopyArguments)
+{
+    auto twice = [](const counted_arg& a, const std::string& s) { return std::to_string(a.v * 2) + s; };
+    gtl::mt_memoize<decltype(twice), false, 2> memo(twice);
+    static_assert(std::is_same_v<decltype(memo)::key_type, std::tuple<counted_arg, std::string>>);
+
+    counted_arg a(21);
+    EXPECT_EQ(memo(a, "!"), "42!");
+    EXPECT_EQ(counted_arg::copies, 1); // stored in the new key
+    EXPECT_EQ(memo(a, "!"), "42!");
+    EXPECT_TRUE(memo.contains(a, "!"));
+    EXPECT_FALSE(memo.contains(a, "?"));
+    EXPECT_EQ(counted_arg::copies, 1);
+
+    gtl::mt_memoize<decltype(twice), true, 2, std::mutex, true> sf_memo(twice);
+    EXPECT_EQ(sf_memo(a, "!"), "42!");
+    EXPECT_EQ(sf_memo(a, "!"), "42!");
+    EXPECT_EQ(counted_arg::copies, 3); // the in-flight key and the stored key
+
+    // the failures are also looked up without copying the arguments
+    auto fail = [](const counted_arg& x) -> int { throw std::invalid_argument(std::to_string(x.v)); };
+    gtl::mt_memoize<decltype(fail), false, 2, std::mutex, false, gtl::no_cache_stats, true> f_memo(fail);
+    counted_arg::copies = 0;
+    EXPECT_THROW(f_memo(a), std::invalid_argument);
+    EXPECT_EQ(counted_arg::copies, 2); // the failure's key, copied into the cache
+    for (int i = 0; i < 3; ++i)
+        EXPECT_THROW(f_memo(a), std::invalid_argument);
+    EXPECT_FALSE(f_memo.contains(a));
+    EXPECT_FALSE(f_memo.contains(counted_arg(5)));
+    EXPECT_EQ(counted_arg::copies, 2);
+}
+
+TEST(MemoizeTest, DumpLoad)
+{
+    int  calls = 0;
+    auto split = [&](const std::string& s, int n) {
+        ++calls;
+        return std::vector<std::string>(n, s);
+    };
+    const char* path = "memoize_dump.bin";
+    {
+        gtl::mt_memoize<decltype(split), false, 2> memo(split);
+        for (int i = 0; i < 100; ++i)
+            memo(std::to_string(i), i % 5);
+        gtl::BinaryOutputArchive ar(path);
+        EXPECT_TRUE(memo.dump(ar));
+    }
+    gtl::mt_memoize<decltype(split), false, 2> memo(split);
+    {
+        gtl::BinaryInputArchive ar(path);
+        EXPECT_TRUE(memo.load(ar));
+    }
+    EXPECT_EQ(memo.size(), 100u);
+    calls = 0;
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(memo(std::to_string(i), i % 5), std::vector<std::string>(i % 5, std::to_string(i)));
+    EXPECT_EQ(calls, 0);
+    std::remove(path);
+}
+
+TEST(MemoizeTest, LoadCorruptedLength)
+{
+    auto length = [](const std::string& s) { return s.size(); };
+    const char* path = "memoize_corrupted_dump.bin";
+    {
+        // one entry, whose string argument claims to be 2^60 bytes long
+        gtl::BinaryOutputArchive ar(path);
+        uint8_t                  more = 1;
+        size_t                   n    = size_t(1) << 60;
+        EXPECT_TRUE(ar.saveBinary(&more, 1));
+        EXPECT_TRUE(ar.saveBinary(&n, sizeof(n)));
+        EXPECT_TRUE(ar.saveBinary("abc", 3));
+    }
+    gtl::mt_memoize<decltype(length), false, 2> memo(length);
+    {
+        gtl::BinaryInputArchive ar(path);
+        EXPECT_FALSE(memo.load(ar));
+    }
+    EXPECT_EQ(memo.size(), 0u);
+    std::remove(path);
+}
+
+TEST(MemoizeTest, DumpLoadKeepsLruOrder)
+{
+    auto square = [](int x) { return x * x; };
+    const char* path = "memoize_lru_dump.bin";
+    {
+        gtl::memoize_lru<decltype(square), 0> memo(square, 10);
+        for (int i = 0; i < 10; ++i)
+            memo(i);
+        memo(0); // 1 is now the least recently used
+        gtl::BinaryOutputArchive ar(path);
+        EXPECT_TRUE(memo.dump(ar));
+    }
+    gtl::memoize_lru<decltype(square), 0> memo(square, 10);
+    {
+        gtl::BinaryInputArchive ar(path);
+        EXPECT_TRUE(memo.load(ar));
+    }
+    EXPECT_EQ(memo.size(), 10u);
+    memo(10); // evicts 1
+    EXPECT_FALSE(memo.contains(1));
+    EXPECT_EQ(memo.contains(0), 0);
+    EXPECT_EQ(memo.contains(2), 4);
+    std::remove(path);
+}
+
+TEST(MemoizeTest, LruContainsDoesntPromote)
+{
+    auto square = [](int x) { return x * x; };
+    gtl::memoize_lru<decltype(square), 0, gtl::lru_policy, gtl::cache_counters> memo(square, 3);
+    for (int i = 0; i < 3; ++i)
+        memo(i);
+    EXPECT_EQ(memo.contains(0), 0); // 0 stays the least recently used
+    memo(3);                        // evicts 0
+    EXPECT_FALSE(memo.contains(0));
+    EXPECT_EQ(memo.contains(1), 1);
+    EXPECT_EQ(memo.stats().hits, 0u);
+}
+
+namespace {
+struct point
+{
+    point() = default;
+    point(double px, double py)
+        : x(px)
+        , y(py)
+    {
+    }
+    virtual ~point() = default; // not trivially copyable
+
+    double x = 0, y = 0;
+};
+
+struct point_serializer : gtl::binary_serializer
+{
+    using gtl::binary_serializer::load;
+    using gtl::binary_serializer::save;
+
+    template<class OutputArchive>
+    bool save(OutputArchive& ar, const point& p) const
+    {
+        return save(ar, p.x) && save(ar, p.y);
+    }
+
+    template<class InputArchive>
+    bool load(InputArchive& ar, point& p) const
+    {
+        return load(ar, p.x) && load(ar, p.y);
+    }
+};
+} // namespace
+
+TEST(MemoizeTest, DumpLoadCustomSerializer)
+{
+    auto scale = [](int k) { return point(k, 2.0 * k); };
+    const char* path = "memoize_custom_dump.bin";
+    {
+        gtl::mt_memoize<decltype(scale), false, 2> memo(scale);
+        for (int i = 0; i < 10; ++i)
+            memo(i);
+        gtl::BinaryOutputArchive ar(path);
+        EXPECT_TRUE(memo.dump(ar, point_serializer()));
+    }
+    gtl::mt_memoize<decltype(scale), false, 2> memo(scale);
+    {
+        gtl::BinaryInputArchive ar(path);
+        EXPECT_TRUE(memo.load(ar, point_serializer()));
+    }
+    ASSERT_TRUE(memo.contains(7));
+    EXPECT_EQ(memo.contains(7)->y, 14.0);
+    std::remove(path);
+}
+
+TEST(LazyListTest, ComputesEachElementOnce)
+{
+    std::atomic<size_t> calls{ 0 };
+    auto fibs = gtl::lazy_list(uint64_t(0), [&](auto p, size_t n) -> uint64_t {
+        ++calls;
+        return n == 1 ? 1 : (*p)[n - 1] + (*p)[n - 2];
+    });
+
+    EXPECT_FALSE(fibs.contains(10));
+    EXPECT_EQ(fibs[10], 55u);
+    EXPECT_EQ(calls, 10u);
+    EXPECT_TRUE(fibs.contains(10));
+    EXPECT_FALSE(fibs.contains(11));
+
+    const uint64_t& f50 = fibs[50];
+    EXPECT_EQ(f50, 12586269025u);
+    EXPECT_EQ(calls, 50u);
+
+    // deep enough to overflow the stack without the warm-up
+    (void)fibs[2000000];
+    EXPECT_EQ(calls, 2000000u);
+    EXPECT_EQ(&fibs[50], &f50); // the elements never move
+}
+
+TEST(LazyListTest, ConcurrentReads)
+{
+    std::atomic<size_t> calls{ 0 };
+    auto squares = gtl::lazy_list(size_t(0), [&](auto p, size_t n) -> size_t {
+        ++calls;
+        return (*p)[n - 1] + 2 * n - 1;
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen((unsigned)t);
+            for (int i = 0; i < 20000; ++i) {
+                size_t n = gen() % 100000;
+                EXPECT_EQ(squares[n], n * n);
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+    EXPECT_LE(calls, 99999u);
+}
+
+TEST(MemoizeTest, CachesFailures)
+{
+    std::atomic<int> calls{ 0 };
+    auto             f = [&](int x) -> int {
+        ++calls;
+        if (x == 13)
+            throw std::runtime_error("unlucky");
+        return 2 * x;
+    };
+    gtl::mt_memoize<decltype(f), false, 2, std::mutex, false, gtl::no_cache_stats, true, fake_clock> memo(
+        f, 100, std::chrono::milliseconds(50));
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_THROW((void)memo(13), std::runtime_error);
+        EXPECT_EQ(memo(7), 14);
+    }
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(memo.size(), 1u);
+    EXPECT_EQ(memo.failures_size(), 1u);
+    EXPECT_FALSE(memo.contains(13));
+
+    fake_clock::current += std::chrono::milliseconds(40);
+    EXPECT_THROW((void)memo(13), std::runtime_error);
+    EXPECT_EQ(calls, 2);
+
+    fake_clock::current += std::chrono::milliseconds(20); // the failure expires, not the result
+    EXPECT_THROW((void)memo(13), std::runtime_error);
+    EXPECT_EQ(memo(7), 14);
+    EXPECT_EQ(calls, 3);
+
+    memo.clear();
+    EXPECT_EQ(memo.failures_size(), 0u);
+
+    // fewer failures than 3 per submap (64 submaps by default)
+    gtl::mt_memoize<decltype(f), false, 6, std::mutex, false, gtl::no_cache_stats, true> small(f, 10);
+    EXPECT_THROW((void)small(13), std::runtime_error);
+    EXPECT_THROW((void)small(13), std::runtime_error);
+    EXPECT_EQ(calls, 4);
+}
+
+TEST(MemoizeTest, CachesEmptyResults)
+{
+    int  calls = 0;
+    auto half  = [&](int x) -> std::optional<int> {
+        ++calls;
+        if (x % 2)
+            return std::nullopt;
+        return x / 2;
+    };
+    gtl::mt_memoize<decltype(half), true, 2, gtl::NullMutex, false, gtl::no_cache_stats, true> memo(
+        half, 100, std::chrono::hours(1));
+
+    for (int i = 0; i < 3; ++i) {
+        for (int x = 0; x < 10; ++x)
+            EXPECT_EQ(memo(x), x % 2 ? std::nullopt : std::optional<int>(x / 2));
+    }
+    EXPECT_EQ(calls, 10);
+    EXPECT_EQ(memo.size(), 5u);
+    EXPECT_EQ(memo.failures_size(), 5u);
+    ASSERT_TRUE(memo.contains(3));
+    EXPECT_FALSE(memo.contains(3)->has_value());
+    EXPECT_FALSE(memo.contains(11));
+
+    // a full failure cache evicts the failures, not the results
+    for (int x = 11; x < 1000; x += 2)
+        EXPECT_FALSE(memo(x).has_value());
+    EXPECT_LE(memo.failures_size(), 100u);
+    EXPECT_EQ(memo.size(), 5u);
+}
+
+TEST(MemoizeTest, SingleFlightCachesFailures)
+{
+    std::atomic<int> calls{ 0 };
+    auto             fail = [&](int x) -> int {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        throw std::invalid_argument(std::to_string(x));
+    };
+    gtl::mt_memoize<decltype(fail), true, 0, std::mutex, true, gtl::no_cache_stats, true> memo(fail);
+
+    std::atomic<int>         failed{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10; ++i) {
+                try {
+                    (void)memo(5);
+                } catch (const std::invalid_argument& e) {
+                    EXPECT_STREQ(e.what(), "5");
+                    ++failed;
+                }
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+    EXPECT_EQ(failed, 80);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(MemoizeTest, LruWithTtl)
+{
+    using namespace std::chrono_literals;
+    int  calls = 0;
+    auto f     = [&](int x) {
+        ++calls;
+        return x * 2;
+    };
+    gtl::memoize_lru<decltype(f), 0, gtl::ttl_policy<gtl::lru_policy, fake_clock>> memo(f, 100, 1s);
+    EXPECT_EQ(memo(3), 6);
+    EXPECT_EQ(memo(3), 6);
+    EXPECT_EQ(calls, 1);
+    fake_clock::current += 2s;
+    EXPECT_FALSE(memo.contains(3));
+    EXPECT_EQ(memo(3), 6);
+    EXPECT_EQ(calls, 2);
+}
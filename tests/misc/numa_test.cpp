@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <gtl/numa.hpp>
+#include <gtl/phmap.hpp>
+#include <gtl/phmap_dump.hpp>
+
+TEST(NumaTest, Nodes)
+{
+    EXPECT_GE(gtl::numa::num_nodes(), 1);
+    EXPECT_GE(gtl::numa::current_node(), 0);
+    EXPECT_LT(gtl::numa::current_node(), gtl::numa::num_nodes());
+}
+
+TEST(NumaTest, PreferredNode)
+{
+    EXPECT_FALSE(gtl::numa::set_preferred_node(1 << 20));
+
+    // may be refused (no NUMA support in the kernel, seccomp)
+    if (!gtl::numa::set_preferred_node(0))
+        GTEST_SKIP() << "set_mempolicy not available";
+#if defined(SYS_get_mempolicy)
+    int           mode    = -1;
+    unsigned long mask[8] = {};
+    ASSERT_EQ(::syscall(SYS_get_mempolicy, &mode, mask, 8 * 8 * sizeof(unsigned long), nullptr, 0), 0);
+    EXPECT_EQ(mode, 1); // MPOL_PREFERRED
+    EXPECT_EQ(mask[0] & 1, 1u);
+#endif
+    std::vector<uint64_t> v(100000, 1); // allocated on node 0
+    EXPECT_EQ(v.back(), 1u);
+
+    EXPECT_TRUE(gtl::numa::set_preferred_node(-1));
+#if defined(SYS_get_mempolicy)
+    ASSERT_EQ(::syscall(SYS_get_mempolicy, &mode, nullptr, 0, nullptr, 0), 0);
+    EXPECT_EQ(mode, 0); // MPOL_DEFAULT
+#endif
+}
+
+TEST(NumaTest, Placement)
+{
+    gtl::numa_placement rr(4);
+    EXPECT_EQ(rr.node_of(0), 0);
+    EXPECT_EQ(rr.node_of(5), 1);
+    auto local = rr.local_submaps(16, 2);
+    EXPECT_EQ(local, (std::vector<size_t>{ 2, 6, 10, 14 }));
+
+    gtl::numa_placement halves([](size_t idx) { return idx < 8 ? 0 : 1; });
+    EXPECT_EQ(halves.local_submaps(16, 1).size(), 8u);
+    EXPECT_EQ(halves.local_submaps(16, 1)[0], 8u);
+}
+
+TEST(NumaTest, Allocator)
+{
+    gtl::numa_allocator<uint64_t, 4096> a(0);
+    constexpr size_t                    n = 100000;
+    uint64_t*                           p = a.allocate(n);
+    for (size_t i = 0; i < n; ++i)
+        p[i] = i;
+    EXPECT_EQ(p[n - 1], n - 1);
+    a.deallocate(p, n);
+
+    gtl::numa_allocator<uint64_t, 4096> b(1);
+    EXPECT_TRUE(a != b);
+    EXPECT_TRUE((a == gtl::numa_allocator<int, 4096>(0)));
+}
+
+TEST(NumaTest, PlaceParallelMap)
+{
+    using Alloc = gtl::numa_allocator<std::pair<const uint64_t, uint64_t>, 4096>;
+    using Map   = gtl::parallel_flat_hash_map<uint64_t,
+                                              uint64_t,
+                                              gtl::Hash<uint64_t>,
+                                              gtl::EqualTo<uint64_t>,
+                                              Alloc,
+                                              4>;
+
+    Map m;
+    for (uint64_t i = 0; i < 10000; ++i)
+        m[i] = i;
+
+    gtl::numa_placement placement(2);
+    gtl::numa_place(m, placement);
+
+    EXPECT_EQ(m.size(), 10000u);
+    for (uint64_t i = 0; i < 10000; ++i)
+        EXPECT_EQ(m[i], i);
+
+    for (size_t i = 0; i < m.subcnt(); ++i)
+        m.with_submap(i, [&](const Map::EmbeddedSet& set) {
+            EXPECT_EQ(set.get_allocator().node(), placement.node_of(i));
+        });
+
+    // the submap of a key is found on the node reported by the placement
+    for (uint64_t i = 0; i < 100; ++i) {
+        int  node  = placement.node_of_key(m, i);
+        auto local = placement.local_submaps(m.subcnt(), node);
+        EXPECT_NE(std::find(local.begin(), local.end(), m.subidx(m.hash(i))), local.end());
+    }
+
+    // growing keeps each submap's allocator
+    for (uint64_t i = 10000; i < 100000; ++i)
+        m[i] = i;
+    for (size_t i = 0; i < m.subcnt(); ++i)
+        m.with_submap(i, [&](const Map::EmbeddedSet& set) {
+            EXPECT_EQ(set.get_allocator().node(), placement.node_of(i));
+        });
+}
+
+TEST(NumaTest, PlacementSurvivesDumpLoad)
+{
+    using Alloc = gtl::numa_allocator<std::pair<const uint64_t, uint64_t>, 4096>;
+    using Map   = gtl::parallel_flat_hash_map<uint64_t,
+                                              uint64_t,
+                                              gtl::Hash<uint64_t>,
+                                              gtl::EqualTo<uint64_t>,
+                                              Alloc,
+                                              4>;
+
+    Map m;
+    for (uint64_t i = 0; i < 10000; ++i)
+        m[i] = i;
+    gtl::numa_placement placement(2);
+    gtl::numa_place(m, placement);
+
+    auto check_nodes = [&](const Map& map) {
+        for (size_t i = 0; i < map.subcnt(); ++i)
+            map.with_submap(i, [&](const Map::EmbeddedSet& set) {
+                EXPECT_EQ(set.get_allocator().node(), placement.node_of(i));
+            });
+    };
+
+    Map m2;
+    gtl::numa_place(m2, placement);
+    {
+        gtl::BinaryOutputArchive ar_out("./numa_dump.data");
+        EXPECT_TRUE(m.phmap_dump(ar_out));
+    }
+    {
+        gtl::BinaryInputArchive ar_in("./numa_dump.data");
+        EXPECT_TRUE(m2.phmap_load(ar_in));
+    }
+    EXPECT_TRUE(m == m2);
+    check_nodes(m2);
+
+    Map m3;
+    gtl::numa_place(m3, placement);
+    EXPECT_TRUE(m.phmap_dump_parallel("./numa_dump.data"));
+    EXPECT_TRUE(m3.phmap_load_parallel("./numa_dump.data"));
+    EXPECT_TRUE(m == m3);
+    check_nodes(m3);
+
+    // a failed load too
+    EXPECT_FALSE(m3.phmap_load_parallel("./no_such_file.data"));
+    check_nodes(m3);
+    std::remove("./numa_dump.data");
+}
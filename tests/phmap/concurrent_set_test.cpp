@@ -0,0 +1,157 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "gtl/concurrent_set.hpp"
+
+namespace gtl {
+namespace priv {
+namespace {
+
+TEST(ConcurrentFlatHashSet, InsertContains)
+{
+    gtl::concurrent_flat_hash_set<uint64_t> s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_FALSE(s.contains(7));
+
+    EXPECT_TRUE(s.insert(7));
+    EXPECT_FALSE(s.insert(7));
+    EXPECT_TRUE(s.contains(7));
+    EXPECT_EQ(s.count(7), 1u);
+    EXPECT_EQ(s.count(8), 0u);
+    EXPECT_EQ(s.size(), 1u);
+}
+
+TEST(ConcurrentFlatHashSet, Grow)
+{
+    gtl::concurrent_flat_hash_set<uint64_t> s;
+    constexpr uint64_t                      num = 100000;
+    for (uint64_t i = 0; i < num; ++i)
+        EXPECT_TRUE(s.insert(i));
+    EXPECT_EQ(s.size(), num);
+    for (uint64_t i = 0; i < num; ++i)
+        EXPECT_TRUE(s.contains(i));
+    EXPECT_FALSE(s.contains(num));
+
+    size_t cnt = 0;
+    s.for_each([&](uint64_t v) { cnt += v < num; });
+    EXPECT_EQ(cnt, num);
+}
+
+TEST(ConcurrentFlatHashSet, Strings)
+{
+    gtl::concurrent_flat_hash_set<std::string> s;
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_TRUE(s.emplace(std::to_string(i)));
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_FALSE(s.insert(std::to_string(i)));
+    EXPECT_EQ(s.size(), 1000u);
+    s.clear();
+    EXPECT_TRUE(s.empty());
+    EXPECT_FALSE(s.contains("1"));
+    EXPECT_TRUE(s.insert("1"));
+}
+
+TEST(ConcurrentFlatHashSet, Reserve)
+{
+    gtl::concurrent_flat_hash_set<uint64_t> s;
+    s.insert(1);
+    s.reserve(10000);
+    size_t cap = s.capacity();
+    EXPECT_GE(cap, 10000u);
+    EXPECT_TRUE(s.contains(1));
+    for (uint64_t i = 0; i < 5000; ++i)
+        s.insert(i);
+    EXPECT_EQ(s.capacity(), cap);
+}
+
+// a value whose copy constructor throws when `fail` is set
+struct throwing_copy
+{
+    static inline bool fail = false;
+
+    int v;
+
+    throwing_copy(int i)
+        : v(i)
+    {
+    }
+    throwing_copy(const throwing_copy& o)
+        : v(o.v)
+    {
+        if (fail)
+            throw std::runtime_error("copy");
+    }
+
+    friend bool operator==(const throwing_copy& a, const throwing_copy& b) { return a.v == b.v; }
+};
+
+struct throwing_copy_hash
+{
+    size_t operator()(const throwing_copy& c) const { return gtl::Hash<int>()(c.v); }
+};
+
+TEST(ConcurrentFlatHashSet, ThrowingConstruct)
+{
+    gtl::concurrent_flat_hash_set<throwing_copy, throwing_copy_hash, std::equal_to<throwing_copy>> s;
+    for (int i = 0; i < 10; ++i)
+        s.insert(throwing_copy(i));
+
+    throwing_copy v(10);
+    throwing_copy::fail = true;
+    EXPECT_THROW(s.insert(v), std::runtime_error);
+    throwing_copy::fail = false;
+    EXPECT_FALSE(s.contains(v));
+    EXPECT_EQ(s.size(), 10u);
+
+    // the slot is released: inserting into the same group and growing don't block
+    EXPECT_TRUE(s.insert(v));
+    for (int i = 0; i < 10000; ++i)
+        s.insert(throwing_copy(i));
+    EXPECT_EQ(s.size(), 10000u);
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_TRUE(s.contains(throwing_copy(i)));
+}
+
+TEST(ConcurrentFlatHashSet, ConcurrentInsertOverlapping)
+{
+    // all threads insert the same values, each must be inserted exactly once
+    using set_type = gtl::concurrent_flat_hash_set<uint64_t,
+                                                   gtl::Hash<uint64_t>,
+                                                   std::equal_to<uint64_t>,
+                                                   std::allocator<uint64_t>,
+                                                   2>;
+    set_type                 s;
+    constexpr size_t         num_threads = 8;
+    constexpr uint64_t       num         = 50000;
+    std::atomic<size_t>      inserted{ 0 };
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            size_t cnt = 0;
+            for (uint64_t i = 0; i < num; ++i) {
+                uint64_t v = (i * 7919 + t * 13) % num;
+                if (s.insert(v))
+                    ++cnt;
+                EXPECT_TRUE(s.contains(v));
+            }
+            inserted += cnt;
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    EXPECT_EQ(inserted.load(), num);
+    EXPECT_EQ(s.size(), num);
+    size_t cnt = 0;
+    s.for_each([&](uint64_t) { ++cnt; });
+    EXPECT_EQ(cnt, num);
+}
+
+} // namespace
+} // namespace priv
+} // namespace gtl
@@ -1,3 +1,8 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -68,6 +73,361 @@ TEST(DumpLoad, ParallelFlatHashMap_uint64_uint32)
     EXPECT_TRUE(mp1 == mp2);
 }
 
+TEST(DumpLoad, BufferedMmapArchives)
+{
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp1;
+    for (uint64_t i = 0; i < 200000; ++i) // slots larger than the output buffer
+        mp1[i * 7919] = uint32_t(i);
+
+    {
+        gtl::BufferedOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+        EXPECT_TRUE(ar_out.close());
+    }
+
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp2;
+    {
+        gtl::MmapInputArchive ar_in("./dump.data");
+        EXPECT_TRUE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(ar_in.ok());
+    }
+    EXPECT_TRUE(mp1 == mp2);
+
+    // the iostream archives read the same format
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp3;
+    {
+        gtl::BinaryInputArchive ar_in("./dump.data");
+        EXPECT_TRUE(mp3.phmap_load(ar_in));
+    }
+    EXPECT_TRUE(mp1 == mp3);
+}
+
+TEST(DumpLoad, ReportsErrors)
+{
+    gtl::flat_hash_map<uint64_t, uint32_t> mp1;
+    for (uint64_t i = 0; i < 1000; ++i)
+        mp1[i] = uint32_t(i);
+
+    {
+        gtl::BufferedOutputArchive ar_out("./no_such_dir/dump.data");
+        EXPECT_FALSE(ar_out.ok());
+        EXPECT_FALSE(mp1.phmap_dump(ar_out));
+        gtl::BinaryOutputArchive ar_out2("./no_such_dir/dump.data");
+        EXPECT_FALSE(mp1.phmap_dump(ar_out2));
+    }
+    {
+        gtl::MmapInputArchive ar_in("./no_such_file.data");
+        EXPECT_FALSE(ar_in.ok());
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+    }
+
+    // a truncated file: the map is left empty
+    {
+        gtl::BufferedOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+        EXPECT_TRUE(ar_out.close());
+    }
+    std::ifstream in("./dump.data", std::ios::binary);
+    std::string   bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream("./dump.data", std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() / 2);
+
+    {
+        gtl::MmapInputArchive                  ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2 = { { 1, 1 } };
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp2.empty());
+        mp2[5] = 5; // still usable
+        EXPECT_EQ(mp2.size(), 1u);
+    }
+    {
+        gtl::BinaryInputArchive                ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp2.empty());
+    }
+}
+
+static std::string read_file(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const char* path, const std::string& bytes)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+}
+
+struct shifted_hash
+{
+    size_t operator()(uint64_t k) const { return gtl::Hash<uint64_t>()(k + 1); }
+};
+
+TEST(DumpLoad, ChecksHeaderAndCrc)
+{
+    gtl::flat_hash_map<uint64_t, uint32_t> mp1;
+    for (uint64_t i = 0; i < 1000; ++i)
+        mp1[i] = uint32_t(i);
+    {
+        gtl::BinaryOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+    }
+    const std::string bytes = read_file("./dump.data");
+    EXPECT_EQ(bytes.substr(0, 4), "GTLD");
+
+    // another slot size or hash function
+    {
+        gtl::BinaryInputArchive                ar_in("./dump.data");
+        gtl::flat_hash_map<uint32_t, uint32_t> mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+    }
+    {
+        gtl::BinaryInputArchive                              ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t, shifted_hash> mp2 = { { 1, 1 } };
+        EXPECT_FALSE(mp2.phmap_load(ar_in, gtl::dump_load_mode::trust));
+        EXPECT_TRUE(mp2.empty());
+    }
+
+    // a byte of the last slot changed: caught by the CRC, unless trusted
+    std::string corrupted = bytes;
+    corrupted[corrupted.size() - 5] ^= 0x40;
+    write_file("./dump.data", corrupted);
+    {
+        gtl::MmapInputArchive                  ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp2.empty());
+    }
+    {
+        gtl::MmapInputArchive                  ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+        EXPECT_TRUE(mp2.phmap_load(ar_in, gtl::dump_load_mode::trust));
+        EXPECT_EQ(mp2.size(), mp1.size());
+    }
+
+    // the header is checked even when trusted
+    corrupted = bytes;
+    corrupted[4] ^= 1; // version
+    write_file("./dump.data", corrupted);
+    {
+        gtl::MmapInputArchive                  ar_in("./dump.data");
+        gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in, gtl::dump_load_mode::trust));
+    }
+
+    // same for the parallel dumps
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp3(mp1.begin(), mp1.end());
+    EXPECT_TRUE(mp3.phmap_dump_parallel("./dump.data"));
+    corrupted = read_file("./dump.data");
+    corrupted[corrupted.size() - 5] ^= 0x40;
+    write_file("./dump.data", corrupted);
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp4;
+    EXPECT_FALSE(mp4.phmap_load_parallel("./dump.data"));
+    EXPECT_TRUE(mp4.empty());
+    EXPECT_TRUE(mp4.phmap_load_parallel("./dump.data", 0, gtl::dump_load_mode::trust));
+    EXPECT_EQ(mp4.size(), mp3.size());
+}
+
+TEST(DumpLoad, RejectsCorruptedCapacity)
+{
+    gtl::flat_hash_map<uint64_t, uint32_t> mp1;
+    for (uint64_t i = 0; i < 1000; ++i)
+        mp1[i] = uint32_t(i);
+    {
+        gtl::BinaryOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+    }
+
+    // a valid capacity, but much larger than the file: fails before allocating the table
+    const uint64_t huge_capacity = (uint64_t(1) << 44) - 1;
+    std::string    corrupted     = read_file("./dump.data");
+    std::memcpy(&corrupted[sizeof(dump_header) + sizeof(size_t)], &huge_capacity, sizeof(huge_capacity));
+    write_file("./dump.data", corrupted);
+    for (auto mode : { gtl::dump_load_mode::verify, gtl::dump_load_mode::trust }) {
+        {
+            gtl::MmapInputArchive                  ar_in("./dump.data");
+            gtl::flat_hash_map<uint64_t, uint32_t> mp2 = { { 1, 1 } };
+            EXPECT_FALSE(mp2.phmap_load(ar_in, mode));
+            EXPECT_TRUE(mp2.empty());
+        }
+        {
+            gtl::BinaryInputArchive                ar_in("./dump.data");
+            gtl::flat_hash_map<uint64_t, uint32_t> mp2;
+            EXPECT_FALSE(mp2.phmap_load(ar_in, mode));
+            EXPECT_TRUE(mp2.empty());
+        }
+    }
+
+    // same for a submap of a parallel dump, bounded by its size in the offset index
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp3(mp1.begin(), mp1.end());
+    EXPECT_TRUE(mp3.phmap_dump_parallel("./dump.data"));
+    corrupted = read_file("./dump.data");
+    uint64_t submap_offset;
+    std::memcpy(&submap_offset, &corrupted[sizeof(dump_header) + sizeof(uint64_t)], sizeof(submap_offset));
+    std::memcpy(&corrupted[submap_offset + sizeof(size_t)], &huge_capacity, sizeof(huge_capacity));
+    write_file("./dump.data", corrupted);
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp4;
+    EXPECT_FALSE(mp4.phmap_load_parallel("./dump.data", 0, gtl::dump_load_mode::trust));
+    EXPECT_TRUE(mp4.empty());
+}
+
+// converts a dump to the format saved before the header and the CRCs were
+// added: the number of submaps (for a parallel map) followed by the tables
+template<class Map>
+static std::string to_legacy_format(const std::string& bytes, bool parallel)
+{
+    constexpr size_t slot_size  = sizeof(typename Map::value_type);
+    size_t           pos        = sizeof(dump_header);
+    size_t           num_tables = 1;
+    std::string      legacy;
+    if (parallel) {
+        std::memcpy(&num_tables, &bytes[pos], sizeof(size_t));
+        legacy.append(bytes, pos, sizeof(size_t));
+        pos += sizeof(size_t);
+    }
+    for (size_t i = 0; i < num_tables; ++i) {
+        size_t size, capacity;
+        std::memcpy(&size, &bytes[pos], sizeof(size_t));
+        std::memcpy(&capacity, &bytes[pos + sizeof(size_t)], sizeof(size_t));
+        size_t table_bytes = 2 * sizeof(size_t);
+        if (size != 0)
+            table_bytes += capacity + Group::kWidth + 1 + slot_size * capacity;
+        legacy.append(bytes, pos, table_bytes);
+        pos += table_bytes + sizeof(uint32_t); // skip the CRC
+    }
+    EXPECT_EQ(pos, bytes.size());
+    return legacy;
+}
+
+TEST(DumpLoad, LoadsLegacyFormat)
+{
+    using Map = gtl::flat_hash_map<uint64_t, uint32_t>;
+    Map mp1;
+    for (uint64_t i = 0; i < 1000; ++i)
+        mp1[i] = uint32_t(i);
+    {
+        gtl::BinaryOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+    }
+    const std::string legacy = to_legacy_format<Map>(read_file("./dump.data"), false);
+    write_file("./dump.data", legacy);
+    {
+        gtl::MmapInputArchive ar_in("./dump.data");
+        Map                   mp2 = { { 1, 2000 } };
+        EXPECT_TRUE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp1 == mp2);
+    }
+    {
+        gtl::BinaryInputArchive ar_in("./dump.data");
+        Map                     mp2;
+        EXPECT_TRUE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp1 == mp2);
+    }
+
+    // the capacity is still checked against the size of the file
+    const size_t huge_capacity = (size_t(1) << 44) - 1;
+    std::string  corrupted     = legacy;
+    std::memcpy(&corrupted[sizeof(size_t)], &huge_capacity, sizeof(huge_capacity));
+    write_file("./dump.data", corrupted);
+    {
+        gtl::MmapInputArchive ar_in("./dump.data");
+        Map                   mp2;
+        EXPECT_FALSE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp2.empty());
+    }
+
+    // an empty map is saved as its size and capacity only
+    {
+        gtl::BinaryOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(Map().phmap_dump(ar_out));
+    }
+    write_file("./dump.data", to_legacy_format<Map>(read_file("./dump.data"), false));
+    {
+        gtl::MmapInputArchive ar_in("./dump.data");
+        Map                   mp2 = { { 1, 2000 } };
+        EXPECT_TRUE(mp2.phmap_load(ar_in));
+        EXPECT_TRUE(mp2.empty());
+    }
+
+    // parallel maps, loaded by phmap_load and phmap_load_parallel
+    using PMap = gtl::parallel_flat_hash_map<uint64_t, uint32_t>;
+    PMap mp3(mp1.begin(), mp1.end());
+    {
+        gtl::BinaryOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp3.phmap_dump(ar_out));
+    }
+    write_file("./dump.data", to_legacy_format<PMap>(read_file("./dump.data"), true));
+    {
+        gtl::MmapInputArchive ar_in("./dump.data");
+        PMap                  mp4;
+        EXPECT_TRUE(mp4.phmap_load(ar_in));
+        EXPECT_TRUE(mp3 == mp4);
+    }
+    PMap mp5 = { { 1, 2000 } };
+    EXPECT_TRUE(mp5.phmap_load_parallel("./dump.data"));
+    EXPECT_TRUE(mp3 == mp5);
+}
+
+TEST(DumpLoad, ParallelDumpLoad)
+{
+    using Map = gtl::parallel_flat_hash_map<uint64_t,
+                                            uint32_t,
+                                            gtl::priv::hash_default_hash<uint64_t>,
+                                            gtl::priv::hash_default_eq<uint64_t>,
+                                            std::allocator<std::pair<const uint64_t, uint32_t>>,
+                                            5,
+                                            std::mutex>;
+    Map mp1;
+    for (uint64_t i = 0; i < 300000; ++i)
+        mp1[i * 7919] = uint32_t(i);
+
+    for (size_t num_threads : { 0, 1, 3 }) {
+        EXPECT_TRUE(mp1.phmap_dump_parallel("./dump.data", num_threads));
+
+        Map mp2 = { { 1, 1 } };
+        EXPECT_TRUE(mp2.phmap_load_parallel("./dump.data", num_threads));
+        EXPECT_TRUE(mp1 == mp2);
+    }
+
+    // an empty map, and a map with another number of submaps
+    Map().phmap_dump_parallel("./dump.data");
+    Map mp3 = { { 1, 1 } };
+    EXPECT_TRUE(mp3.phmap_load_parallel("./dump.data"));
+    EXPECT_TRUE(mp3.empty());
+
+    gtl::parallel_flat_hash_map<uint64_t, uint32_t> mp4 = { { 1, 1 } };
+    EXPECT_FALSE(mp4.phmap_load_parallel("./dump.data"));
+    EXPECT_TRUE(mp4.empty());
+    EXPECT_FALSE(mp4.phmap_load_parallel("./no_such_file.data"));
+
+    // a truncated file
+    EXPECT_TRUE(mp1.phmap_dump_parallel("./dump.data"));
+    std::ifstream in("./dump.data", std::ios::binary);
+    std::string   bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream("./dump.data", std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() - 1);
+    Map mp5;
+    EXPECT_FALSE(mp5.phmap_load_parallel("./dump.data"));
+    EXPECT_TRUE(mp5.empty());
+
+    // the sequential load leaves an empty map too, not the submaps loaded before the error
+    {
+        gtl::BufferedOutputArchive ar_out("./dump.data");
+        EXPECT_TRUE(mp1.phmap_dump(ar_out));
+        EXPECT_TRUE(ar_out.close());
+    }
+    bytes = read_file("./dump.data");
+    write_file("./dump.data", bytes.substr(0, bytes.size() - 1));
+    gtl::MmapInputArchive ar_in("./dump.data");
+    Map                   mp6;
+    EXPECT_FALSE(mp6.phmap_load(ar_in));
+    EXPECT_TRUE(mp6.empty());
+
+    EXPECT_FALSE(mp1.phmap_dump_parallel("./no_such_dir/dump.data"));
+}
+
 }
 }
 }
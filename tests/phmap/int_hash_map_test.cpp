@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "gtl/int_hash_map.hpp"
+
+namespace gtl {
+namespace priv {
+namespace {
+
+TEST(IntFlatHashMap, Basic)
+{
+    gtl::int_flat_hash_map<uint32_t, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.find(1) == m.end());
+    EXPECT_TRUE(m.begin() == m.end());
+
+    EXPECT_TRUE(m.insert({ 1, "one" }).second);
+    EXPECT_FALSE(m.insert({ 1, "uno" }).second);
+    EXPECT_EQ(m.size(), 1u);
+    EXPECT_TRUE(m.contains(1));
+    EXPECT_EQ(m.at(1), "one");
+    EXPECT_EQ(m.find(1)->second, "one");
+    EXPECT_THROW(m.at(2), std::out_of_range);
+
+    m[2] = "two";
+    EXPECT_EQ(m.count(2), 1u);
+    EXPECT_TRUE(m.emplace(3, "three").second);
+    EXPECT_TRUE(m.try_emplace(4, 3, 'x').second);
+    EXPECT_EQ(m[4], "xxx");
+    EXPECT_FALSE(m.insert_or_assign(4, "four").second);
+    EXPECT_EQ(m[4], "four");
+    EXPECT_EQ(m.erase(2), 1u);
+    EXPECT_EQ(m.erase(2), 0u);
+    EXPECT_EQ(m.size(), 3u);
+}
+
+TEST(IntFlatHashMap, ReservedKeys)
+{
+    using map_t = gtl::int_flat_hash_map<int16_t, int>;
+    map_t m;
+    m[map_t::kEmptyKey]   = 1;
+    m[map_t::kDeletedKey] = 2;
+    m[-1]                 = 3;
+    EXPECT_EQ(m.size(), 3u);
+    EXPECT_EQ(m[map_t::kEmptyKey], 1);
+    EXPECT_EQ(m[map_t::kDeletedKey], 2);
+
+    int sum = 0;
+    for (auto& [k, v] : m)
+        sum += v;
+    EXPECT_EQ(sum, 6);
+
+    for (int16_t i = 0; i < 1000; ++i)
+        m[i] = i;
+    EXPECT_EQ(m[map_t::kEmptyKey], 1); // survives the rehashes
+    EXPECT_EQ(m.erase(map_t::kEmptyKey), 1u);
+    EXPECT_FALSE(m.contains(map_t::kEmptyKey));
+    EXPECT_TRUE(m.contains(map_t::kDeletedKey));
+    EXPECT_EQ(m.size(), 1002u);
+}
+
+template<class Index>
+void check_against_std_map(uint64_t key_mask, uint64_t stride)
+{
+    gtl::int_flat_hash_map<uint64_t, uint64_t, Index> m;
+    std::map<uint64_t, uint64_t>                      ref;
+    std::mt19937_64                                   gen(7);
+
+    for (size_t i = 0; i < 200000; ++i) {
+        uint64_t k = (gen() & key_mask) * stride;
+        switch (gen() % 3) {
+            case 0:
+                m[k] = i;
+                ref[k] = i;
+                break;
+            case 1:
+                EXPECT_EQ(m.erase(k), ref.erase(k));
+                break;
+            default:
+                EXPECT_EQ(m.contains(k), ref.count(k) == 1);
+                break;
+        }
+    }
+    EXPECT_EQ(m.size(), ref.size());
+    for (auto [k, v] : ref)
+        EXPECT_EQ(m.at(k), v);
+}
+
+// counts the live instances, and throws on construction when `fail` is set
+struct throwing_value
+{
+    static inline int  live = 0;
+    static inline bool fail = false;
+
+    int v;
+
+    throwing_value(int i)
+        : v(i)
+    {
+        if (fail)
+            throw std::runtime_error("construct");
+        ++live;
+    }
+    throwing_value(const throwing_value& o)
+        : v(o.v)
+    {
+        ++live;
+    }
+    ~throwing_value() { --live; }
+};
+
+TEST(IntFlatHashMap, ThrowingValue)
+{
+    using map_t = gtl::int_flat_hash_map<int, throwing_value>;
+    {
+        map_t m;
+        for (int i = 0; i < 100; ++i)
+            m.try_emplace(i, i);
+        m.erase(50);
+
+        throwing_value::fail = true;
+        EXPECT_THROW(m.try_emplace(50, 50), std::runtime_error);  // deleted slot
+        EXPECT_THROW(m.try_emplace(500, 500), std::runtime_error); // empty slot
+        EXPECT_THROW(m.try_emplace(map_t::kEmptyKey, 0), std::runtime_error);
+        EXPECT_THROW(m.try_emplace(map_t::kDeletedKey, 0), std::runtime_error);
+        throwing_value::fail = false;
+
+        EXPECT_EQ(m.size(), 99u);
+        EXPECT_EQ(throwing_value::live, 99);
+        EXPECT_FALSE(m.contains(50));
+        EXPECT_FALSE(m.contains(500));
+        EXPECT_FALSE(m.contains(map_t::kEmptyKey));
+        EXPECT_FALSE(m.contains(map_t::kDeletedKey));
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(m.contains(i), i != 50);
+        size_t n = 0;
+        for (auto& kv : m)
+            n += kv.first == kv.second.v;
+        EXPECT_EQ(n, 99u);
+
+        m.try_emplace(map_t::kEmptyKey, -1);
+        EXPECT_EQ(m.at(map_t::kEmptyKey).v, -1);
+        EXPECT_EQ(m.size(), 100u);
+    }
+    EXPECT_EQ(throwing_value::live, 0);
+}
+
+TEST(IntFlatHashMap, MatchesStdMap)
+{
+    check_against_std_map<gtl::int_mix_index>(0xffff, 1);
+    check_against_std_map<gtl::int_mix_index>(0xffff, 4096);
+    check_against_std_map<gtl::int_identity_index>(0xffff, 1);
+    check_against_std_map<gtl::int_identity_index>(0x3ff, 1024);
+    check_against_std_map<gtl::int_direct_index<0x10000>>(0xffff, 1);
+}
+
+TEST(IntFlatHashMap, DirectIndex)
+{
+    gtl::int_flat_hash_map<uint32_t, int, gtl::int_direct_index<1000>> m;
+    m[5] = 5;
+    EXPECT_GE(m.capacity(), 1000u); // sized for all keys below the bound on first insert
+    size_t cap = m.capacity();
+    for (uint32_t i = 0; i < 1000; ++i)
+        m[i] = (int)i;
+    EXPECT_EQ(m.capacity(), cap);
+    EXPECT_EQ(m.size(), 1000u);
+}
+
+TEST(IntFlatHashMap, EraseWhileIterating)
+{
+    gtl::int_flat_hash_map<int, int> m;
+    for (int i = 0; i < 10000; ++i)
+        m[i] = i;
+    for (auto it = m.begin(); it != m.end();) {
+        if (it->first % 3 == 0)
+            it = m.erase(it);
+        else
+            ++it;
+    }
+    EXPECT_EQ(m.size(), 6666u);
+    EXPECT_EQ(gtl::erase_if(m, [](const auto& v) { return v.first % 3 == 1; }), 3333u);
+    for (auto& [k, v] : m)
+        EXPECT_EQ(k % 3, 2);
+
+    // reinsert over tombstones
+    for (int i = 0; i < 10000; ++i)
+        m.insert({ i, i });
+    EXPECT_EQ(m.size(), 10000u);
+}
+
+TEST(IntFlatHashMap, CopyMove)
+{
+    gtl::int_flat_hash_map<uint32_t, std::string> m{ { 1, "a" }, { 2, "b" }, { 0xffffffff, "max" } };
+    auto                                            c = m;
+    EXPECT_TRUE(c == m);
+    c[3] = "c";
+    EXPECT_TRUE(c != m);
+
+    auto d = std::move(c);
+    EXPECT_EQ(d.size(), 4u);
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(d[0xffffffff], "max");
+
+    c = d;
+    d.clear();
+    EXPECT_TRUE(d.empty());
+    EXPECT_TRUE(d.begin() == d.end());
+    EXPECT_EQ(c.size(), 4u);
+    swap(c, d);
+    EXPECT_EQ(d.size(), 4u);
+}
+
+TEST(IntFlatHashSet, Basic)
+{
+    gtl::int_flat_hash_set<uint16_t> s;
+    for (uint32_t i = 0; i < 65536; i += 3)
+        s.insert((uint16_t)i);
+    s.insert(65535);
+    s.insert(65534);
+    EXPECT_EQ(s.size(), 21846u + 1);
+    EXPECT_TRUE(s.contains(65535));
+    EXPECT_TRUE(s.contains(65534));
+    EXPECT_FALSE(s.contains(1));
+
+    size_t cnt = 0;
+    for (uint16_t k : s)
+        cnt += (k % 3 == 0 || k >= 65534);
+    EXPECT_EQ(cnt, s.size());
+
+    s.rehash(0);
+    EXPECT_EQ(s.size(), 21847u);
+    EXPECT_TRUE(s.emplace(1).second);
+    EXPECT_EQ(s.erase(65535), 1u);
+    EXPECT_FALSE(s.contains(65535));
+}
+
+} // namespace
+} // namespace priv
+} // namespace gtl
@@ -171,6 +171,45 @@ TEST(THIS_TEST_NAME, EmplaceSingle)
     EXPECT_EQ(m.count(11), 0u);
 }
 
+template<size_t N>
+using SubmapSet = gtl::THIS_HASH_SET<int, gtl::Hash<int>, std::equal_to<int>, std::allocator<int>, N>;
+
+TEST(THIS_TEST_NAME, ReserveBySubmaps)
+{
+    // each submap gets the capacity for its share of the elements
+    auto check = [](auto&& m, size_t expected) {
+        m.reserve(1000);
+        EXPECT_EQ(m.bucket_count(), expected);
+        for (int i = 0; i < 1000; ++i)
+            m.insert(i);
+        EXPECT_EQ(m.bucket_count(), expected); // no rehash
+    };
+    check(SubmapSet<0>(), 2047);
+    check(SubmapSet<2>(), 4 * 511);
+    check(SubmapSet<4>(), 16 * 127);
+}
+
+TEST(THIS_TEST_NAME, ClearWithAuxCont)
+{
+    struct aux_count
+    {
+        size_t n = 0;
+        void   clear() { n = 0; }
+    };
+    using Set = gtl::
+        THIS_HASH_SET<int, gtl::Hash<int>, std::equal_to<int>, std::allocator<int>, 2, gtl::NullMutex, aux_count>;
+
+    Set m;
+    for (int i = 0; i < 100; ++i)
+        m.insert(i);
+    for (size_t s = 0; s < Set::subcnt(); ++s)
+        m.get_inner(s).aux_.n = 1;
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    for (size_t s = 0; s < Set::subcnt(); ++s)
+        EXPECT_EQ(m.get_inner(s).aux_.n, 0u);
+}
+
 } // namespace
 } // namespace priv
 } // namespace gtl
@@ -28,6 +28,7 @@
 #include <memory>
 #include <numeric>
 #include <random>
+#include <stdexcept>
 #include <string>
 
 #ifdef _MSC_VER
@@ -619,6 +620,31 @@ TEST(Table, LazyEmplace)
     EXPECT_THAT(*it, Pair("abc", "ABC"));
 }
 
+TEST(Table, LazyEmplaceThrows)
+{
+    StringTable t;
+    EXPECT_THROW(t.lazy_emplace("abc", [&](const StringTable::constructor&) { throw std::runtime_error("fail"); }),
+                 std::runtime_error);
+    EXPECT_EQ(t.size(), 0u);
+    EXPECT_TRUE(t.find("abc") == t.end());
+
+    // thrown after the value is constructed: the value is kept
+    EXPECT_THROW(t.lazy_emplace("abc",
+                                [&](const StringTable::constructor& f) {
+                                    f("abc", "ABC");
+                                    throw std::runtime_error("fail");
+                                }),
+                 std::runtime_error);
+    EXPECT_EQ(t.size(), 1u);
+    EXPECT_THAT(*t.find("abc"), Pair("abc", "ABC"));
+    for (int i = 0; i < 100; ++i)
+        t.emplace(std::to_string(i), "x");
+    EXPECT_EQ(t.size(), 101u);
+    EXPECT_THAT(*t.find("abc"), Pair("abc", "ABC"));
+    t.erase("abc");
+    EXPECT_EQ(t.size(), 100u);
+}
+
 TEST(Table, ContainsEmpty)
 {
     IntTable t;
@@ -0,0 +1,143 @@
+#include <array>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "gtl/soa_hash_map.hpp"
+
+namespace gtl {
+namespace priv {
+namespace {
+
+using Blob = std::array<uint64_t, 8>; // 64 bytes
+
+TEST(SoaFlatHashMap, Basic)
+{
+    gtl::soa_flat_hash_map<uint64_t, Blob> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.find(1) == m.end());
+
+    Blob b{};
+    b[3] = 7;
+    EXPECT_TRUE(m.insert({ 1, b }).second);
+    EXPECT_FALSE(m.insert({ 1, Blob{} }).second);
+    EXPECT_EQ(m.size(), 1u);
+    EXPECT_TRUE(m.contains(1));
+    EXPECT_EQ(m.at(1)[3], 7u);
+    EXPECT_EQ(m.find(1)->second[3], 7u);
+    EXPECT_THROW(m.at(2), std::out_of_range);
+
+    m[2][0] = 5;
+    EXPECT_EQ(m.count(2), 1u);
+    EXPECT_EQ(m[2][0], 5u);
+    EXPECT_EQ(m.erase(2), 1u);
+    EXPECT_EQ(m.erase(2), 0u);
+    EXPECT_EQ(m.size(), 1u);
+}
+
+TEST(SoaFlatHashMap, GrowEraseIterate)
+{
+    gtl::soa_flat_hash_map<int, std::string> m;
+    for (int i = 0; i < 10000; ++i)
+        m.try_emplace(i, std::to_string(i));
+    EXPECT_EQ(m.size(), 10000u);
+    for (int i = 0; i < 10000; i += 2)
+        m.erase(i);
+    EXPECT_EQ(m.size(), 5000u);
+
+    size_t cnt = 0;
+    for (auto [k, v] : m) {
+        EXPECT_EQ(k % 2, 1);
+        EXPECT_EQ(v, std::to_string(k));
+        ++cnt;
+    }
+    EXPECT_EQ(cnt, 5000u);
+
+    // reinsert over tombstones
+    for (int i = 0; i < 10000; i += 2)
+        m.insert_or_assign(i, std::string("x"));
+    EXPECT_EQ(m.size(), 10000u);
+    EXPECT_EQ(m[4], "x");
+    EXPECT_EQ(m[5], "5");
+}
+
+TEST(SoaFlatHashMap, CopyMove)
+{
+    gtl::soa_flat_hash_map<int, std::string> m1 = {
+        {1,  "one"},
+        { 2, "two"}
+    };
+    auto m2 = m1;
+    EXPECT_TRUE(m1 == m2);
+    m2[3] = "three";
+    EXPECT_TRUE(m1 != m2);
+
+    auto m3 = std::move(m2);
+    EXPECT_TRUE(m2.empty());
+    EXPECT_EQ(m3.size(), 3u);
+    m2 = m3;
+    EXPECT_TRUE(m2 == m3);
+    m3.clear();
+    EXPECT_TRUE(m3.empty());
+    EXPECT_TRUE(m3.begin() == m3.end());
+    m3.rehash(0);
+    EXPECT_EQ(m3.capacity(), 0u);
+}
+
+TEST(SoaFlatHashMap, Reserve)
+{
+    gtl::soa_flat_hash_map<uint32_t, uint32_t> m;
+    m.reserve(1000);
+    size_t cap = m.capacity();
+    for (uint32_t i = 0; i < 1000; ++i)
+        m[i] = i;
+    EXPECT_EQ(m.capacity(), cap);
+
+    const auto& cm = m;
+    uint64_t    sum = 0;
+    for (auto it = cm.begin(); it != cm.end(); ++it)
+        sum += it->second;
+    EXPECT_EQ(sum, 999u * 1000 / 2);
+}
+
+TEST(SoaFlatHashMap, InsertMovesPair)
+{
+    // move-only key and value: both must be moved out of the pair
+    gtl::soa_flat_hash_map<std::unique_ptr<int>, std::unique_ptr<int>> m;
+    auto res = m.insert(std::pair{ std::make_unique<int>(1), std::make_unique<int>(10) });
+    EXPECT_TRUE(res.second);
+    EXPECT_EQ(*res.first->first, 1);
+    EXPECT_EQ(*res.first->second, 10);
+
+    gtl::soa_flat_hash_map<std::string, std::string> m2;
+    std::pair<std::string, std::string> p{ std::string(100, 'k'), std::string(100, 'v') };
+    EXPECT_TRUE(m2.insert(std::move(p)).second);
+    EXPECT_TRUE(p.first.empty());
+    EXPECT_TRUE(p.second.empty());
+    EXPECT_EQ(m2.at(std::string(100, 'k')), std::string(100, 'v'));
+}
+
+TEST(SoaFlatHashMap, Emplace)
+{
+    gtl::soa_flat_hash_map<int, std::string> m;
+    EXPECT_TRUE(m.emplace(1, "one").second);
+    EXPECT_TRUE(m.emplace(2, 3, 'x').second);
+    EXPECT_TRUE(m.emplace(std::pair<int, std::string>{ 3, "three" }).second);
+    EXPECT_TRUE(m.emplace(std::make_pair(4, "four")).second);
+    EXPECT_TRUE(m.emplace(std::piecewise_construct, std::forward_as_tuple(5), std::forward_as_tuple(2, 'y')).second);
+    EXPECT_FALSE(m.emplace(std::pair<int, std::string>{ 3, "other" }).second);
+
+    EXPECT_EQ(m.size(), 5u);
+    EXPECT_EQ(m[1], "one");
+    EXPECT_EQ(m[2], "xxx");
+    EXPECT_EQ(m[3], "three");
+    EXPECT_EQ(m[4], "four");
+    EXPECT_EQ(m[5], "yy");
+}
+
+} // namespace
+} // namespace priv
+} // namespace gtl